@@ -0,0 +1,210 @@
+//********************************************************************
+//  FILE NAME:      AgingPqueue.h
+//
+//  DESCRIPTION:    Priority queue whose items gain priority the longer
+//					they wait. Aging is the same for every item, so the
+//					queue stores each key relative to a shared epoch and
+//					time can pass without touching the heap.
+//*********************************************************************
+#ifndef AGING_PQUEUE_20261018_H
+#define AGING_PQUEUE_20261018_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! How waiting raises an item's priority
+	enum EAgingMode
+	{
+		AGING_ADDITIVE,			//!< priority + rate * ticks waited
+		AGING_MULTIPLICATIVE	//!< priority * exp(rate * ticks waited), priorities must be > 0
+	};
+
+	//! Responsible for handing out the value with the largest effective
+	//! priority, where effective priority grows with the time a value has
+	//! waited. Two values age by the same amount over the same time, so
+	//! their order never changes after they are pushed: the heap holds the
+	//! priority minus the aging it would have had at the epoch (the log of
+	//! the priority for AGING_MULTIPLICATIVE) and moving time forward is O(1).
+	//!
+	//! Keys drift from their priorities as time moves away from the epoch.
+	//! Renormalize moves the epoch to the current time and shifts every key
+	//! by the same amount, O(n) with no comparisons. AdvanceTime calls it
+	//! every renormalize interval, so that call is O(n); a queue made with
+	//! MANUAL_RENORMALIZE never renormalizes on its own, keeping AdvanceTime
+	//! O(1), and its owner calls Renormalize when it has time to spare.
+	template <class Value>
+	class CAgingPqueue
+	{
+	public:
+		typedef std::uint64_t Tick_t;	//!< unit of time for aging
+
+		enum
+		{
+			DEFAULT_RENORMALIZE_INTERVAL = 1 << 16,
+			MANUAL_RENORMALIZE = 0		//!< renormalize interval leaving it to the owner
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Construct an empty queue
+		//!
+		//! @param[in] agingRate
+		//!   priority gained per tick waited, or for AGING_MULTIPLICATIVE the
+		//!  log of the factor gained per tick
+		//! @param[in] mode
+		//!   how the rate is applied
+		//! @param[in] startTime
+		//!   current time of the queue
+		//! @param[in] renormalizeInterval
+		//!   ticks AdvanceTime lets pass between renormalizations, or
+		//!  MANUAL_RENORMALIZE for none
+		//!************************************************************************
+		explicit CAgingPqueue(double agingRate, EAgingMode mode = AGING_ADDITIVE, Tick_t startTime = 0,
+			Tick_t renormalizeInterval = DEFAULT_RENORMALIZE_INTERVAL) :
+		  m_heap(typename CHeap<CEntry>::ISortOrderPtr(new CKeySortOrder())),
+		  m_agingRate(agingRate),
+		  m_mode(mode),
+		  m_epoch(startTime),
+		  m_currentTime(startTime),
+		  m_renormalizeInterval(renormalizeInterval)
+		{
+		}
+
+		//! Move only, the items are never copied with the queue
+		CAgingPqueue(const CAgingPqueue&) = delete;
+		CAgingPqueue& operator=(const CAgingPqueue&) = delete;
+		CAgingPqueue(CAgingPqueue&&) = default;
+		CAgingPqueue& operator=(CAgingPqueue&&) = default;
+
+		//************************************************************************
+		//! @details
+		//!   Queue value, starting to age from the current time. O(log n).
+		//!
+		//! @param[in] priority
+		//!   the value's priority now
+		//! @param[in] value
+		//!   value to queue
+		//!************************************************************************
+		void Push(double priority, const Value& value)
+		{
+			CEntry entry = { ToKeySpace(priority) - GetAgingSinceEpoch(), value };
+			m_heap.Insert(entry);
+		}
+
+		//! @return const Value&
+		//!   the value with the largest effective priority
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		const Value& PeekFront() const
+		{
+			return m_heap.PeekTop().value;
+		}
+
+		//! @return double
+		//!   the effective priority of the front value at the current time
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		double PeekFrontPriority() const
+		{
+			return FromKeySpace(m_heap.PeekTop().key + GetAgingSinceEpoch());
+		}
+
+		//! Discard the front value
+		void PopFront()
+		{
+			m_heap.PopTop();
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize();
+		}
+
+		Tick_t GetCurrentTime() const
+		{
+			return m_currentTime;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Age every queued value. O(1), except the call crossing each
+		//!  renormalize interval, which renormalizes in O(n). Always O(1) with
+		//!  MANUAL_RENORMALIZE.
+		//!
+		//! @param[in] now
+		//!   new current time. Times before the current time are ignored.
+		//!************************************************************************
+		void AdvanceTime(Tick_t now)
+		{
+			if (now <= m_currentTime)
+			{
+				return;
+			}
+			m_currentTime = now;
+			if (m_renormalizeInterval != MANUAL_RENORMALIZE && m_currentTime - m_epoch >= m_renormalizeInterval)
+			{
+				Renormalize();
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Move the epoch to the current time, adding the aging since the
+		//!  old epoch to every key. Adding the same amount keeps the heap
+		//!  ordered, so nothing is compared or moved. O(n).
+		//!************************************************************************
+		void Renormalize()
+		{
+			const double aging = GetAgingSinceEpoch();
+			if (aging != 0.0)
+			{
+				m_heap.UpdateKeepingOrder([aging](CEntry& entry) { entry.key += aging; });
+			}
+			m_epoch = m_currentTime;
+		}
+
+	private:
+		//! A queued value and its key relative to the epoch
+		struct CEntry
+		{
+			double key;		//!< priority (or log priority) less the aging from the epoch to the push
+			Value value;	//!< the user's value
+		};
+
+		//! Orders entries by key alone
+		class CKeySortOrder : public ISortOrder<CEntry>
+		{
+		public:
+			bool LessThan(const CEntry& lhs, const CEntry& rhs) const
+			{
+				return lhs.key < rhs.key;
+			}
+		};
+
+		CHeap<CEntry> m_heap;			//!< queued values, largest key on top
+		double m_agingRate;				//!< key gained per tick
+		EAgingMode m_mode;				//!< whether keys are priorities or their logs
+		Tick_t m_epoch;					//!< time the keys are relative to
+		Tick_t m_currentTime;			//!< latest time given to AdvanceTime
+		Tick_t m_renormalizeInterval;	//!< ticks between automatic renormalizations, or MANUAL_RENORMALIZE
+
+		double GetAgingSinceEpoch() const
+		{
+			return m_agingRate * static_cast<double>(m_currentTime - m_epoch);
+		}
+
+		double ToKeySpace(double priority) const
+		{
+			return m_mode == AGING_MULTIPLICATIVE ? std::log(priority) : priority;
+		}
+
+		double FromKeySpace(double key) const
+		{
+			return m_mode == AGING_MULTIPLICATIVE ? std::exp(key) : key;
+		}
+	};
+}
+
+#endif
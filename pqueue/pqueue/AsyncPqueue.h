@@ -0,0 +1,162 @@
+//********************************************************************
+//  FILE NAME:      AsyncPqueue.h
+//
+//  DESCRIPTION:    Priority queue for C++20 coroutines. Consumers
+//					co_await the front of the queue instead of polling
+//					it; a push hands its item straight to a waiting
+//					consumer.
+//*********************************************************************
+#ifndef ASYNC_PQUEUE_20261018_H
+#define ASYNC_PQUEUE_20261018_H
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include "Pqueue.h"
+
+namespace pqueue
+{
+	//! Responsible for queueing items by priority for coroutines on one
+	//! event loop. co_await Pop() completes at once if an item is queued,
+	//! otherwise the coroutine suspends until a Push. Waiting coroutines are
+	//! served in the order they started waiting, each with the front of the
+	//! queue at the time.
+	//!
+	//! The queue knows nothing about the event loop: a waiter is resumed
+	//! through the resume function given at construction, by default right
+	//! inside Push. Not thread safe, every call must come from the loop's
+	//! thread. A coroutine suspended in Pop must not be destroyed.
+	template <class T>
+	class CAsyncPqueue
+	{
+	private:
+		//! A suspended consumer and where its item goes
+		struct CWaiter
+		{
+			std::coroutine_handle<> coroutine;	//!< consumer to resume
+			std::optional<T>* item;				//!< filled in before resuming
+		};
+
+	public:
+		typedef typename CHeap<T>::ISortOrderPtr ISortOrderPtr;				//!< typedef for a sort order for T
+		typedef std::function<void (std::coroutine_handle<>)> Resumer_t;	//!< resumes a waiter, eg. by posting it to the loop
+
+		//! Awaitable returned by Pop, see CAsyncPqueue
+		class CPopAwaiter
+		{
+		private:
+			CAsyncPqueue* m_queue;			//!< queue being popped
+			std::optional<T> m_item;		//!< item handed over by Push while suspended
+		public:
+			explicit CPopAwaiter(CAsyncPqueue& queue) : m_queue(&queue) {}
+
+			//! Don't suspend if an item is queued and nobody is ahead in line
+			bool await_ready() const
+			{
+				return m_queue->m_waiters.empty() && m_queue->m_pqueue.GetSize() > 0;
+			}
+
+			void await_suspend(std::coroutine_handle<> coroutine)
+			{
+				CWaiter waiter = { coroutine, &m_item };
+				m_queue->m_waiters.push_back(waiter);
+			}
+
+			//! @return T
+			//!   the highest priority item when the wait finished
+			T await_resume()
+			{
+				if (m_item)
+				{
+					return std::move(*m_item);
+				}
+				T front = m_queue->m_pqueue.PeekFront();
+				m_queue->m_pqueue.PopFront();
+				return front;
+			}
+		};
+
+		//************************************************************************
+		//! @param[in] sortOrder
+		//!   how to sort the queued items
+		//! @param[in] resumer
+		//!   called with each waiter to resume. Empty resumes the waiter
+		//!  inline, before Push returns.
+		//!************************************************************************
+		explicit CAsyncPqueue(const ISortOrderPtr& sortOrder, const Resumer_t& resumer = Resumer_t()) :
+		  m_pqueue(sortOrder),
+		  m_resumer(resumer)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Queue an item. If a consumer is waiting, the highest priority item
+		//!  is handed to the one that has waited longest and it is resumed.
+		//!
+		//! @param[in] newItem
+		//!   item to queue
+		//!************************************************************************
+		void Push(const T& newItem)
+		{
+			m_pqueue.Push(newItem);
+			if (m_waiters.empty())
+			{
+				return;
+			}
+			const CWaiter waiter = m_waiters.front();
+			m_waiters.pop_front();
+			waiter.item->emplace(m_pqueue.PeekFront());
+			m_pqueue.PopFront();
+			if (m_resumer)
+			{
+				m_resumer(waiter.coroutine);
+			}
+			else
+			{
+				waiter.coroutine.resume();
+			}
+		}
+
+		//************************************************************************
+		//! @return CPopAwaiter
+		//!   awaitable that removes the highest priority item, waiting for one
+		//!  if the queue is empty
+		//!************************************************************************
+		CPopAwaiter Pop()
+		{
+			return CPopAwaiter(*this);
+		}
+
+		//! @return std::size_t
+		//!   number of queued items, not counting items handed to waiters
+		std::size_t GetSize() const
+		{
+			return m_pqueue.GetSize();
+		}
+
+		//! @return std::size_t
+		//!   number of coroutines suspended in Pop
+		std::size_t GetNumWaiters() const
+		{
+			return m_waiters.size();
+		}
+
+		CAsyncPqueue(const CAsyncPqueue&) = delete;
+		CAsyncPqueue& operator=(const CAsyncPqueue&) = delete;
+
+	private:
+		CPqueue<T> m_pqueue;				//!< items nobody has waited for yet
+		std::deque<CWaiter> m_waiters;		//!< suspended consumers, longest waiting first
+		Resumer_t m_resumer;				//!< how waiters are resumed
+	};
+}
+
+#endif
+
+#endif
@@ -34,6 +34,12 @@ namespace pqueue
 			std::less<T> stdLessPred;
 			return stdLessPred(lhs, rhs);
 		}
+
+		//! Three-way version of LessThan, see ISortOrder::Compare
+		int Compare(const T& lhs, const T& rhs) const
+		{
+			return ThreeWayCompare(lhs, rhs);
+		}
 	};
 
 	//! Sort that sorts probably the opposite you would expect
@@ -55,9 +61,15 @@ namespace pqueue
 		//!************************************************************************
 		bool LessThan(const T& lhs, const T& rhs) const
 		{
-			std::greater<int> stdGreaterPred;
+			std::greater<T> stdGreaterPred;
 			return stdGreaterPred(lhs, rhs);
 		}
+
+		//! Three-way version of LessThan, see ISortOrder::Compare
+		int Compare(const T& lhs, const T& rhs) const
+		{
+			return ThreeWayCompare(rhs, lhs);
+		}
 	};
 
 	//! Uses a list of sort orders to sort on multiple criteria
@@ -67,20 +79,36 @@ namespace pqueue
 	class CCompositeSortOrder : public ISortOrder<T>
 	{
 	private: 
-		typedef boost::shared_ptr< ISortOrder<T> > ISortOrderPtr;
+		typedef std::shared_ptr< ISortOrder<T> > ISortOrderPtr;
 		std::vector< ISortOrderPtr > m_sortCriteria;
 	public:
 		//************************************************************************
 		//! @details
 		//!   Construct the composite sort order with a vector of other sort
-		//!  orders.
+		//!  orders. Any criteria that are themselves composite sort orders are
+		//!  flattened into this one so comparison is a single loop.
 		//!
 		//! @param[in] sorts
 		//!   sort orders to use 
 		//!************************************************************************
-		CCompositeSortOrder(const std::vector< ISortOrderPtr >& sorts) : 
-		  m_sortCriteria(sorts)
+		CCompositeSortOrder(const std::vector< ISortOrderPtr >& sorts)
 		{
+			typename std::vector< ISortOrderPtr >::const_iterator currSort = sorts.begin();
+			for (; currSort != sorts.end(); ++currSort)
+			{
+				std::shared_ptr< CCompositeSortOrder<T> > nested =
+					std::dynamic_pointer_cast< CCompositeSortOrder<T> >(*currSort);
+				if (nested)
+				{
+					// nested criteria are already flat
+					m_sortCriteria.insert(m_sortCriteria.end(),
+						nested->m_sortCriteria.begin(), nested->m_sortCriteria.end());
+				}
+				else
+				{
+					m_sortCriteria.push_back(*currSort);
+				}
+			}
 		}
 
 		//************************************************************************
@@ -98,25 +126,39 @@ namespace pqueue
 		//!************************************************************************
 		bool LessThan(const T& lhs, const T& rhs) const
 		{
-			std::vector< ISortOrderPtr >::const_iterator currSort = m_sortCriteria.begin();
+			return Compare(lhs, rhs) < 0;
+		}
+
+		//************************************************************************
+		//! @details
+		//!		Three-way compare lhs and rhs, asking each criterion once in
+		//!	turn until one of them tells the two apart
+		//!
+		//! @return int
+		//!   negative if lhs < rhs, positive if rhs < lhs, 0 if all criteria
+		//!  consider them equal
+		//!************************************************************************
+		int Compare(const T& lhs, const T& rhs) const
+		{
+			typename std::vector< ISortOrderPtr >::const_iterator currSort = m_sortCriteria.begin();
 			for (; currSort != m_sortCriteria.end(); ++currSort)
 			{
-				// If lhs < rhs for this sort then return true
-				if ((*currSort)->LessThan(lhs, rhs))
-				{
-					return true;
-				}
-				// if lhs > rhs, then return falze
-				else if ((*currSort)->LessThan(rhs, lhs))
+				const int result = (*currSort)->Compare(lhs, rhs);
+				if (result != 0)
 				{
-					return false;
+					return result;
 				}
 				// if neither, they are equal, continue to the next 
 				// item to consider
 			}
-			// if we got here, all sorts are equal, return false
-			return false;
+			// if we got here, all sorts are equal
+			return 0;
+		}
 
+		//! Number of criteria after flattening nested composites
+		std::size_t GetNumCriteria() const
+		{
+			return m_sortCriteria.size();
 		}
 	};
 };
@@ -0,0 +1,279 @@
+//********************************************************************
+//  FILE NAME:      BlockingPqueue.h
+//
+//  DESCRIPTION:    Thread safe bounded priority queue for producer/
+//					consumer pipelines. Producers wait (or give up)
+//					while the queue is full, consumers wait while it
+//					is empty.
+//*********************************************************************
+#ifndef BLOCKING_PQUEUE_20261018_H
+#define BLOCKING_PQUEUE_20261018_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! Responsible for handing items between threads in order of priority,
+	//! "largest" first, holding at most a fixed number of them.
+	//!
+	//! Closing the queue stops further pushes; consumers keep popping what
+	//! is left and are told the queue is finished once it is empty. Waiting
+	//! threads are counted so that a push or pop only signals a condition
+	//! variable when somebody is blocked on it.
+	template <class T>
+	class CBlockingPqueue
+	{
+	public:
+		typedef typename CHeap<T>::ISortOrderPtr ISortOrderPtr;	//!< typedef for a sort order for T
+
+		//************************************************************************
+		//! @param[in] sortOrder
+		//!   how to sort the queued items
+		//! @param[in] capacity
+		//!   most items queued at once, at least 1
+		//!************************************************************************
+		CBlockingPqueue(const ISortOrderPtr& sortOrder, std::size_t capacity) :
+		  m_heap(sortOrder),
+		  m_capacity(capacity > 0 ? capacity : 1),
+		  m_isClosed(false),
+		  m_numWaitingProducers(0),
+		  m_numWaitingConsumers(0)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Queue an item, waiting while the queue is full
+		//!
+		//! @param[in] newItem
+		//!   item to queue
+		//!
+		//! @return bool
+		//!   false if the queue is closed, the item is not queued
+		//!************************************************************************
+		bool Push(const T& newItem)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_isClosed && m_heap.GetSize() >= m_capacity)
+			{
+				++m_numWaitingProducers;
+				m_notFull.wait(lock);
+				--m_numWaitingProducers;
+			}
+			return InsertLocked(newItem);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Queue an item if there is room, without waiting
+		//!
+		//! @return bool
+		//!   false if the queue is full or closed, the item is not queued
+		//!************************************************************************
+		bool TryPush(const T& newItem)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_heap.GetSize() >= m_capacity)
+			{
+				return false;
+			}
+			return InsertLocked(newItem);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove the highest priority item, waiting while the queue is
+		//!  empty and open
+		//!
+		//! @param[out] item
+		//!   receives the item
+		//!
+		//! @return bool
+		//!   false if the queue is closed and empty, item is untouched
+		//!************************************************************************
+		bool PopFront(T& item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_isClosed && m_heap.GetSize() == 0)
+			{
+				++m_numWaitingConsumers;
+				m_notEmpty.wait(lock);
+				--m_numWaitingConsumers;
+			}
+			return PopLocked(item);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove the highest priority item, waiting at most timeout for one
+		//!
+		//! @param[out] item
+		//!   receives the item
+		//! @param[in] timeout
+		//!   longest time to wait
+		//!
+		//! @return bool
+		//!   false if the time ran out or the queue is closed and empty
+		//!************************************************************************
+		template <class Rep, class Period>
+		bool PopFrontFor(T& item, const std::chrono::duration<Rep, Period>& timeout)
+		{
+			const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_isClosed && m_heap.GetSize() == 0)
+			{
+				++m_numWaitingConsumers;
+				const std::cv_status status = m_notEmpty.wait_until(lock, deadline);
+				--m_numWaitingConsumers;
+				if (status == std::cv_status::timeout)
+				{
+					break;
+				}
+			}
+			return PopLocked(item);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove up to maxItems of the highest priority items under a single
+		//!  acquisition of the lock, waiting while the queue is empty and open
+		//!
+		//! @param[out] items
+		//!   receives the items, highest priority first. Any previous contents
+		//!  are discarded.
+		//! @param[in] maxItems
+		//!   most items to remove
+		//!
+		//! @return std::size_t
+		//!   number of items removed, 0 only if the queue is closed and empty
+		//!************************************************************************
+		std::size_t PopBatch(std::vector<T>& items, std::size_t maxItems)
+		{
+			items.clear();
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_isClosed && m_heap.GetSize() == 0)
+			{
+				++m_numWaitingConsumers;
+				m_notEmpty.wait(lock);
+				--m_numWaitingConsumers;
+			}
+			while (items.size() < maxItems && m_heap.GetSize() > 0)
+			{
+				items.push_back(m_heap.PeekTop());
+				m_heap.PopTop();
+			}
+			NotifyProducers(items.size());
+			return items.size();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Stop accepting items. Blocked producers give up, consumers get the
+		//!  items still queued and then find the queue finished.
+		//!************************************************************************
+		void Close()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isClosed = true;
+			m_notFull.notify_all();
+			m_notEmpty.notify_all();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Take every queued item without waiting
+		//!
+		//! @param[out] items
+		//!   receives the items in no particular order. Any previous contents
+		//!  are discarded.
+		//!************************************************************************
+		void Drain(std::vector<T>& items)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const std::size_t numItems = m_heap.GetSize();
+			m_heap.ReleaseItems(items);
+			NotifyProducers(numItems);
+		}
+
+		//! @return std::size_t
+		//!   number of queued items
+		std::size_t GetSize() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_heap.GetSize();
+		}
+
+		//! @return bool
+		//!   true once Close has been called
+		bool IsClosed() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_isClosed;
+		}
+
+		CBlockingPqueue(const CBlockingPqueue&) = delete;
+		CBlockingPqueue& operator=(const CBlockingPqueue&) = delete;
+
+	private:
+		mutable std::mutex m_mutex;				//!< guards everything below
+		std::condition_variable m_notFull;		//!< signalled when room is made or the queue closes
+		std::condition_variable m_notEmpty;		//!< signalled when items arrive or the queue closes
+		CHeap<T> m_heap;						//!< queued items
+		std::size_t m_capacity;					//!< most items queued at once
+		bool m_isClosed;						//!< no more items will be queued
+		std::size_t m_numWaitingProducers;		//!< threads blocked on m_notFull
+		std::size_t m_numWaitingConsumers;		//!< threads blocked on m_notEmpty
+
+		//! Insert with the lock held, waking a consumer if one is waiting
+		bool InsertLocked(const T& newItem)
+		{
+			if (m_isClosed)
+			{
+				return false;
+			}
+			m_heap.Insert(newItem);
+			if (m_numWaitingConsumers > 0)
+			{
+				m_notEmpty.notify_one();
+			}
+			return true;
+		}
+
+		//! Pop the top with the lock held, waking a producer if one is waiting
+		bool PopLocked(T& item)
+		{
+			if (m_heap.GetSize() == 0)
+			{
+				return false;
+			}
+			item = m_heap.PeekTop();
+			m_heap.PopTop();
+			NotifyProducers(1);
+			return true;
+		}
+
+		//! Wake as many waiting producers as there are new free slots
+		void NotifyProducers(std::size_t numFreed)
+		{
+			if (numFreed == 0 || m_numWaitingProducers == 0)
+			{
+				return;
+			}
+			if (numFreed == 1)
+			{
+				m_notFull.notify_one();
+			}
+			else
+			{
+				m_notFull.notify_all();
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,130 @@
+//********************************************************************
+//  FILE NAME:      BoundedBuffer.h
+//
+//  DESCRIPTION:    Bounded single-producer single-consumer buffer
+//					for handing batches of items between threads
+//*********************************************************************
+#ifndef BOUNDED_BUFFER_20261018_H
+#define BOUNDED_BUFFER_20261018_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace pqueue
+{
+	//! Responsible for passing items from a producer thread to a consumer
+	//! thread in order. The producer blocks while the buffer holds
+	//! capacity items, the consumer blocks while it is empty. Items move in
+	//! batches so the lock is taken once per batch rather than per item.
+	template <class T>
+	class CBoundedBuffer
+	{
+	public:
+		//************************************************************************
+		//! @param[in] capacity
+		//!   number of items the buffer holds before the producer waits. A
+		//!  larger batch is still accepted once the buffer is empty.
+		//!************************************************************************
+		explicit CBoundedBuffer(std::size_t capacity) :
+		  m_capacity(capacity),
+		  m_isClosed(false),
+		  m_isAborted(false)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Append a batch of items, waiting for room first
+		//!
+		//! @param[in,out] batch
+		//!   items to append, emptied by this function
+		//!
+		//! @return bool
+		//!   false if the buffer was aborted, the batch is then dropped
+		//!************************************************************************
+		bool PushBatch(std::vector<T>& batch)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_isAborted && !m_items.empty() && m_items.size() + batch.size() > m_capacity)
+			{
+				m_notFull.wait(lock);
+			}
+			if (m_isAborted)
+			{
+				batch.clear();
+				return false;
+			}
+			if (m_items.empty())
+			{
+				m_items.swap(batch);
+			}
+			else
+			{
+				m_items.insert(m_items.end(), batch.begin(), batch.end());
+			}
+			batch.clear();
+			m_notEmpty.notify_one();
+			return true;
+		}
+
+		//! Tell the consumer no more items are coming
+		void Close()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isClosed = true;
+			m_notEmpty.notify_one();
+		}
+
+		//! Make the producer drop everything from now on, eg. when the
+		//! consumer gives up
+		void Abort()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isAborted = true;
+			m_notFull.notify_one();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Take every item in the buffer, waiting for some first
+		//!
+		//! @param[out] batch
+		//!   receives the items in the order they were pushed. Any previous
+		//!  contents are discarded.
+		//!
+		//! @return bool
+		//!   false once the buffer is closed and has been emptied
+		//!************************************************************************
+		bool PopBatch(std::vector<T>& batch)
+		{
+			batch.clear();
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_items.empty() && !m_isClosed)
+			{
+				m_notEmpty.wait(lock);
+			}
+			if (m_items.empty())
+			{
+				return false;
+			}
+			m_items.swap(batch);
+			m_notFull.notify_one();
+			return true;
+		}
+
+		CBoundedBuffer(const CBoundedBuffer&) = delete;
+		CBoundedBuffer& operator=(const CBoundedBuffer&) = delete;
+
+	private:
+		std::mutex m_mutex;						//!< guards everything below
+		std::condition_variable m_notFull;		//!< signalled when the consumer takes items
+		std::condition_variable m_notEmpty;		//!< signalled when items arrive or the buffer closes
+		std::vector<T> m_items;					//!< items pushed and not yet taken
+		std::size_t m_capacity;					//!< items held before the producer waits
+		bool m_isClosed;						//!< the producer is done
+		bool m_isAborted;						//!< the consumer is done
+	};
+}
+
+#endif
@@ -10,10 +10,9 @@
 #ifndef COMPLETE_TREE_20100810_H
 #define COMPLETE_TREE_20100810_H
 
+#include <cstdint>
+#include <utility>
 #include <vector>
-#include <boost/shared_ptr.hpp>
-#include <boost/weak_ptr.hpp>
-#include <boost/cstdint.hpp>
 
 #include "CompleteTreeIndex.h"
 
@@ -25,8 +24,12 @@ namespace pqueue
 	//! size N have the same layout. Trees are built up left-to-right on
 	//! the current level until that level is filled. Then the next level
 	//! will begin to be filled in left-to-right
+	//!
+	//! The tree owns its array directly and is move only. Like iterators of
+	//! the standard containers, an Iterator must not outlive its tree or be
+	//! used after the tree is moved.
 	template <class T>
-	class CCompleteTree  : public boost::noncopyable
+	class CCompleteTree
 	{
 	public:
 
@@ -35,12 +38,10 @@ namespace pqueue
 		class Iterator
 		{
 		private:
-			// noncopyable
-			boost::weak_ptr< std::vector<T> > m_parentTree;	//!< Access to the parent's tree
+			std::vector<T>* m_parentTree;					//!< The parent's tree
 			CCompleteTreeIndex m_locationInTree;			//!< Where I am in the tree
 		public:
 			//! Exceptions encountered while traversing the tree	   
-			class CIteratorInvalid {};
 			class COutOfBounds {};
 
 			//************************************************************************
@@ -53,7 +54,7 @@ namespace pqueue
 			//!    the location of this iterator in the tree
 			//! 
 			//!************************************************************************
-			Iterator(const boost::weak_ptr< std::vector<T> >& parentTree, 
+			Iterator(std::vector<T>* parentTree, 
 				const CCompleteTreeIndex& locationInTree) : 
 			  m_parentTree(parentTree),
 			  m_locationInTree(locationInTree)
@@ -74,16 +75,8 @@ namespace pqueue
 			//!************************************************************************
 			bool operator ==(const Iterator& lhs) const
 			{
-				if (lhs.m_locationInTree.GetCurrentLocationInArray() == m_locationInTree.GetCurrentLocationInArray())
-				{
-					boost::shared_ptr<std::vector<T>> lhsTreePtr = lhs.m_parentTree.lock();
-					boost::shared_ptr<std::vector<T>> thisTreePtr = m_parentTree.lock();
-					if (lhsTreePtr == thisTreePtr)
-					{
-						return true;
-					}
-				}
-				return false;
+				return lhs.m_locationInTree.GetCurrentLocationInArray() == m_locationInTree.GetCurrentLocationInArray() &&
+					lhs.m_parentTree == m_parentTree;
 
 			}
 
@@ -120,25 +113,24 @@ namespace pqueue
 				m_locationInTree.MoveToParent();
 			}
 
+			//************************************************************************
+			//! @return std::uint32_t
+			//!   the level of the tree this iterator points at, the root is on
+			//!  level 0
+			//!************************************************************************
+			std::uint32_t GetDepth() const
+			{
+				return m_locationInTree.GetDepth();
+			}
+
 			//************************************************************************
 			//! @return bool
 			//!   true if this iterator is within the bounds of the tree, false if
 			//! we've wandered off the tree
-			//!
-			//! @throw
-			//!   CIteratorInvalid if we are an iterator for a deleted tree
 			//!************************************************************************
 			bool IsStillInTree() const
 			{
-				boost::shared_ptr< std::vector<T> > parentTree = m_parentTree.lock();
-				if (parentTree)
-				{
-					return (m_locationInTree.GetCurrentLocationInArray() < parentTree->size());
-				}
-				else
-				{
-					throw CIteratorInvalid();
-				}
+				return (m_locationInTree.GetCurrentLocationInArray() < m_parentTree->size());
 			}
 
 			
@@ -149,15 +141,12 @@ namespace pqueue
 			//!   Data pointed at by this iterator
 			//! @throw
 			//!   COutOfBounds if this iterator is outside the bounds of the tree
-			//!   CIteratorInvalid if this iterator is pointing into a tree that
-			//!    no longer exists. Thrown by IsStillInTree()
 			//!************************************************************************
 			const T& GetValue() const
 			{
-				boost::shared_ptr< std::vector<T> > parentTree = m_parentTree.lock();
 				if (IsStillInTree())
 				{
-					return (*parentTree)[m_locationInTree.GetCurrentLocationInArray()];
+					return (*m_parentTree)[m_locationInTree.GetCurrentLocationInArray()];
 				}
 				else
 				{
@@ -175,15 +164,54 @@ namespace pqueue
 			//!
 			//! @throw
 			//!   COutOfBounds if outside the bounds of the tree
-			//!   CIteratorInvalid if this iterator is pointing into a tree that
-			//!    no longer exists. Thrown by IsStillInTree.
 			//!************************************************************************
 			void SetValue(const T& val)
 			{
-				boost::shared_ptr< std::vector<T> > parentTree = m_parentTree.lock();
 				if (IsStillInTree())
 				{
-					(*parentTree)[m_locationInTree.GetCurrentLocationInArray()] = val;
+					(*m_parentTree)[m_locationInTree.GetCurrentLocationInArray()] = val;
+				}
+				else
+				{
+					throw COutOfBounds();
+				}
+			}
+
+			//************************************************************************
+			//! @details
+			//!  Move the value pointed at by this iterator into destination,
+			//! leaving the node holding a moved from value
+			//!
+			//! @throw
+			//!   COutOfBounds if outside the bounds of the tree
+			//!************************************************************************
+			void MoveValueInto(T& destination)
+			{
+				if (IsStillInTree())
+				{
+					destination = std::move((*m_parentTree)[m_locationInTree.GetCurrentLocationInArray()]);
+				}
+				else
+				{
+					throw COutOfBounds();
+				}
+			}
+
+			//************************************************************************
+			//! @details
+			//!  Exchange the value pointed at by this iterator with the one
+			//! pointed at by other, with std::swap so neither is copied
+			//!
+			//! @throw
+			//!   COutOfBounds if either is outside the bounds of the tree
+			//!************************************************************************
+			void SwapValue(Iterator& other)
+			{
+				if (IsStillInTree() && other.IsStillInTree())
+				{
+					using std::swap;
+					swap((*m_parentTree)[m_locationInTree.GetCurrentLocationInArray()],
+						(*other.m_parentTree)[other.m_locationInTree.GetCurrentLocationInArray()]);
 				}
 				else
 				{
@@ -196,7 +224,7 @@ namespace pqueue
 		//! @details
 		//!   Construct a new complete tree.
 		//!************************************************************************
-		CCompleteTree() : m_tree(new std::vector<T>) {}
+		CCompleteTree() {}
 
 
 		//************************************************************************
@@ -205,6 +233,12 @@ namespace pqueue
 		//!************************************************************************
 		~CCompleteTree() {}
 
+		//! Move only, the nodes are never copied with the tree
+		CCompleteTree(const CCompleteTree&) = delete;
+		CCompleteTree& operator=(const CCompleteTree&) = delete;
+		CCompleteTree(CCompleteTree&&) = default;
+		CCompleteTree& operator=(CCompleteTree&&) = default;
+
 
 		//************************************************************************
 		//! @details
@@ -216,7 +250,7 @@ namespace pqueue
 		Iterator GetRootNode() const
 		{
 			const CCompleteTreeIndex rootNodeLocation(0);
-			Iterator rVal(m_tree, rootNodeLocation);
+			Iterator rVal(GetArray(), rootNodeLocation);
 			return rVal;
 		}
 
@@ -231,8 +265,27 @@ namespace pqueue
 		//!************************************************************************
 		Iterator GetLastNode() const
 		{
-			const CCompleteTreeIndex lastInsertedNodeLocationInVector(m_tree->size() - 1);
-			Iterator rVal(m_tree, lastInsertedNodeLocationInVector);
+			const CCompleteTreeIndex lastInsertedNodeLocationInVector(m_tree.size() - 1);
+			Iterator rVal(GetArray(), lastInsertedNodeLocationInVector);
+			return rVal;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Access an iterator to any node by its position in the array
+		//!  representation, where a node's children follow all nodes on its
+		//!  level
+		//!
+		//! @param[in] arrayIndex
+		//!   0-based index of the node, the root is 0
+		//!
+		//! @return Iterator
+		//!   Iterator pointing at that node
+		//!************************************************************************
+		Iterator GetNodeAt(std::uint32_t arrayIndex) const
+		{
+			const CCompleteTreeIndex nodeLocation(arrayIndex);
+			Iterator rVal(GetArray(), nodeLocation);
 			return rVal;
 		}
 
@@ -250,7 +303,7 @@ namespace pqueue
 		{
 			if (GetSize() > 0)
 			{
-				m_tree->pop_back();
+				m_tree.pop_back();
 			}
 			else
 			{
@@ -270,7 +323,13 @@ namespace pqueue
 		//!************************************************************************
 		void Append(const T& val)
 		{
-			m_tree->push_back(val);
+			m_tree.push_back(val);
+		}
+
+		//! Append val, moving from it
+		void Append(T&& val)
+		{
+			m_tree.push_back(std::move(val));
 		}
 
 		//************************************************************************
@@ -282,11 +341,57 @@ namespace pqueue
 		//!************************************************************************
 		std::size_t GetSize() const
 		{
-			return m_tree->size();
+			return m_tree.size();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Exchange the array representation of this tree with the contents
+		//!  of other. No elements are copied.
+		//!
+		//! @param[in,out] other
+		//!   array to swap with. After this function it holds the nodes of this
+		//!  tree in array order, and this tree holds other's previous contents
+		//!************************************************************************
+		void SwapContents(std::vector<T>& other)
+		{
+			m_tree.swap(other);
+		}
+
+		//************************************************************************
+		//! @return std::size_t
+		//!   Number of nodes the tree can hold before its storage has to grow
+		//!************************************************************************
+		std::size_t GetCapacity() const
+		{
+			return m_tree.capacity();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Call function with every node's value in array order
+		//!
+		//! @param[in] function
+		//!   called as function(const T&) once per node
+		//!************************************************************************
+		template <class Function>
+		void ForEach(Function function) const
+		{
+			for (typename std::vector<T>::const_iterator currNode = m_tree.begin(); currNode != m_tree.end(); ++currNode)
+			{
+				function(*currNode);
+			}
 		}
 
 	private:	
-		boost::shared_ptr<std::vector<T>> m_tree;		//!< array representation of the tree
+		std::vector<T> m_tree;		//!< array representation of the tree
+
+		//! The array for iterators, which can change nodes even when handed
+		//! out by a const tree, as they always could
+		std::vector<T>* GetArray() const
+		{
+			return const_cast< std::vector<T>* >(&m_tree);
+		}
 
 	};
 }
@@ -8,7 +8,8 @@
 #ifndef COMPLETE_TREE_INDEX_20100811_H
 #define COMPLETE_TREE_INDEX_20100811_H
 
-#include <boost/cstdint.hpp>
+#include <assert.h>
+#include <cstdint>
 
 namespace pqueue
 {
@@ -19,11 +20,11 @@ namespace pqueue
 	{
 	public:
 		//! Construct a complete tree ind
-		CCompleteTreeIndex(const boost::uint32_t& arrayIndex);
+		CCompleteTreeIndex(const std::uint32_t& arrayIndex);
 		~CCompleteTreeIndex();
 
 		//! Return the index into the complete tree's array 
-		boost::uint32_t GetCurrentLocationInArray() const;
+		std::uint32_t GetCurrentLocationInArray() const;
 
 		//! Change this index to be the index where it's left child would be
 		void MoveToLeft();
@@ -33,11 +34,95 @@ namespace pqueue
 
 		//! Change this index to be the index where it's parent would be
 		void MoveToParent();
+
+		//! Return the level of this index in the tree, the root is on level 0
+		std::uint32_t GetDepth() const;
 	private:
-		boost::uint32_t m_oneBasedIndex;		//! The index in the complete tree's ( internally stored as a 1-based index)
+		std::uint32_t m_oneBasedIndex;		//! The index in the complete tree's ( internally stored as a 1-based index)
 
 
 	};
+
+	//************************************************************************
+	//! @details
+	//!   Constructor of the complete tree index.
+	//!
+	//! @param[in] arrayIndex
+	//!   Index into an array representing the complete tree
+	//!************************************************************************
+	inline CCompleteTreeIndex::CCompleteTreeIndex(const std::uint32_t& arrayIndex) : 
+		m_oneBasedIndex(arrayIndex + 1)
+	{
+	}
+
+
+	//************************************************************************
+	//! @details
+	//!   Destructor for the complete tree
+	//!************************************************************************
+	inline CCompleteTreeIndex::~CCompleteTreeIndex()
+	{
+
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Access the integer array index corresponding to the location of
+	//! this index in the tree.
+	//! 
+	//! @return std::uint32_t
+	//!  0-based array index
+	//!************************************************************************
+	inline std::uint32_t CCompleteTreeIndex::GetCurrentLocationInArray() const
+	{
+		assert(m_oneBasedIndex != 0); // its one based, this should never happen
+		return m_oneBasedIndex - 1;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Set this index to be the index of it's left child
+	//!************************************************************************
+	inline void CCompleteTreeIndex::MoveToLeft()
+	{
+		m_oneBasedIndex *= 2;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Set this index to be the index of it's right child
+	//!************************************************************************
+	inline void CCompleteTreeIndex::MoveToRight()
+	{
+		m_oneBasedIndex *= 2;
+		++m_oneBasedIndex;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Set this index to be the index of it's parent
+	//!************************************************************************
+	inline void CCompleteTreeIndex::MoveToParent()
+	{
+		m_oneBasedIndex /= 2;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Determine which level of the tree this index is on
+	//!
+	//! @return std::uint32_t
+	//!  number of steps from the root to this index, 0 for the root
+	//!************************************************************************
+	inline std::uint32_t CCompleteTreeIndex::GetDepth() const
+	{
+		std::uint32_t depth = 0;
+		for (std::uint32_t index = m_oneBasedIndex; index > 1; index /= 2)
+		{
+			++depth;
+		}
+		return depth;
+	}
 }
 
 #endif
\ No newline at end of file
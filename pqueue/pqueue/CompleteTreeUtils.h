@@ -11,6 +11,10 @@
 
 #include "CompleteTree.h"
 
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+
 namespace pqueue 
 {
 
@@ -31,17 +35,9 @@ namespace pqueue
 	{
 		if (iter1.IsStillInTree() && iter2.IsStillInTree())
 		{
-			T bestT = std::max<T>(iter1.GetValue(), iter2.GetValue(), compPred);
-			// use the predicate to determine equality
-			bool isEqual = !(compPred(bestT, iter1.GetValue()) || compPred(iter1.GetValue(), bestT));
-			if (isEqual)
-			{
-				return iter1;
-			}
-			else
-			{
-				return iter2;
-			}
+			// ties go to iter1. Compared in place, std::max would copy the
+			// predicate and the winning value
+			return compPred(iter1.GetValue(), iter2.GetValue()) ? iter2 : iter1;
 		}
 		else if (iter1.IsStillInTree())
 		{
@@ -92,9 +88,28 @@ namespace pqueue
 	template <class T>
 	void SwapNodeValues(typename CCompleteTree<T>::Iterator& iter1, typename CCompleteTree<T>::Iterator& iter2)
 	{
-		T temp = iter1.GetValue();
-		iter1.SetValue(iter2.GetValue());
-		iter2.SetValue(temp);
+		iter1.SwapValue(iter2);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Hint that the node at iter is about to be read so its cache line
+	//!  can be loaded while other work is done. Nodes off the tree are
+	//!  ignored.
+	//!
+	//! @param[in] iter - node to prefetch
+	//!************************************************************************
+	template <class T>
+	void PrefetchNode(const typename CCompleteTree<T>::Iterator& iter)
+	{
+		if (iter.IsStillInTree())
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(&iter.GetValue());
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+			_mm_prefetch(reinterpret_cast<const char*>(&iter.GetValue()), _MM_HINT_T0);
+#endif
+		}
 	}
 
 }
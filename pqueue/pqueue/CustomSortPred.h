@@ -8,6 +8,9 @@
 #ifndef CUSTOM_SORT_PRED_20100814_H
 #define CUSTOM_SORT_PRED_20100814_H
 
+#include "HeapStats.h"
+#include <memory>
+
 namespace pqueue
 {
 
@@ -19,8 +22,42 @@ namespace pqueue
 		//! What the heap uses to determine what is "larger" so if lhs < rhs, rhs will
 		//! appear higher up in the heap
 		virtual bool LessThan(const T& lhs, const T& rhs) const = 0;
+
+		//************************************************************************
+		//! @details
+		//!   Three-way comparison of lhs and rhs. Override this when the order
+		//!  can be decided in one pass (eg. std::string::compare), otherwise it
+		//!  is answered with up to two calls to LessThan.
+		//!
+		//! @param[in] lhs - lhs of the comparison
+		//! @param[in] rhs - rhs of the comparison
+		//!
+		//! @return int
+		//!   negative if lhs < rhs, positive if rhs < lhs, 0 if they are equal
+		//!************************************************************************
+		virtual int Compare(const T& lhs, const T& rhs) const
+		{
+			if (LessThan(lhs, rhs))
+			{
+				return -1;
+			}
+			return LessThan(rhs, lhs) ? 1 : 0;
+		}
 	};
 
+	//************************************************************************
+	//! @details
+	//!   Three-way comparison of two values using operator<
+	//!
+	//! @return int
+	//!   negative if lhs < rhs, positive if rhs < lhs, 0 otherwise
+	//!************************************************************************
+	template <class T>
+	int ThreeWayCompare(const T& lhs, const T& rhs)
+	{
+		return static_cast<int>(rhs < lhs) - static_cast<int>(lhs < rhs);
+	}
+
 	// Wrapper for the above interface to use in templates such
 	// as std::max, etc. By default these won't work through a virtual interface
 	// because they pass the predicate by value, not by reference
@@ -28,8 +65,11 @@ namespace pqueue
 	class CWrappedCustomSortPred
 	{
 	private:
-		typedef boost::shared_ptr< ISortOrder<T> > ISortOrderPtr;
+		typedef std::shared_ptr< ISortOrder<T> > ISortOrderPtr;
 		ISortOrderPtr m_customizedSort;	//!< wrapped sort
+#ifdef PQUEUE_ENABLE_STATS
+		std::uint64_t* m_comparisonCounter;	//!< counts calls when not NULL
+#endif
 	public:
 		//************************************************************************
 		//! @details
@@ -41,7 +81,17 @@ namespace pqueue
 		CWrappedCustomSortPred(const ISortOrderPtr& customSort) : 
 		  m_customizedSort(customSort)
 		{
+			PQUEUE_STATS(m_comparisonCounter = NULL);
+		}
+
+#ifdef PQUEUE_ENABLE_STATS
+		//! Count every comparison made through this predicate (and its
+		//! copies) in counter, NULL to stop counting
+		void SetComparisonCounter(std::uint64_t* counter)
+		{
+			m_comparisonCounter = counter;
 		}
+#endif
 
 		//************************************************************************
 		//! @details
@@ -66,6 +116,7 @@ namespace pqueue
 		//!************************************************************************
 		bool operator()(const T& lhs, const T& rhs) const
 		{
+			PQUEUE_STATS(if (m_comparisonCounter) { ++*m_comparisonCounter; });
 			return m_customizedSort->LessThan(lhs, rhs);
 		}
 	};
@@ -0,0 +1,113 @@
+//********************************************************************
+//  FILE NAME:      DoubleEndedPqueue.h
+//
+//  DESCRIPTION:    Implementation of a double-ended priority queue,
+//					one that can be served from either end
+//*********************************************************************
+#ifndef DOUBLE_ENDED_PQUEUE_20261018_H
+#define DOUBLE_ENDED_PQUEUE_20261018_H
+
+#include <utility>
+#include <vector>
+
+#include "MinMaxHeap.h"
+
+namespace pqueue
+{
+	//! Class responsible for keeping elements in a queue in order of
+	//! priority, giving access to both the highest priority element (the
+	//! front, as in CPqueue) and the lowest priority element (the back).
+	//! A bounded queue can evict its back when it is full.
+	template <class T>
+	class CDoubleEndedPqueue
+	{
+	public:
+		typedef typename CMinMaxHeap<T>::ISortOrderPtr ISortOrderPtr;	//!< typedef for a sort order for T
+
+		//************************************************************************
+		//! @details
+		//!   Construct a double-ended priority queue with an initial sort order
+		//! @param[in] sortOrder
+		//!    how to sort the queued elements, the "largest" is at the front
+		//!************************************************************************
+		CDoubleEndedPqueue(const ISortOrderPtr& sortOrder) :
+		  m_heap(sortOrder)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Place a new item in line based on the current sort order
+		//!
+		//! @param[in] newItem
+		//!   item to queue
+		//!************************************************************************
+		void Push(const T& newItem)
+		{
+			m_heap.Insert(newItem);
+		}
+
+		//! Look at the highest priority element
+		const T& PeekFront() const
+		{
+			return m_heap.PeekMax();
+		}
+
+		//! Remove the highest priority element
+		void PopFront()
+		{
+			m_heap.PopMax();
+		}
+
+		//! Look at the lowest priority element
+		const T& PeekBack() const
+		{
+			return m_heap.PeekMin();
+		}
+
+		//! Remove the lowest priority element
+		void PopBack()
+		{
+			m_heap.PopMin();
+		}
+
+		//************************************************************************
+		//! @return std::size_t
+		//!    number of queued elements
+		//!************************************************************************
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Rearrange the elements based on the new sort order
+		//!
+		//! @param[in] sortOrder
+		//!		new sort order to apply
+		//!************************************************************************
+		void ChangeSortOrder(const ISortOrderPtr& sortOrder)
+		{
+			std::vector<T> items;
+			m_heap.ReleaseItems(items);
+			CMinMaxHeap<T> newHeap(sortOrder);
+			for (typename std::vector<T>::const_iterator currItem = items.begin(); currItem != items.end(); ++currItem)
+			{
+				newHeap.Insert(*currItem);
+			}
+			m_heap = std::move(newHeap);
+		}
+
+		//! Move only, the queued items are never copied with it
+		CDoubleEndedPqueue(const CDoubleEndedPqueue&) = delete;
+		CDoubleEndedPqueue& operator=(const CDoubleEndedPqueue&) = delete;
+		CDoubleEndedPqueue(CDoubleEndedPqueue&&) = default;
+		CDoubleEndedPqueue& operator=(CDoubleEndedPqueue&&) = default;
+
+	private:
+		CMinMaxHeap<T> m_heap;					//!< min-max heap in charge of the queue
+	};
+}
+
+#endif
@@ -0,0 +1,405 @@
+//********************************************************************
+//  FILE NAME:      EvictionCache.h
+//
+//  DESCRIPTION:    Bounded cache that evicts by a priority policy.
+//					Entries are found through a hash map and ordered
+//					by an indexed heap: each entry has exactly one heap
+//					node and knows where it is, so a hit re-sifts the
+//					entry in place instead of pushing a duplicate that
+//					has to be discarded later.
+//*********************************************************************
+#ifndef EVICTION_CACHE_20261018_H
+#define EVICTION_CACHE_20261018_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "CompleteTree.h"
+
+namespace pqueue
+{
+	//! What an eviction policy knows about an entry
+	struct CCacheEntryStats
+	{
+		std::uint64_t numHits;		//!< Gets since the entry was put
+		double cost;				//!< cost of recomputing the value, given to Put
+		std::uint64_t expiryTime;	//!< tick the entry expires at, CACHE_NEVER_EXPIRES for none
+	};
+
+	//! Expiry time of an entry put without a time to live
+	const std::uint64_t CACHE_NEVER_EXPIRES = std::numeric_limits<std::uint64_t>::max();
+
+	//! Interface for choosing which cache entry to evict. Like ISortOrder
+	//! it only ranks entries; the cache does the bookkeeping.
+	class IEvictionPolicy
+	{
+	public:
+		virtual ~IEvictionPolicy() {}
+
+		//! @return double
+		//!   priority of an entry that was just put or hit. The entry with
+		//!  the lowest priority is evicted first, the least recently used
+		//!  of equals.
+		virtual double GetPriority(const CCacheEntryStats& stats) = 0;
+
+		//! Called with the priority of each entry evicted to make room
+		virtual void OnEvicted(double /*priority*/) {}
+	};
+
+	//! Least frequently used: the entry with the fewest hits goes first
+	class CLfuEvictionPolicy : public IEvictionPolicy
+	{
+	public:
+		double GetPriority(const CCacheEntryStats& stats)
+		{
+			return static_cast<double>(stats.numHits);
+		}
+	};
+
+	//! GreedyDual: an entry's priority is its cost plus an inflation that
+	//! rises to the priority of each evicted entry, so cheap entries go
+	//! first but expensive ones age out once they stop being hit. Pass
+	//! cost / size to Put for GreedyDual-Size.
+	class CGreedyDualEvictionPolicy : public IEvictionPolicy
+	{
+	public:
+		CGreedyDualEvictionPolicy() : m_inflation(0.0) {}
+
+		double GetPriority(const CCacheEntryStats& stats)
+		{
+			return m_inflation + stats.cost;
+		}
+
+		void OnEvicted(double priority)
+		{
+			m_inflation = priority;
+		}
+
+	private:
+		double m_inflation;		//!< priority of the last evicted entry
+	};
+
+	//! The entry that expires soonest goes first, each hit counting as
+	//! hitWeight ticks of extra lifetime. Entries without a time to live
+	//! go last.
+	class CTtlWeightedEvictionPolicy : public IEvictionPolicy
+	{
+	public:
+		explicit CTtlWeightedEvictionPolicy(double hitWeight = 0.0) : m_hitWeight(hitWeight) {}
+
+		double GetPriority(const CCacheEntryStats& stats)
+		{
+			if (stats.expiryTime == CACHE_NEVER_EXPIRES)
+			{
+				return std::numeric_limits<double>::infinity();
+			}
+			return static_cast<double>(stats.expiryTime) + m_hitWeight * static_cast<double>(stats.numHits);
+		}
+
+	private:
+		double m_hitWeight;		//!< ticks of lifetime a hit is worth
+	};
+
+	//! Responsible for holding at most capacity values by key, evicting the
+	//! lowest priority entry to make room for a new one. Put, Get, Erase and
+	//! eviction are O(log n) and the heap never holds more nodes than there
+	//! are entries.
+	//!
+	//! Time is in ticks advanced by the owner with AdvanceTime. An entry
+	//! past its expiry time is a miss and is removed when looked up.
+	template <class Key, class Value, class Hash = std::hash<Key> >
+	class CEvictionCache
+	{
+	public:
+		typedef std::shared_ptr<IEvictionPolicy> IEvictionPolicyPtr;	//!< shared like ISortOrderPtr
+
+		//************************************************************************
+		//! @param[in] capacity
+		//!   most entries held at once, at least 1
+		//! @param[in] policy
+		//!   ranks entries for eviction
+		//! @param[in] startTime
+		//!   current time of the cache
+		//!************************************************************************
+		CEvictionCache(std::size_t capacity, const IEvictionPolicyPtr policy, std::uint64_t startTime = 0) :
+		  m_capacity(capacity > 0 ? capacity : 1),
+		  m_policy(policy),
+		  m_currentTime(startTime),
+		  m_nextSequence(0),
+		  m_numEvictions(0)
+		{
+			m_slotByKey.reserve(m_capacity);
+			m_entries.reserve(m_capacity);
+		}
+
+		//! Move only, like the heaps it is built on
+		CEvictionCache(const CEvictionCache&) = delete;
+		CEvictionCache& operator=(const CEvictionCache&) = delete;
+		CEvictionCache(CEvictionCache&&) = default;
+		CEvictionCache& operator=(CEvictionCache&&) = default;
+
+		//************************************************************************
+		//! @details
+		//!   Insert or replace the value for key, evicting the lowest priority
+		//!  entry first if the cache is full. A replaced entry starts over
+		//!  with no hits.
+		//!
+		//! @param[in] cost
+		//!   cost of recomputing the value, for the policy
+		//! @param[in] timeToLive
+		//!   ticks from now until the entry expires, CACHE_NEVER_EXPIRES for
+		//!  never
+		//!************************************************************************
+		void Put(const Key& key, const Value& value, double cost = 1.0, std::uint64_t timeToLive = CACHE_NEVER_EXPIRES)
+		{
+			typename std::unordered_map<Key, std::uint32_t, Hash>::iterator found = m_slotByKey.find(key);
+			std::uint32_t slot = 0;
+			if (found != m_slotByKey.end())
+			{
+				slot = found->second;
+			}
+			else
+			{
+				if (m_slotByKey.size() == m_capacity)
+				{
+					const std::uint32_t victim = m_heap.GetRootNode().GetValue().slot;
+					m_policy->OnEvicted(m_heap.GetRootNode().GetValue().priority);
+					Remove(victim);
+					++m_numEvictions;
+				}
+				slot = AllocateSlot(key);
+				m_slotByKey[key] = slot;
+				m_entries[slot].heapIndex = static_cast<std::uint32_t>(m_heap.GetSize());
+				m_heap.Append(CHeapNode());
+			}
+			CEntry& entry = m_entries[slot];
+			entry.value = value;
+			entry.stats.numHits = 0;
+			entry.stats.cost = cost;
+			entry.stats.expiryTime = timeToLive >= CACHE_NEVER_EXPIRES - m_currentTime ? CACHE_NEVER_EXPIRES : m_currentTime + timeToLive;
+			Reprioritize(slot);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Look up key, counting a hit. An expired entry is removed.
+		//!
+		//! @return const Value*
+		//!   the value, valid until the cache is next changed, or NULL on a
+		//!  miss
+		//!************************************************************************
+		const Value* Get(const Key& key)
+		{
+			typename std::unordered_map<Key, std::uint32_t, Hash>::iterator found = m_slotByKey.find(key);
+			if (found == m_slotByKey.end())
+			{
+				return NULL;
+			}
+			const std::uint32_t slot = found->second;
+			CEntry& entry = m_entries[slot];
+			if (entry.stats.expiryTime <= m_currentTime)
+			{
+				Remove(slot);
+				return NULL;
+			}
+			++entry.stats.numHits;
+			Reprioritize(slot);
+			return &entry.value;
+		}
+
+		//! @return bool
+		//!   false if key was not cached
+		bool Erase(const Key& key)
+		{
+			typename std::unordered_map<Key, std::uint32_t, Hash>::iterator found = m_slotByKey.find(key);
+			if (found == m_slotByKey.end())
+			{
+				return false;
+			}
+			Remove(found->second);
+			return true;
+		}
+
+		//! @return const Key*
+		//!   key of the entry the next eviction would remove, valid until the
+		//!  cache is next changed, or NULL if the cache is empty
+		const Key* PeekVictim() const
+		{
+			return m_heap.GetSize() == 0 ? NULL : &m_entries[m_heap.GetRootNode().GetValue().slot].key;
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_slotByKey.size();
+		}
+
+		std::size_t GetCapacity() const
+		{
+			return m_capacity;
+		}
+
+		//! @return std::uint64_t
+		//!   entries evicted to make room, not counting expiries or erases
+		std::uint64_t GetNumEvictions() const
+		{
+			return m_numEvictions;
+		}
+
+		std::uint64_t GetCurrentTime() const
+		{
+			return m_currentTime;
+		}
+
+		//! Set the current time, times before it are ignored. Entries that
+		//! expire are removed when next looked up or evicted.
+		void AdvanceTime(std::uint64_t now)
+		{
+			if (now > m_currentTime)
+			{
+				m_currentTime = now;
+			}
+		}
+
+	private:
+		//! A heap node, ordered by priority and then by last use
+		struct CHeapNode
+		{
+			double priority;		//!< from the policy, the lowest is evicted first
+			std::uint64_t sequence;	//!< when the entry was last put or hit
+			std::uint32_t slot;		//!< the entry in m_entries
+		};
+
+		//! A cached value. Slots of removed entries are reused.
+		struct CEntry
+		{
+			Key key;					//!< key in m_slotByKey
+			Value value;				//!< the cached value
+			CCacheEntryStats stats;		//!< what the policy ranks by
+			std::uint32_t heapIndex;	//!< array index of the entry's heap node
+		};
+
+		typedef typename CCompleteTree<CHeapNode>::Iterator TreeIter_t;
+
+		std::size_t m_capacity;										//!< most entries held
+		IEvictionPolicyPtr m_policy;								//!< ranks entries
+		std::unordered_map<Key, std::uint32_t, Hash> m_slotByKey;	//!< entry slot by key
+		std::vector<CEntry> m_entries;								//!< entries by slot
+		std::vector<std::uint32_t> m_freeSlots;						//!< slots of removed entries
+		CCompleteTree<CHeapNode> m_heap;							//!< one node per entry, next victim on top
+		std::uint64_t m_currentTime;								//!< ticks, set by AdvanceTime
+		std::uint64_t m_nextSequence;								//!< sequence of the next put or hit
+		std::uint64_t m_numEvictions;								//!< see GetNumEvictions
+
+		//! @return bool
+		//!   true if lhs is evicted before rhs
+		static bool IsEvictedBefore(const CHeapNode& lhs, const CHeapNode& rhs)
+		{
+			return lhs.priority < rhs.priority || (lhs.priority == rhs.priority && lhs.sequence < rhs.sequence);
+		}
+
+		std::uint32_t AllocateSlot(const Key& key)
+		{
+			if (!m_freeSlots.empty())
+			{
+				const std::uint32_t slot = m_freeSlots.back();
+				m_freeSlots.pop_back();
+				m_entries[slot].key = key;
+				return slot;
+			}
+			CEntry entry = CEntry();
+			entry.key = key;
+			m_entries.push_back(entry);
+			return static_cast<std::uint32_t>(m_entries.size() - 1);
+		}
+
+		//! Ask the policy for the entry's priority and move its node to match
+		void Reprioritize(std::uint32_t slot)
+		{
+			CEntry& entry = m_entries[slot];
+			CHeapNode node;
+			node.priority = m_policy->GetPriority(entry.stats);
+			node.sequence = m_nextSequence++;
+			node.slot = slot;
+			PlaceNode(entry.heapIndex, node);
+		}
+
+		//! Remove the entry in slot from the map and the heap
+		void Remove(std::uint32_t slot)
+		{
+			CEntry& entry = m_entries[slot];
+			m_slotByKey.erase(entry.key);
+			m_freeSlots.push_back(slot);
+			const std::uint32_t lastIndex = static_cast<std::uint32_t>(m_heap.GetSize() - 1);
+			const CHeapNode last = m_heap.GetLastNode().GetValue();
+			m_heap.EraseLastNode();
+			if (entry.heapIndex != lastIndex)
+			{
+				PlaceNode(entry.heapIndex, last);
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Put node at index, whatever was there before, and sift it up or
+		//!  down until the heap is in order, keeping each moved entry's
+		//!  heapIndex current
+		//!************************************************************************
+		void PlaceNode(std::uint32_t index, const CHeapNode& node)
+		{
+			TreeIter_t hole = m_heap.GetNodeAt(index);
+			while (index > 0)
+			{
+				TreeIter_t parent = hole;
+				parent.GoUp();
+				if (!IsEvictedBefore(node, parent.GetValue()))
+				{
+					break;
+				}
+				MoveNode(parent, hole, index);
+				hole = parent;
+				index = (index - 1) / 2;
+			}
+			for (;;)
+			{
+				TreeIter_t child = hole;
+				child.GoLeftChild();
+				std::uint32_t childIndex = 2 * index + 1;
+				if (!child.IsStillInTree())
+				{
+					break;
+				}
+				TreeIter_t rightChild = hole;
+				rightChild.GoRightChild();
+				if (rightChild.IsStillInTree() && IsEvictedBefore(rightChild.GetValue(), child.GetValue()))
+				{
+					child = rightChild;
+					++childIndex;
+				}
+				if (!IsEvictedBefore(child.GetValue(), node))
+				{
+					break;
+				}
+				MoveNode(child, hole, index);
+				hole = child;
+				index = childIndex;
+			}
+			hole.SetValue(node);
+			m_entries[node.slot].heapIndex = index;
+		}
+
+		//! Copy the node at from into to, which is at array index toIndex
+		void MoveNode(const TreeIter_t& from, TreeIter_t& to, std::uint32_t toIndex)
+		{
+			const CHeapNode& moved = from.GetValue();
+			to.SetValue(moved);
+			m_entries[moved.slot].heapIndex = toIndex;
+		}
+	};
+}
+
+#endif
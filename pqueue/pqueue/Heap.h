@@ -11,17 +11,23 @@
 #include "CompleteTree.h"
 #include "CompleteTreeUtils.h"
 #include "CustomSortPred.h"
-#include <boost/noncopyable.hpp>
+#include "HeapStats.h"
+#include <assert.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 namespace pqueue
 {
 	//! Responsible for representing a heap and keeping the "largest" item
 	//! on top
 	template <class T>
-	class CHeap : public boost::noncopyable
+	class CHeap
 	{
 	public:
-		typedef boost::shared_ptr< ISortOrder< T > > ISortOrderPtr; //!< typedef for a sort order for T.
+		typedef std::shared_ptr< ISortOrder< T > > ISortOrderPtr; //!< typedef for a sort order for T.
 
 	public:
 		//************************************************************************
@@ -32,7 +38,42 @@ namespace pqueue
 		//!		sort order, defines how items are to be sorted. Using this the 
 		//!		"largest" item will be placed on top
 		//!************************************************************************
-		CHeap(const ISortOrderPtr sortOrder) : m_sortOrder(sortOrder)  {}
+		CHeap(const ISortOrderPtr sortOrder) : m_sortOrder(sortOrder)
+		{
+			PQUEUE_STATS(m_sortOrder.SetComparisonCounter(&m_stats.numComparisons));
+		}
+
+		//! Move only, the items are never copied with the heap
+		CHeap(const CHeap&) = delete;
+		CHeap& operator=(const CHeap&) = delete;
+
+		//************************************************************************
+		//! @details
+		//!  Take over other's items, leaving it empty with the same sort order
+		//!************************************************************************
+		CHeap(CHeap&& other) :
+		  m_tree(std::move(other.m_tree)),
+		  m_sortOrder(other.m_sortOrder)
+#ifdef PQUEUE_ENABLE_STATS
+		  , m_stats(other.m_stats)
+#endif
+		{
+			PQUEUE_STATS(m_sortOrder.SetComparisonCounter(&m_stats.numComparisons));
+		}
+
+		//************************************************************************
+		//! @details
+		//!  Replace this heap's items and sort order with other's, leaving it
+		//!  empty with the same sort order
+		//!************************************************************************
+		CHeap& operator=(CHeap&& other)
+		{
+			m_tree = std::move(other.m_tree);
+			m_sortOrder = other.m_sortOrder;
+			PQUEUE_STATS(m_stats = other.m_stats);
+			PQUEUE_STATS(m_sortOrder.SetComparisonCounter(&m_stats.numComparisons));
+			return *this;
+		}
 
 		  //************************************************************************
 		  //! @details
@@ -44,9 +85,25 @@ namespace pqueue
 		  //!************************************************************************
 		  void Insert(const T& t)
 		  {
+			  PQUEUE_STATS(const std::size_t capacityBefore = m_tree.GetCapacity());
+			  PQUEUE_STATS(const std::uint64_t swapsBefore = m_stats.numSwaps);
 			  m_tree.Append(t);
 			  TreeIter_t backOfCompleteTree = m_tree.GetLastNode();
 			  BubbleUp(backOfCompleteTree);
+			  PQUEUE_STATS(RecordInserts(1, capacityBefore));
+			  PQUEUE_STATS(m_stats.RecordSiftDepth(m_stats.numSwaps - swapsBefore));
+		  }
+
+		  //! Insert t, moving it into the heap rather than copying it
+		  void Insert(T&& t)
+		  {
+			  PQUEUE_STATS(const std::size_t capacityBefore = m_tree.GetCapacity());
+			  PQUEUE_STATS(const std::uint64_t swapsBefore = m_stats.numSwaps);
+			  m_tree.Append(std::move(t));
+			  TreeIter_t backOfCompleteTree = m_tree.GetLastNode();
+			  BubbleUp(backOfCompleteTree);
+			  PQUEUE_STATS(RecordInserts(1, capacityBefore));
+			  PQUEUE_STATS(m_stats.RecordSiftDepth(m_stats.numSwaps - swapsBefore));
 		  }
 
 		  //! Exception thrown if an empty heap is accessed
@@ -93,8 +150,126 @@ namespace pqueue
 				  TreeIter_t lastInserted = m_tree.GetLastNode();
 				  SwapNodeValues<T>(root, lastInserted);
 				  m_tree.EraseLastNode();
+				  PQUEUE_STATS(const std::uint64_t swapsBefore = ++m_stats.numSwaps);
 				  SiftDown(root);
+				  PQUEUE_STATS(++m_stats.numPops);
+				  PQUEUE_STATS(m_stats.RecordSiftDepth(m_stats.numSwaps - swapsBefore));
+			  }
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Move the top of the heap into top, then discard it as PopTop
+		  //! does, so the item is never copied
+		  //!
+		  //! @throw CCannotAccessEmptyHeap
+		  //!	if the heap is empty
+		  //!************************************************************************
+		  void PopTop(T& top)
+		  {
+			  if (m_tree.GetSize() == 0)
+			  {
+				  throw CCannotAccessEmptyHeap();
+			  }
+			  TreeIter_t root = m_tree.GetRootNode();
+			  root.MoveValueInto(top);
+			  PopTop();
+		  }
+
+		  //! A PopTop that has been started on this heap but whose sift down
+		  //! has not finished, see BeginPopTop
+		  class CPendingPop
+		  {
+		  public:
+			  bool IsDone() const
+			  {
+				  return m_isDone;
+			  }
+		  private:
+			  friend class CHeap<T>;
+			  typename CCompleteTree<T>::Iterator m_node;	//!< where the sifted item is now
+			  bool m_isDone;								//!< the heap is in order again
+			  std::uint64_t m_depth;						//!< levels sifted so far
+
+			  explicit CPendingPop(const typename CCompleteTree<T>::Iterator& node) :
+			    m_node(node),
+			    m_isDone(!node.IsStillInTree()),
+			    m_depth(0)
+			  {
+			  }
+		  };
+
+		  //************************************************************************
+		  //! @details
+		  //!    Start a PopTop that is finished one level at a time by
+		  //! ContinuePop, so the pops of several heaps can be interleaved and
+		  //! each heap's next level prefetched while the others work, see
+		  //! PopTopInterleaved. The top is discarded at once; nothing but
+		  //! ContinuePop may touch the heap until the pop is done.
+		  //!
+		  //! @return CPendingPop
+		  //!    the unfinished pop
+		  //!
+		  //! @throw CCannotAccessEmptyHeap
+		  //!************************************************************************
+		  CPendingPop BeginPopTop()
+		  {
+			  if (m_tree.GetSize() == 0)
+			  {
+				  throw CCannotAccessEmptyHeap();
 			  }
+			  TreeIter_t root = m_tree.GetRootNode();
+			  TreeIter_t lastInserted = m_tree.GetLastNode();
+			  SwapNodeValues<T>(root, lastInserted);
+			  m_tree.EraseLastNode();
+			  PQUEUE_STATS(++m_stats.numSwaps);
+			  PQUEUE_STATS(++m_stats.numPops);
+			  CPendingPop pop(root);
+			  PQUEUE_STATS(if (pop.m_isDone) m_stats.RecordSiftDepth(0));
+			  return pop;
+		  }
+
+		  //! Prefetch the nodes the next ContinuePop of pop will compare
+		  void PrefetchPendingPop(const CPendingPop& pop) const
+		  {
+			  TreeIter_t leftChild = pop.m_node;
+			  TreeIter_t rightChild = pop.m_node;
+			  leftChild.GoLeftChild();
+			  rightChild.GoRightChild();
+			  PrefetchNode<T>(leftChild);
+			  PrefetchNode<T>(rightChild);
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Sift the item of an unfinished pop down one level
+		  //!
+		  //! @param[in,out] pop
+		  //!    pop started by BeginPopTop on this heap, done once the heap is
+		  //!	in order again
+		  //!************************************************************************
+		  void ContinuePop(CPendingPop& pop)
+		  {
+			  if (pop.m_isDone)
+			  {
+				  return;
+			  }
+			  TreeIter_t parent = pop.m_node;
+			  TreeIter_t leftChild = pop.m_node;
+			  TreeIter_t rightChild = pop.m_node;
+			  leftChild.GoLeftChild();
+			  rightChild.GoRightChild();
+			  TreeIter_t biggestNode = PickLargestIterator<T>(parent, leftChild, rightChild, m_sortOrder);
+			  if (biggestNode == parent)
+			  {
+				  pop.m_isDone = true;
+				  PQUEUE_STATS(m_stats.RecordSiftDepth(pop.m_depth));
+				  return;
+			  }
+			  SwapNodeValues<T>(parent, biggestNode);
+			  PQUEUE_STATS(++m_stats.numSwaps);
+			  ++pop.m_depth;
+			  pop.m_node = biggestNode;
 		  }
 
 		  //************************************************************************
@@ -103,16 +278,298 @@ namespace pqueue
 		  //! @return size_t
 		  //!    the size of the heap
 		  //!************************************************************************
-		  std::size_t GetSize()
+		  std::size_t GetSize() const
 		  {
 			  return m_tree.GetSize();
 		  }
 
+		  //************************************************************************
+		  //! @details
+		  //!    Empty the heap, handing all of its items to the caller without
+		  //! sorting them.
+		  //!
+		  //! @param[out] items
+		  //!    receives the items in heap array order (ie. not sorted). Any
+		  //!	previous contents are discarded.
+		  //!************************************************************************
+		  void ReleaseItems(std::vector<T>& items)
+		  {
+			  items.clear();
+			  m_tree.SwapContents(items);
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Move all of other's items into this heap, leaving other empty.
+		  //! Items are ordered by this heap's sort order whatever other's was.
+		  //!
+		  //! @param[in,out] other
+		  //!    heap to empty into this one
+		  //!************************************************************************
+		  void Merge(CHeap<T>&& other)
+		  {
+			  if (&other == this)
+			  {
+				  return;
+			  }
+			  std::vector<T> items;
+			  other.ReleaseItems(items);
+			  Merge(std::move(items));
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Move unsorted items into this heap. A few items compared to the
+		  //! heap's size are inserted one at a time. Otherwise they are moved
+		  //! onto the back of the tree and the whole tree is heapified bottom up
+		  //! in linear time.
+		  //!
+		  //! @param[in,out] items
+		  //!    items to add in any order, emptied by this function
+		  //!************************************************************************
+		  void Merge(std::vector<T>&& items)
+		  {
+			  const std::size_t mergedSize = m_tree.GetSize() + items.size();
+			  std::size_t treeDepth = 0;
+			  for (std::size_t levelSize = 1; levelSize <= mergedSize; levelSize *= 2)
+			  {
+				  ++treeDepth;
+			  }
+			  // inserting costs up to treeDepth swaps an item, heapifying about
+			  // one per item in the merged tree
+			  if (items.size() * treeDepth < mergedSize)
+			  {
+				  for (typename std::vector<T>::iterator currItem = items.begin(); currItem != items.end(); ++currItem)
+				  {
+					  Insert(std::move(*currItem));
+				  }
+				  items.clear();
+				  return;
+			  }
+
+			  PQUEUE_STATS(const std::size_t capacityBefore = m_tree.GetCapacity());
+			  PQUEUE_STATS(const std::size_t numMerged = items.size());
+			  std::vector<T> mergedItems;
+			  m_tree.SwapContents(mergedItems);
+			  if (mergedItems.size() < items.size())
+			  {
+				  // append to whichever array is larger
+				  mergedItems.swap(items);
+			  }
+			  mergedItems.insert(mergedItems.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+			  items.clear();
+			  m_tree.SwapContents(mergedItems);
+			  Heapify();
+			  PQUEUE_STATS(RecordInserts(numMerged, capacityBefore));
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Access the counters of work done by this heap
+		  //!
+		  //! @return CHeapStats
+		  //!    counters since construction, all zero unless built with
+		  //!	PQUEUE_ENABLE_STATS
+		  //!************************************************************************
+		  CHeapStats GetStats() const
+		  {
+#ifdef PQUEUE_ENABLE_STATS
+			  return m_stats;
+#else
+			  return CHeapStats();
+#endif
+		  }
+
+		  //! Walks the items of a heap from the "largest" down without
+		  //! changing the heap. A small frontier heap holds the array indices
+		  //! of the nodes whose parents have been visited, so stepping costs
+		  //! O(log k) after k steps. Invalidated by any change to the heap.
+		  class COrderedIterator
+		  {
+		  public:
+			  typedef std::forward_iterator_tag iterator_category;
+			  typedef T value_type;
+			  typedef std::ptrdiff_t difference_type;
+			  typedef const T* pointer;
+			  typedef const T& reference;
+
+			  //! End iterator. Any iterator whose frontier is empty is at the end,
+			  //! so this compares equal to one that has stepped past the last item.
+			  COrderedIterator() : m_tree(NULL), m_sortOrder(NULL) {}
+
+			  //! Iterator at the top of tree, already at the end if tree is empty
+			  COrderedIterator(const CCompleteTree<T>& tree, const CWrappedCustomSortPred<T>& sortOrder) :
+				m_tree(&tree),
+				m_sortOrder(&sortOrder)
+			  {
+				  if (tree.GetSize() > 0)
+				  {
+					  m_frontier.push_back(0);
+				  }
+			  }
+
+			  const T& operator*() const
+			  {
+				  return GetValue(m_frontier.front());
+			  }
+
+			  const T* operator->() const
+			  {
+				  return &GetValue(m_frontier.front());
+			  }
+
+			  //! Step to the next "largest" item, replacing the current node in
+			  //! the frontier with its children
+			  COrderedIterator& operator++()
+			  {
+				  CCompleteTreeIndex leftChild(m_frontier.front());
+				  leftChild.MoveToLeft();
+				  std::pop_heap(m_frontier.begin(), m_frontier.end(), CFrontierOrder(*this));
+				  m_frontier.pop_back();
+				  for (std::uint32_t child = leftChild.GetCurrentLocationInArray(); child < leftChild.GetCurrentLocationInArray() + 2; ++child)
+				  {
+					  if (child < m_tree->GetSize())
+					  {
+						  m_frontier.push_back(child);
+						  std::push_heap(m_frontier.begin(), m_frontier.end(), CFrontierOrder(*this));
+					  }
+				  }
+				  return *this;
+			  }
+
+			  COrderedIterator operator++(int)
+			  {
+				  COrderedIterator before(*this);
+				  ++*this;
+				  return before;
+			  }
+
+			  bool operator==(const COrderedIterator& rhs) const
+			  {
+				  return m_frontier == rhs.m_frontier && (m_frontier.empty() || m_tree == rhs.m_tree);
+			  }
+
+			  bool operator!=(const COrderedIterator& rhs) const
+			  {
+				  return !(*this == rhs);
+			  }
+
+		  private:
+			  //! Orders frontier indices by the values they point at
+			  struct CFrontierOrder
+			  {
+				  const COrderedIterator& iter;
+				  explicit CFrontierOrder(const COrderedIterator& iterator) : iter(iterator) {}
+				  bool operator()(std::uint32_t lhs, std::uint32_t rhs) const
+				  {
+					  return (*iter.m_sortOrder)(iter.GetValue(lhs), iter.GetValue(rhs));
+				  }
+			  };
+
+			  const CCompleteTree<T>* m_tree;					//!< tree being walked
+			  const CWrappedCustomSortPred<T>* m_sortOrder;	//!< the heap's sort order
+			  std::vector<std::uint32_t> m_frontier;			//!< nodes that may be next, "largest" at the front
+
+			  const T& GetValue(std::uint32_t arrayIndex) const
+			  {
+				  return m_tree->GetNodeAt(arrayIndex).GetValue();
+			  }
+		  };
+
+		  //************************************************************************
+		  //! @return COrderedIterator
+		  //!    iterator at the top of the heap, stepping to the next "largest"
+		  //!	item each time
+		  //!************************************************************************
+		  COrderedIterator BeginOrdered() const
+		  {
+			  return COrderedIterator(m_tree, m_sortOrder);
+		  }
+
+		  //! @return COrderedIterator
+		  //!    iterator past the last item
+		  COrderedIterator EndOrdered() const
+		  {
+			  return COrderedIterator();
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Copy the k "largest" items without changing the heap, in
+		  //! O(k log k) time whatever the heap's size
+		  //!
+		  //! @param[in] k
+		  //!    most items to copy
+		  //! @param[out] items
+		  //!    receives the items, "largest" first. Any previous contents are
+		  //!	discarded.
+		  //!************************************************************************
+		  void PeekTopK(std::size_t k, std::vector<T>& items) const
+		  {
+			  items.clear();
+			  items.reserve(k < GetSize() ? k : GetSize());
+			  for (COrderedIterator currItem = BeginOrdered(); items.size() < k && currItem != EndOrdered(); ++currItem)
+			  {
+				  items.push_back(*currItem);
+			  }
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Call function with every item, in heap array order (ie. not
+		  //! sorted), in O(n) time
+		  //!
+		  //! @param[in] function
+		  //!    called as function(const T&) once per item
+		  //!************************************************************************
+		  template <class Function>
+		  void ForEach(Function function) const
+		  {
+			  m_tree.ForEach(function);
+		  }
+
+		  //************************************************************************
+		  //! @details
+		  //!    Modify every item in place in O(n) time without re-sorting the
+		  //! heap. Only valid for changes that keep how any two items compare,
+		  //! such as adding the same offset to every key.
+		  //!
+		  //! @param[in] function
+		  //!    called as function(T&) once per item
+		  //!************************************************************************
+		  template <class Function>
+		  void UpdateKeepingOrder(Function function)
+		  {
+			  std::vector<T> items;
+			  m_tree.SwapContents(items);
+			  for (typename std::vector<T>::iterator currItem = items.begin(); currItem != items.end(); ++currItem)
+			  {
+				  function(*currItem);
+			  }
+			  m_tree.SwapContents(items);
+		  }
 
 	private:
 		CCompleteTree<T> m_tree;		//!< Representation of the heap as a complete tree
 		typedef typename CCompleteTree<T>::Iterator TreeIter_t;
 		CWrappedCustomSortPred<T> m_sortOrder;	//!< Sort order wrapped in a predicate for use with std::max, etc
+#ifdef PQUEUE_ENABLE_STATS
+		CHeapStats m_stats;				//!< Work done so far
+
+		//! Count numInserted new items and whether the tree had to grow
+		void RecordInserts(std::size_t numInserted, std::size_t capacityBefore)
+		{
+			m_stats.numInserts += numInserted;
+			if (m_tree.GetCapacity() != capacityBefore)
+			{
+				++m_stats.numReallocations;
+			}
+			if (m_tree.GetSize() > m_stats.peakSize)
+			{
+				m_stats.peakSize = m_tree.GetSize();
+			}
+		}
+#endif
 
 		//************************************************************************
 		//! @details
@@ -165,6 +622,7 @@ namespace pqueue
 				else
 				{
 					SwapNodeValues<T>(parent, child);
+					PQUEUE_STATS(++m_stats.numSwaps);
 					BubbleUp(parent);
 				}
 				
@@ -196,10 +654,24 @@ namespace pqueue
 			}
 			assert(biggestNode.IsStillInTree());
 			SwapNodeValues<T>(parent, biggestNode);
+			PQUEUE_STATS(++m_stats.numSwaps);
 			// after swap, biggestNode now holds the value of the parent and is no longer bigger
 			SiftDown(biggestNode);
 		}
 
+		//************************************************************************
+		//! @details
+		//!   Put the whole tree in heap order by sifting down every node that
+		//!  has children, starting with the last one
+		//!************************************************************************
+		void Heapify()
+		{
+			for (std::size_t parentIdx = m_tree.GetSize() / 2; parentIdx > 0; --parentIdx)
+			{
+				SiftDown(m_tree.GetNodeAt(static_cast<std::uint32_t>(parentIdx - 1)));
+			}
+		}
+
 
 	};
 }
@@ -0,0 +1,93 @@
+//********************************************************************
+//  FILE NAME:      HeapStats.h
+//
+//  DESCRIPTION:    Counters describing the work done by a heap or a
+//					priority queue. Only collected when the library is
+//					built with PQUEUE_ENABLE_STATS defined, otherwise
+//					the counters stay zero and cost nothing.
+//*********************************************************************
+#ifndef HEAP_STATS_20261018_H
+#define HEAP_STATS_20261018_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Expands to its argument only when stats are enabled
+#ifdef PQUEUE_ENABLE_STATS
+#define PQUEUE_STATS(statement) statement
+#else
+#define PQUEUE_STATS(statement)
+#endif
+
+namespace pqueue
+{
+	//! Work done by a CHeap since it was constructed. Divide by numInserts
+	//! and numPops for per operation figures.
+	struct CHeapStats
+	{
+		enum { NUM_DEPTH_BUCKETS = 32 };
+
+		std::uint64_t numInserts;		//!< items inserted, one at a time or merged
+		std::uint64_t numPops;		//!< PopTop calls
+		std::uint64_t numComparisons;	//!< calls to the sort order
+		std::uint64_t numSwaps;		//!< node values swapped, each one three copies of T
+		std::uint64_t siftDepths[NUM_DEPTH_BUCKETS];	//!< siftDepths[d] is the number of Insert/PopTop that moved an item d levels, the last bucket counts anything deeper
+		std::uint64_t peakSize;		//!< most items held at once
+		std::uint64_t numReallocations;	//!< times the tree's storage grew
+
+		CHeapStats() :
+		  numInserts(0),
+		  numPops(0),
+		  numComparisons(0),
+		  numSwaps(0),
+		  peakSize(0),
+		  numReallocations(0)
+		{
+			for (std::size_t i = 0; i < NUM_DEPTH_BUCKETS; ++i)
+			{
+				siftDepths[i] = 0;
+			}
+		}
+
+		//! Count one Insert or PopTop that moved an item depth levels
+		void RecordSiftDepth(std::uint64_t depth)
+		{
+			siftDepths[depth < NUM_DEPTH_BUCKETS ? depth : NUM_DEPTH_BUCKETS - 1] += 1;
+		}
+
+		//! Add the work of another heap, eg. one replaced by a sort order change
+		CHeapStats& operator+=(const CHeapStats& rhs)
+		{
+			numInserts += rhs.numInserts;
+			numPops += rhs.numPops;
+			numComparisons += rhs.numComparisons;
+			numSwaps += rhs.numSwaps;
+			for (std::size_t i = 0; i < NUM_DEPTH_BUCKETS; ++i)
+			{
+				siftDepths[i] += rhs.siftDepths[i];
+			}
+			peakSize = peakSize > rhs.peakSize ? peakSize : rhs.peakSize;
+			numReallocations += rhs.numReallocations;
+			return *this;
+		}
+	};
+
+	//! Work done by a CPqueue since it was constructed, including all the
+	//! heaps it has used
+	struct CPqueueStats
+	{
+		CHeapStats heapStats;						//!< work done by the queue's heaps
+		std::uint64_t numSortOrderChanges;		//!< ChangeSortOrder and ChangeSortOrderLazily calls
+		double totalSortOrderChangeSeconds;			//!< time spent inside those calls
+		double lastSortOrderChangeSeconds;			//!< time spent inside the latest one
+
+		CPqueueStats() :
+		  numSortOrderChanges(0),
+		  totalSortOrderChangeSeconds(0.0),
+		  lastSortOrderChangeSeconds(0.0)
+		{
+		}
+	};
+}
+
+#endif
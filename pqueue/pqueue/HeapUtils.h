@@ -7,6 +7,8 @@
 #ifndef HEAP_UTILS_20100823_H
 #define HEAP_UTILS_20100823_H
 
+#include <utility>
+
 namespace pqueue
 {
 	//************************************************************************
@@ -25,17 +27,9 @@ namespace pqueue
 	void Reheapify(CHeap<T>&dest, CHeap<T>&src)
 	{
 		//! @remark
-		//! get the size first, if we are stupidly reheapifying to
-		//! ourselves and are doing while (src.GetSize() > 0) then
-		//! we will go into an infinite loop because we constantly
-		//! pop and reinsert into ourselves
-		unsigned int currSize = src.GetSize();
-		while (currSize > 0)
-		{
-			dest.Insert( src.PeekTop() );
-			src.PopTop();
-			--currSize;
-		}
+		//! reheapifying a heap into itself leaves it as it is, see
+		//! CHeap::Merge
+		dest.Merge(std::move(src));
 	}
 }
 
@@ -0,0 +1,83 @@
+//********************************************************************
+//  FILE NAME:      InterleavedHeapOps.h
+//
+//  DESCRIPTION:    Operations on many heaps at once. The sift downs of
+//					different heaps are advanced in lockstep, each
+//					heap's next level prefetched while the others work,
+//					so heaps too large for the cache wait on memory in
+//					parallel instead of one after another.
+//*********************************************************************
+#ifndef INTERLEAVED_HEAP_OPS_20261018_H
+#define INTERLEAVED_HEAP_OPS_20261018_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! Most pops advanced in lockstep. Each keeps two prefetched nodes in
+	//! flight, which a group this size leaves in the L1 cache until used.
+	enum { POP_INTERLEAVE_WIDTH = 16 };
+
+	//************************************************************************
+	//! @details
+	//!   Pop the top of each heap. The result is the same as calling PopTop
+	//!  on each in turn, but up to POP_INTERLEAVE_WIDTH sift downs run
+	//!  together, one level per heap per round.
+	//!
+	//! @param[in] heaps
+	//!   numHeaps distinct heaps, none of them empty
+	//! @param[in] numHeaps
+	//!   number of heaps
+	//! @param[out] tops
+	//!   receives each heap's top before the pop, in the order of heaps.
+	//!  Any previous contents are discarded.
+	//!
+	//! @throw CHeap<T>::CCannotAccessEmptyHeap
+	//!   if any heap is empty, before any heap is changed
+	//!************************************************************************
+	template <class T>
+	void PopTopInterleaved(CHeap<T>* const* heaps, std::size_t numHeaps, std::vector<T>& tops)
+	{
+		tops.clear();
+		for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+		{
+			tops.push_back(heaps[heapIdx]->PeekTop());
+		}
+
+		std::vector<typename CHeap<T>::CPendingPop> pops;
+		pops.reserve(POP_INTERLEAVE_WIDTH);
+		for (std::size_t groupStart = 0; groupStart < numHeaps; groupStart += POP_INTERLEAVE_WIDTH)
+		{
+			const std::size_t groupEnd = groupStart + POP_INTERLEAVE_WIDTH < numHeaps ? groupStart + POP_INTERLEAVE_WIDTH : numHeaps;
+			pops.clear();
+			for (std::size_t heapIdx = groupStart; heapIdx < groupEnd; ++heapIdx)
+			{
+				pops.push_back(heaps[heapIdx]->BeginPopTop());
+				heaps[heapIdx]->PrefetchPendingPop(pops.back());
+			}
+			for (std::size_t numPending = pops.size(); numPending > 0; )
+			{
+				numPending = 0;
+				for (std::size_t popIdx = 0; popIdx < pops.size(); ++popIdx)
+				{
+					if (pops[popIdx].IsDone())
+					{
+						continue;
+					}
+					CHeap<T>& heap = *heaps[groupStart + popIdx];
+					heap.ContinuePop(pops[popIdx]);
+					if (!pops[popIdx].IsDone())
+					{
+						heap.PrefetchPendingPop(pops[popIdx]);
+						++numPending;
+					}
+				}
+			}
+		}
+	}
+}
+
+#endif
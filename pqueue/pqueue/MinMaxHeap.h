@@ -0,0 +1,377 @@
+//********************************************************************
+//  FILE NAME:      MinMaxHeap.h
+//
+//  DESCRIPTION:    Representation of a min-max heap. Both the
+//					"smallest" and the "largest" item (as defined by a
+//					custom sort order) can be looked at and removed in
+//					logarithmic time from a single complete tree.
+//*********************************************************************
+#ifndef MIN_MAX_HEAP_20261018_H
+#define MIN_MAX_HEAP_20261018_H
+
+#include <assert.h>
+#include <vector>
+
+#include "CompleteTree.h"
+#include "CompleteTreeUtils.h"
+#include "CustomSortPred.h"
+
+namespace pqueue
+{
+	//! Responsible for keeping the "smallest" and the "largest" item of a
+	//! heap at hand. Levels of the tree alternate: a node on an even level
+	//! (the root's) is "smaller" than everything below it, a node on an odd
+	//! level is "larger" than everything below it. The "smallest" item is
+	//! the root and the "largest" is one of the root's children.
+	template <class T>
+	class CMinMaxHeap
+	{
+	public:
+		typedef std::shared_ptr< ISortOrder< T > > ISortOrderPtr; //!< typedef for a sort order for T.
+
+		//! Exception thrown if an empty heap is accessed
+		class CCannotAccessEmptyHeap {};
+
+		//************************************************************************
+		//! @details
+		//!  Min-max heap constructor
+		//!
+		//! @param[in] sortOrder
+		//!		sort order, defines which items are "smallest" and "largest"
+		//!************************************************************************
+		CMinMaxHeap(const ISortOrderPtr& sortOrder) :
+		  m_sortOrder(sortOrder),
+		  m_reversedSortOrder(m_sortOrder)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Insert t into the heap. It moves up along its ancestors on either
+		//!  the even or the odd levels until it is in order.
+		//!
+		//! @param[in] t
+		//!	  item to insert into the heap
+		//!************************************************************************
+		void Insert(const T& t)
+		{
+			m_tree.Append(t);
+			BubbleUp(m_tree.GetLastNode());
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Peek at the "smallest" item in the heap
+		//!
+		//! @return const T&
+		//!    A reference to the "smallest" item
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty heap
+		//!************************************************************************
+		const T& PeekMin() const
+		{
+			if (m_tree.GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			return m_tree.GetRootNode().GetValue();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Peek at the "largest" item in the heap
+		//!
+		//! @return const T&
+		//!    A reference to the "largest" item
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty heap
+		//!************************************************************************
+		const T& PeekMax() const
+		{
+			if (m_tree.GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			return GetMaxNode().GetValue();
+		}
+
+		//************************************************************************
+		//! @details
+		//!    Discard the "smallest" item in the heap
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty heap
+		//!************************************************************************
+		void PopMin()
+		{
+			if (m_tree.GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			EraseNode(m_tree.GetRootNode());
+		}
+
+		//************************************************************************
+		//! @details
+		//!    Discard the "largest" item in the heap
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty heap
+		//!************************************************************************
+		void PopMax()
+		{
+			if (m_tree.GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			EraseNode(GetMaxNode());
+		}
+
+		//************************************************************************
+		//! @return size_t
+		//!    the number of elements stored in the heap
+		//!************************************************************************
+		std::size_t GetSize() const
+		{
+			return m_tree.GetSize();
+		}
+
+		//************************************************************************
+		//! @details
+		//!    Empty the heap, handing all of its items to the caller without
+		//! sorting them.
+		//!
+		//! @param[out] items
+		//!    receives the items in heap array order (ie. not sorted). Any
+		//!	previous contents are discarded.
+		//!************************************************************************
+		void ReleaseItems(std::vector<T>& items)
+		{
+			items.clear();
+			m_tree.SwapContents(items);
+		}
+
+		//! Move only, the queued items are never copied with it
+		CMinMaxHeap(const CMinMaxHeap&) = delete;
+		CMinMaxHeap& operator=(const CMinMaxHeap&) = delete;
+		CMinMaxHeap(CMinMaxHeap&&) = default;
+		CMinMaxHeap& operator=(CMinMaxHeap&&) = default;
+
+	private:
+		typedef typename CCompleteTree<T>::Iterator TreeIter_t;
+
+		//! Sort predicate turned around, so that PickLargestIterator picks
+		//! the "smallest" node. Holds its own copy of the order so the heap
+		//! can be moved.
+		class CReversedSortPred
+		{
+		private:
+			CWrappedCustomSortPred<T> m_sortOrder;	//!< order being reversed
+		public:
+			CReversedSortPred(const CWrappedCustomSortPred<T>& sortOrder) : m_sortOrder(sortOrder) {}
+			bool operator()(const T& lhs, const T& rhs) const
+			{
+				return m_sortOrder(rhs, lhs);
+			}
+		};
+
+		CCompleteTree<T> m_tree;					//!< Representation of the heap as a complete tree
+		CWrappedCustomSortPred<T> m_sortOrder;		//!< Sort order wrapped in a predicate
+		CReversedSortPred m_reversedSortOrder;		//!< m_sortOrder turned around
+
+		//! @return bool
+		//!   true if node is on a level whose nodes are "smaller" than their
+		//!  descendants
+		static bool IsOnMinLevel(const TreeIter_t& node)
+		{
+			return node.GetDepth() % 2 == 0;
+		}
+
+		//! @return bool
+		//!   true if lhs should be further from the top of a max level than rhs,
+		//!  or closer to the top of a min level
+		bool IsLess(const TreeIter_t& lhs, const TreeIter_t& rhs) const
+		{
+			return m_sortOrder(lhs.GetValue(), rhs.GetValue());
+		}
+
+		//************************************************************************
+		//! @return TreeIter_t
+		//!   the node holding the "largest" item: the "larger" of the root's
+		//!  children, or the root if it has none
+		//!************************************************************************
+		TreeIter_t GetMaxNode() const
+		{
+			TreeIter_t leftChild = m_tree.GetRootNode();
+			TreeIter_t rightChild = m_tree.GetRootNode();
+			leftChild.GoLeftChild();
+			rightChild.GoRightChild();
+			if (!leftChild.IsStillInTree())
+			{
+				return m_tree.GetRootNode();
+			}
+			return PickLargestIterator<T>(leftChild, rightChild, m_sortOrder);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove the item at node, filling the hole with the last node of
+		//!  the tree and trickling that down
+		//!
+		//! @param[in] node
+		//!   the root or the node holding the "largest" item
+		//!************************************************************************
+		void EraseNode(TreeIter_t node)
+		{
+			TreeIter_t lastNode = m_tree.GetLastNode();
+			if (node == lastNode)
+			{
+				m_tree.EraseLastNode();
+				return;
+			}
+			SwapNodeValues<T>(node, lastNode);
+			m_tree.EraseLastNode();
+			if (IsOnMinLevel(node))
+			{
+				TrickleDown(node, m_reversedSortOrder);
+			}
+			else
+			{
+				TrickleDown(node, m_sortOrder);
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Move a newly appended node up to its place. It first decides
+		//!  whether it belongs with the min or the max levels by comparing
+		//!  with its parent, then climbs over grandparents on those levels.
+		//!
+		//! @param[in] node
+		//!   the node just appended
+		//!************************************************************************
+		void BubbleUp(TreeIter_t node)
+		{
+			if (node == m_tree.GetRootNode())
+			{
+				return;
+			}
+			TreeIter_t parent = node;
+			parent.GoUp();
+			if (IsOnMinLevel(node))
+			{
+				if (IsLess(parent, node))
+				{
+					SwapNodeValues<T>(node, parent);
+					BubbleUpGrandparents(parent, m_sortOrder);
+				}
+				else
+				{
+					BubbleUpGrandparents(node, m_reversedSortOrder);
+				}
+			}
+			else
+			{
+				if (IsLess(node, parent))
+				{
+					SwapNodeValues<T>(node, parent);
+					BubbleUpGrandparents(parent, m_reversedSortOrder);
+				}
+				else
+				{
+					BubbleUpGrandparents(node, m_sortOrder);
+				}
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Keep swapping node with its grandparent while it belongs above it.
+		//!  Grandparents are on the same kind of level as node.
+		//!
+		//! @param[in] node
+		//!   node to move up
+		//! @param[in] comesFirst
+		//!   m_sortOrder on max levels, m_reversedSortOrder on min levels:
+		//!  comesFirst(grandparent, node) is true when node belongs above
+		//!************************************************************************
+		template <class CompareT>
+		void BubbleUpGrandparents(TreeIter_t node, const CompareT& comesFirst)
+		{
+			while (node.GetDepth() >= 2)
+			{
+				TreeIter_t grandparent = node;
+				grandparent.GoUp();
+				grandparent.GoUp();
+				if (!comesFirst(grandparent.GetValue(), node.GetValue()))
+				{
+					return;
+				}
+				SwapNodeValues<T>(node, grandparent);
+				node = grandparent;
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Move node down until it comes first among its descendants on its
+		//!  kind of level. Each step picks the first of its children and
+		//!  grandchildren; when that is a grandchild, the item moved down may
+		//!  also need to trade places with the grandchild's parent.
+		//!
+		//! @param[in] node
+		//!   node to move down
+		//! @param[in] comesFirst
+		//!   m_sortOrder when node is on a max level, m_reversedSortOrder when
+		//!  it is on a min level
+		//!************************************************************************
+		template <class CompareT>
+		void TrickleDown(TreeIter_t node, const CompareT& comesFirst)
+		{
+			for (;;)
+			{
+				TreeIter_t leftChild = node;
+				TreeIter_t rightChild = node;
+				leftChild.GoLeftChild();
+				rightChild.GoRightChild();
+				if (!leftChild.IsStillInTree())
+				{
+					return;
+				}
+				TreeIter_t leftLeft = leftChild;
+				TreeIter_t leftRight = leftChild;
+				TreeIter_t rightLeft = rightChild;
+				TreeIter_t rightRight = rightChild;
+				leftLeft.GoLeftChild();
+				leftRight.GoRightChild();
+				rightLeft.GoLeftChild();
+				rightRight.GoRightChild();
+
+				TreeIter_t first = PickLargestIterator<T>(leftChild, rightChild, comesFirst);
+				first = PickLargestIterator<T>(first, leftLeft, leftRight, comesFirst);
+				first = PickLargestIterator<T>(first, rightLeft, rightRight, comesFirst);
+				if (!comesFirst(node.GetValue(), first.GetValue()))
+				{
+					return;
+				}
+				SwapNodeValues<T>(node, first);
+				if (first.GetDepth() == node.GetDepth() + 1)
+				{
+					// children have no descendants on node's kind of level
+					return;
+				}
+				TreeIter_t firstParent = first;
+				firstParent.GoUp();
+				if (comesFirst(first.GetValue(), firstParent.GetValue()))
+				{
+					SwapNodeValues<T>(first, firstParent);
+				}
+				node = first;
+			}
+		}
+	};
+}
+
+#endif
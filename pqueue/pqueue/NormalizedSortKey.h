@@ -0,0 +1,277 @@
+//********************************************************************
+//  FILE NAME:      NormalizedSortKey.h
+//
+//  DESCRIPTION:    Binary-comparable sort keys. An item's sort criteria
+//					are encoded once into a fixed size byte string whose
+//					memcmp order matches the item's sort order, so the
+//					heap compares keys instead of calling every criterion.
+//*********************************************************************
+#ifndef NORMALIZED_SORT_KEY_20261018_H
+#define NORMALIZED_SORT_KEY_20261018_H
+
+#include <string.h>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! Responsible for writing order-preserving encodings of values into a
+	//! fixed size key buffer. Values are appended most significant criterion
+	//! first. When a value doesn't fit, as much of it as possible is written
+	//! and the key is closed: items whose keys tie then need the full sort
+	//! order to be told apart.
+	class CSortKeyBuilder
+	{
+	private:
+		unsigned char* m_bytes;		//!< key being written, zero filled by the owner
+		std::size_t m_capacity;		//!< size of m_bytes
+		std::size_t m_length;		//!< bytes written so far
+		bool m_isComplete;			//!< true while every appended value was exact
+	public:
+		//************************************************************************
+		//! @details
+		//!   Construct a builder writing into bytes
+		//!
+		//! @param[out] bytes
+		//!   zero filled buffer to write the key into
+		//! @param[in] capacity
+		//!   size of bytes
+		//!************************************************************************
+		CSortKeyBuilder(unsigned char* bytes, std::size_t capacity) :
+		  m_bytes(bytes),
+		  m_capacity(capacity),
+		  m_length(0),
+		  m_isComplete(true)
+		{
+		}
+
+		//! Append an unsigned integer, big endian
+		template <class UIntT>
+		void AppendUnsigned(UIntT value)
+		{
+			unsigned char encoded[sizeof(UIntT)];
+			for (std::size_t i = sizeof(UIntT); i > 0; --i)
+			{
+				encoded[i - 1] = static_cast<unsigned char>(value & 0xFF);
+				value = static_cast<UIntT>(value >> 8);
+			}
+			AppendBytes(encoded, sizeof(UIntT));
+		}
+
+		//! Append a signed integer. Flipping the sign bit puts negatives
+		//! below positives in unsigned order.
+		template <class IntT>
+		void AppendSigned(IntT value)
+		{
+			typedef typename std::make_unsigned<IntT>::type UIntT;
+			const UIntT signBit = static_cast<UIntT>(UIntT(1) << (sizeof(UIntT) * 8 - 1));
+			AppendUnsigned(static_cast<UIntT>(static_cast<UIntT>(value) ^ signBit));
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Append an IEEE double. Positive values get their sign bit set,
+		//!  negative values have every bit flipped so larger magnitudes sort
+		//!  lower. NaNs are not ordered meaningfully.
+		//!************************************************************************
+		void AppendDouble(double value)
+		{
+			if (value == 0.0)
+			{
+				value = 0.0;	// -0.0 and 0.0 compare equal, encode them the same
+			}
+			std::uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			const std::uint64_t signBit = static_cast<std::uint64_t>(1) << 63;
+			AppendUnsigned((bits & signBit) ? ~bits : (bits | signBit));
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Append a string's bytes followed by a NUL terminator, so a string
+		//!  sorts before any longer string it is a prefix of. Bytes 0x00 and
+		//!  0x01 are escaped as 0x01 0x01 and 0x01 0x02 to keep the
+		//!  terminator unambiguous. Strings that don't fit are cut off.
+		//!************************************************************************
+		void AppendString(const std::string& value)
+		{
+			for (std::string::const_iterator currChar = value.begin(); currChar != value.end(); ++currChar)
+			{
+				const unsigned char byte = static_cast<unsigned char>(*currChar);
+				if (byte <= 1)
+				{
+					const unsigned char escaped[2] = { 1, static_cast<unsigned char>(byte + 1) };
+					AppendBytes(escaped, 2);
+				}
+				else
+				{
+					AppendBytes(&byte, 1);
+				}
+			}
+			const unsigned char terminator = 0;
+			AppendBytes(&terminator, 1);
+		}
+
+		//! @return bool
+		//!   true if the key orders items completely: equal keys mean equal items
+		bool IsComplete() const
+		{
+			return m_isComplete;
+		}
+
+	private:
+		//************************************************************************
+		//! @details
+		//!   Append raw bytes, closing the key if they don't all fit. A closed
+		//!  key is always full, so no padding follows the cut off value.
+		//!************************************************************************
+		void AppendBytes(const unsigned char* bytes, std::size_t numBytes)
+		{
+			if (!m_isComplete)
+			{
+				return;
+			}
+			const std::size_t available = m_capacity - m_length;
+			const std::size_t toCopy = numBytes < available ? numBytes : available;
+			memcpy(m_bytes + m_length, bytes, toCopy);
+			m_length += toCopy;
+			if (toCopy < numBytes)
+			{
+				m_isComplete = false;
+			}
+		}
+	};
+
+	//! Interface for encoding the sort criteria of a T into a key. Must agree
+	//! with the full sort order: if key(lhs) < key(rhs) then lhs < rhs.
+	template <class T>
+	class ISortKeyEncoder
+	{
+	public:
+		virtual ~ISortKeyEncoder() {}
+
+		//! Append the criteria of item to key, most significant first
+		virtual void EncodeSortKey(const T& item, CSortKeyBuilder& key) const = 0;
+	};
+
+	//! An item stored together with its precomputed sort key
+	template <class T, std::size_t KeyBytes>
+	struct CNormalizedKeyItem
+	{
+		unsigned char key[KeyBytes];	//!< encoded sort criteria, zero padded
+		bool isKeyComplete;				//!< equal keys mean equal items
+		T item;							//!< the item itself
+
+		CNormalizedKeyItem(const T& anItem, const ISortKeyEncoder<T>& encoder) :
+		  item(anItem)
+		{
+			memset(key, 0, KeyBytes);
+			CSortKeyBuilder builder(key, KeyBytes);
+			encoder.EncodeSortKey(item, builder);
+			isKeyComplete = builder.IsComplete();
+		}
+	};
+
+	//! Sort keyed items by their keys, only falling back to the full sort
+	//! order of the items when the keys tie and can't tell them apart
+	template <class T, std::size_t KeyBytes>
+	class CNormalizedKeySortOrder : public ISortOrder< CNormalizedKeyItem<T, KeyBytes> >
+	{
+	private:
+		typedef CNormalizedKeyItem<T, KeyBytes> KeyedItem_t;
+		std::shared_ptr< ISortOrder<T> > m_fullSortOrder;	//!< tie breaker for incomplete keys
+	public:
+		//************************************************************************
+		//! @param[in] fullSortOrder
+		//!   sort order the keys were encoded from
+		//!************************************************************************
+		CNormalizedKeySortOrder(const std::shared_ptr< ISortOrder<T> >& fullSortOrder) :
+		  m_fullSortOrder(fullSortOrder)
+		{
+		}
+
+		bool LessThan(const KeyedItem_t& lhs, const KeyedItem_t& rhs) const
+		{
+			return Compare(lhs, rhs) < 0;
+		}
+
+		int Compare(const KeyedItem_t& lhs, const KeyedItem_t& rhs) const
+		{
+			const int result = memcmp(lhs.key, rhs.key, KeyBytes);
+			if (result != 0 || (lhs.isKeyComplete && rhs.isKeyComplete))
+			{
+				return result;
+			}
+			return m_fullSortOrder->Compare(lhs.item, rhs.item);
+		}
+	};
+
+	//! Heap that encodes each item's sort criteria into a KeyBytes long key
+	//! when it is inserted and sifts on the keys. Trades KeyBytes per item
+	//! for cheap comparisons on records with many or expensive criteria.
+	template <class T, std::size_t KeyBytes = 24>
+	class CNormalizedKeyHeap
+	{
+	private:
+		typedef CNormalizedKeyItem<T, KeyBytes> KeyedItem_t;
+	public:
+		typedef std::shared_ptr< ISortOrder<T> > ISortOrderPtr;		//!< full sort order for T
+		typedef std::shared_ptr< ISortKeyEncoder<T> > ISortKeyEncoderPtr;	//!< encoder of that sort order
+
+		//************************************************************************
+		//! @details
+		//!  Heap constructor
+		//!
+		//! @param[in] sortOrder
+		//!		sort order, defines how items are to be sorted. Only consulted
+		//!		when two keys can't decide.
+		//! @param[in] encoder
+		//!		encodes an item's criteria in the same order as sortOrder
+		//!************************************************************************
+		CNormalizedKeyHeap(const ISortOrderPtr& sortOrder, const ISortKeyEncoderPtr& encoder) :
+		  m_encoder(encoder),
+		  m_heap(typename CHeap<KeyedItem_t>::ISortOrderPtr(new CNormalizedKeySortOrder<T, KeyBytes>(sortOrder)))
+		{
+		}
+
+		//! Encode t's key and insert it into the heap
+		void Insert(const T& t)
+		{
+			m_heap.Insert(KeyedItem_t(t, *m_encoder));
+		}
+
+		//! Peek at the top of the heap, see CHeap::PeekTop
+		const T& PeekTop() const
+		{
+			return m_heap.PeekTop().item;
+		}
+
+		//! Discard the top of the heap, see CHeap::PopTop
+		void PopTop()
+		{
+			m_heap.PopTop();
+		}
+
+		//! Number of elements in the heap
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize();
+		}
+
+		//! Move only, the queued items are never copied with it
+		CNormalizedKeyHeap(const CNormalizedKeyHeap&) = delete;
+		CNormalizedKeyHeap& operator=(const CNormalizedKeyHeap&) = delete;
+		CNormalizedKeyHeap(CNormalizedKeyHeap&&) = default;
+		CNormalizedKeyHeap& operator=(CNormalizedKeyHeap&&) = default;
+
+	private:
+		ISortKeyEncoderPtr m_encoder;		//!< builds the key for each inserted item
+		CHeap<KeyedItem_t> m_heap;			//!< keyed items
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,369 @@
+//********************************************************************
+//  FILE NAME:      ParallelHeapDrain.h
+//
+//  DESCRIPTION:    Drains many heaps into one ordered stream using
+//					several threads. The heaps are sorted into runs,
+//					splitters cut the output into ranges and each range
+//					is merged by its own thread.
+//*********************************************************************
+#ifndef PARALLEL_HEAP_DRAIN_20261018_H
+#define PARALLEL_HEAP_DRAIN_20261018_H
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <memory>
+
+#include "Heap.h"
+#include "BoundedBuffer.h"
+
+namespace pqueue
+{
+	//! Responsible for consolidating many heaps (eg. one per thread) into a
+	//! single stream, "largest" item first, as if they were one heap popped
+	//! until empty.
+	//!
+	//! The work happens in three steps:
+	//!  - every heap is emptied and its items sorted into a run, the runs
+	//!    spread over the threads
+	//!  - splitters are picked from a regular sample of the runs, cutting
+	//!    the output into one range per thread. Binary searches find where
+	//!    each range starts in each run.
+	//!  - each thread merges its range of every run and passes the merged
+	//!    items in fixed size batches through a bounded buffer to the
+	//!    calling thread, which hands them to the consumer range by range.
+	//!
+	//! A thread waits when its buffer is full, so merged items beyond the
+	//! runs take at most the buffer capacity per range. The ranges after the
+	//! one being consumed fill their buffers meanwhile, and their threads
+	//! resume as the consumer reaches them.
+	template <class T>
+	class CParallelHeapDrainer
+	{
+	public:
+		typedef typename CHeap<T>::ISortOrderPtr ISortOrderPtr;	//!< typedef for a sort order for T
+
+		//************************************************************************
+		//! @param[in] sortOrder
+		//!   the sort order of the heaps, the "largest" items come out first
+		//! @param[in] numThreads
+		//!   threads sorting and merging, also the number of output ranges
+		//! @param[in] bufferCapacity
+		//!   items each range buffers ahead of the consumer
+		//!************************************************************************
+		CParallelHeapDrainer(const ISortOrderPtr& sortOrder, std::size_t numThreads, std::size_t bufferCapacity = 4096) :
+		  m_comesFirst(sortOrder),
+		  m_numThreads(numThreads > 0 ? numThreads : 1),
+		  m_bufferCapacity(bufferCapacity > 0 ? bufferCapacity : 1)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Empty every heap, passing the items to consumer in order. The
+		//!  consumer runs on the calling thread. If it throws, the merging
+		//!  threads are stopped and the exception is rethrown once they are
+		//!  joined. Every heap is emptied before the first item is consumed,
+		//!  so the items not yet consumed when the consumer, a sort or a
+		//!  merge throws are lost.
+		//!
+		//! @param[in,out] heaps
+		//!   heaps to empty, each used by no other thread during the call
+		//! @param[in] consumer
+		//!   called as consumer(const T&) for each item, "largest" first
+		//!************************************************************************
+		template <class ConsumerT>
+		void Drain(const std::vector< CHeap<T>* >& heaps, ConsumerT& consumer)
+		{
+			m_runs.assign(heaps.size(), std::vector<T>());
+			m_threadErrors.assign(m_numThreads, std::exception_ptr());
+			SortRuns(heaps);
+			FindRangeBounds(ChooseSplitters());
+
+			m_buffers.clear();
+			for (std::size_t range = 0; range < m_numThreads; ++range)
+			{
+				m_buffers.push_back(std::shared_ptr< CBoundedBuffer<T> >(new CBoundedBuffer<T>(m_bufferCapacity)));
+			}
+			m_mergeSeconds.assign(m_numThreads, 0.0);
+			std::vector<std::thread> mergers;
+			for (std::size_t range = 0; range < m_numThreads; ++range)
+			{
+				mergers.push_back(std::thread(&CParallelHeapDrainer::MergeRange, this, range));
+			}
+
+			std::exception_ptr consumerError;
+			try
+			{
+				std::vector<T> batch;
+				for (std::size_t range = 0; range < m_numThreads; ++range)
+				{
+					while (m_buffers[range]->PopBatch(batch))
+					{
+						for (typename std::vector<T>::const_iterator currItem = batch.begin(); currItem != batch.end(); ++currItem)
+						{
+							consumer(*currItem);
+						}
+					}
+				}
+			}
+			catch (...)
+			{
+				consumerError = std::current_exception();
+				for (std::size_t range = 0; range < m_numThreads; ++range)
+				{
+					m_buffers[range]->Abort();
+				}
+			}
+			for (std::size_t i = 0; i < mergers.size(); ++i)
+			{
+				mergers[i].join();
+			}
+			m_runs.clear();
+			m_buffers.clear();
+			RethrowFirstError(consumerError);
+		}
+
+		//! @return double
+		//!   seconds the busiest merging thread of the last Drain spent
+		//!  merging, not counting its waits for room in its buffer
+		double GetLastMergeSeconds() const
+		{
+			double mergeSeconds = 0.0;
+			for (std::size_t range = 0; range < m_mergeSeconds.size(); ++range)
+			{
+				mergeSeconds = m_mergeSeconds[range] > mergeSeconds ? m_mergeSeconds[range] : mergeSeconds;
+			}
+			return mergeSeconds;
+		}
+
+		CParallelHeapDrainer(const CParallelHeapDrainer&) = delete;
+		CParallelHeapDrainer& operator=(const CParallelHeapDrainer&) = delete;
+
+	private:
+		//! Items that sort before others in the output, the "largest" ones
+		class CComesFirst
+		{
+		private:
+			CWrappedCustomSortPred<T> m_sortOrder;	//!< the heaps' order
+		public:
+			CComesFirst(const ISortOrderPtr& sortOrder) : m_sortOrder(sortOrder) {}
+			bool operator()(const T& lhs, const T& rhs) const
+			{
+				return m_sortOrder(rhs, lhs);
+			}
+		};
+
+		//! Orders runs in the merge heap so that the run whose next item
+		//! comes first is on top
+		class CRunHeadLess
+		{
+		private:
+			const CComesFirst& m_comesFirst;
+			const std::vector< std::vector<T> >& m_runs;
+			const std::vector<std::size_t>& m_positions;
+		public:
+			CRunHeadLess(const CComesFirst& comesFirst, const std::vector< std::vector<T> >& runs, const std::vector<std::size_t>& positions) :
+			  m_comesFirst(comesFirst),
+			  m_runs(runs),
+			  m_positions(positions)
+			{
+			}
+			bool operator()(std::size_t lhsRun, std::size_t rhsRun) const
+			{
+				return m_comesFirst(m_runs[rhsRun][m_positions[rhsRun]], m_runs[lhsRun][m_positions[lhsRun]]);
+			}
+		};
+
+		//! Sampled items per output range when choosing splitters, and most
+		//! items a merging thread passes to its buffer at once
+		enum { SAMPLES_PER_RANGE = 32, OUTPUT_BATCH_SIZE = 256 };
+
+		CComesFirst m_comesFirst;				//!< order of the output
+		std::size_t m_numThreads;				//!< threads, and output ranges
+		std::size_t m_bufferCapacity;			//!< items buffered per range
+		std::vector< std::vector<T> > m_runs;	//!< each heap's items in output order
+		std::vector< std::vector<std::size_t> > m_rangeStarts;	//!< m_rangeStarts[range][run] is where range starts in run, one extra range marks the ends
+		std::vector< std::shared_ptr< CBoundedBuffer<T> > > m_buffers;	//!< merged items of each range
+		std::vector<std::exception_ptr> m_threadErrors;		//!< what each thread threw, if anything
+		std::vector<double> m_mergeSeconds;		//!< time each range's thread spent merging, see GetLastMergeSeconds
+
+		//************************************************************************
+		//! @details
+		//!   Empty each heap and sort its items into a run, spreading the
+		//!  heaps over the threads
+		//!************************************************************************
+		void SortRuns(const std::vector< CHeap<T>* >& heaps)
+		{
+			std::vector<std::thread> sorters;
+			for (std::size_t thread = 0; thread < m_numThreads; ++thread)
+			{
+				sorters.push_back(std::thread(&CParallelHeapDrainer::SortRunsFrom, this, std::cref(heaps), thread));
+			}
+			for (std::size_t i = 0; i < sorters.size(); ++i)
+			{
+				sorters[i].join();
+			}
+			RethrowFirstError(std::exception_ptr());
+		}
+
+		//! Sort every m_numThreads'th heap starting with heaps[firstHeap]
+		void SortRunsFrom(const std::vector< CHeap<T>* >& heaps, std::size_t firstHeap)
+		{
+			try
+			{
+				for (std::size_t heapIdx = firstHeap; heapIdx < heaps.size(); heapIdx += m_numThreads)
+				{
+					heaps[heapIdx]->ReleaseItems(m_runs[heapIdx]);
+					std::sort(m_runs[heapIdx].begin(), m_runs[heapIdx].end(), m_comesFirst);
+				}
+			}
+			catch (...)
+			{
+				m_threadErrors[firstHeap] = std::current_exception();
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Sample every run at regular intervals and pick the splitters
+		//!  between output ranges from the sorted sample
+		//!
+		//! @return std::vector<T>
+		//!   m_numThreads - 1 splitters in output order, range i + 1 starts
+		//!  with the first item not coming before splitter i
+		//!************************************************************************
+		std::vector<T> ChooseSplitters() const
+		{
+			std::size_t totalItems = 0;
+			for (std::size_t run = 0; run < m_runs.size(); ++run)
+			{
+				totalItems += m_runs[run].size();
+			}
+			std::vector<T> sample;
+			if (totalItems == 0)
+			{
+				return sample;
+			}
+			const std::size_t sampleSize = SAMPLES_PER_RANGE * m_numThreads;
+			for (std::size_t run = 0; run < m_runs.size(); ++run)
+			{
+				// each run contributes in proportion to its size
+				const std::size_t runSamples = (m_runs[run].size() * sampleSize + totalItems - 1) / totalItems;
+				for (std::size_t i = 0; i < runSamples; ++i)
+				{
+					sample.push_back(m_runs[run][i * m_runs[run].size() / runSamples]);
+				}
+			}
+			std::sort(sample.begin(), sample.end(), m_comesFirst);
+
+			std::vector<T> splitters;
+			for (std::size_t range = 1; range < m_numThreads; ++range)
+			{
+				splitters.push_back(sample[range * sample.size() / m_numThreads]);
+			}
+			return splitters;
+		}
+
+		//! Binary search every run for where each range starts
+		void FindRangeBounds(const std::vector<T>& splitters)
+		{
+			m_rangeStarts.assign(m_numThreads + 1, std::vector<std::size_t>(m_runs.size(), 0));
+			for (std::size_t run = 0; run < m_runs.size(); ++run)
+			{
+				for (std::size_t range = 1; range < m_numThreads; ++range)
+				{
+					if (splitters.empty())
+					{
+						break;
+					}
+					m_rangeStarts[range][run] = std::lower_bound(m_runs[run].begin(), m_runs[run].end(), splitters[range - 1], m_comesFirst) - m_runs[run].begin();
+				}
+				m_rangeStarts[m_numThreads][run] = m_runs[run].size();
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Thread body merging one output range of every run into that
+		//!  range's buffer, with a heap of runs ordered by their next item.
+		//!  Stops early if the consumer gives up.
+		//!************************************************************************
+		void MergeRange(std::size_t range)
+		{
+			CBoundedBuffer<T>& buffer = *m_buffers[range];
+			const std::chrono::steady_clock::time_point mergeStart = std::chrono::steady_clock::now();
+			std::chrono::steady_clock::duration waited(0);
+			try
+			{
+				std::vector<std::size_t> positions(m_rangeStarts[range]);
+				const std::vector<std::size_t>& ends = m_rangeStarts[range + 1];
+				const CRunHeadLess runHeadLess(m_comesFirst, m_runs, positions);
+				std::vector<std::size_t> runHeap;
+				for (std::size_t run = 0; run < m_runs.size(); ++run)
+				{
+					if (positions[run] < ends[run])
+					{
+						runHeap.push_back(run);
+					}
+				}
+				std::make_heap(runHeap.begin(), runHeap.end(), runHeadLess);
+
+				// batches no larger than the buffer, so it bounds what is held
+				const std::size_t batchSize = m_bufferCapacity < OUTPUT_BATCH_SIZE ? m_bufferCapacity : static_cast<std::size_t>(OUTPUT_BATCH_SIZE);
+				std::vector<T> batch;
+				bool isConsumed = true;
+				while (!runHeap.empty() && isConsumed)
+				{
+					std::pop_heap(runHeap.begin(), runHeap.end(), runHeadLess);
+					const std::size_t run = runHeap.back();
+					batch.push_back(std::move(m_runs[run][positions[run]]));
+					if (++positions[run] < ends[run])
+					{
+						std::push_heap(runHeap.begin(), runHeap.end(), runHeadLess);
+					}
+					else
+					{
+						runHeap.pop_back();
+					}
+					if (batch.size() >= batchSize || runHeap.empty())
+					{
+						const std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+						isConsumed = buffer.PushBatch(batch);
+						waited += std::chrono::steady_clock::now() - waitStart;
+					}
+				}
+			}
+			catch (...)
+			{
+				m_threadErrors[range] = std::current_exception();
+			}
+			m_mergeSeconds[range] = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart - waited).count();
+			buffer.Close();
+		}
+
+		//! Rethrow error if set, otherwise the first error caught on a thread
+		void RethrowFirstError(const std::exception_ptr& error)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+			for (std::size_t thread = 0; thread < m_threadErrors.size(); ++thread)
+			{
+				if (m_threadErrors[thread])
+				{
+					std::exception_ptr threadError = m_threadErrors[thread];
+					m_threadErrors[thread] = std::exception_ptr();
+					std::rethrow_exception(threadError);
+				}
+			}
+		}
+	};
+}
+
+#endif
@@ -9,13 +9,20 @@
 
 #include "HeapUtils.h"
 #include "Heap.h"
+#include "HeapStats.h"
+#include "PqueueTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 namespace pqueue
 {
 	//! Class responsible for keeping elements in a queue in order 
 	//! of priority
 	template <class T>
-	class CPqueue  : public boost::noncopyable
+	class CPqueue
 	{
 	public:
 		//************************************************************************
@@ -24,7 +31,11 @@ namespace pqueue
 		//! @param[in] sortOrder
 		//!    how to sort the queued elements
 		//!************************************************************************
-		CPqueue( const typename CHeap<T>::ISortOrderPtr& sortOrder) : m_heap(new CHeap<T>(sortOrder))
+		CPqueue( const typename CHeap<T>::ISortOrderPtr& sortOrder) :
+			m_heap(sortOrder),
+			m_sortOrder(sortOrder),
+			m_isUnsortedHeapOrdered(false),
+			m_itemsMigratedPerOperation(0)
 		{
 
 		}
@@ -41,7 +52,12 @@ namespace pqueue
 		//!************************************************************************
 		void Push(const T& newItem)
 		{
-			m_heap->Insert(newItem);
+			m_heap.Insert(newItem);
+			MigrateUnsortedItems(m_itemsMigratedPerOperation);
+			if (m_traceRecorder)
+			{
+				m_traceRecorder->RecordPush(newItem);
+			}
 		}
 
 		//************************************************************************
@@ -51,7 +67,22 @@ namespace pqueue
 		//!************************************************************************
 		void PopFront()
 		{
-			m_heap->PopTop();
+			if (IsFrontUnsorted())
+			{
+				// the set aside items are heap ordered by now, pop their top
+				// in O(log n) without moving any of them into m_heap
+				std::pop_heap(m_unsortedItems.begin(), m_unsortedItems.end(), m_sortOrder);
+				m_unsortedItems.pop_back();
+			}
+			else
+			{
+				m_heap.PopTop();
+			}
+			MigrateUnsortedItems(m_itemsMigratedPerOperation);
+			if (m_traceRecorder)
+			{
+				m_traceRecorder->RecordPopFront();
+			}
 		}
 
 		//************************************************************************
@@ -63,7 +94,24 @@ namespace pqueue
 		//!************************************************************************
 		const T& PeekFront() const
 		{
-			return m_heap->PeekTop();
+			const T& front = IsFrontUnsorted() ? m_unsortedItems[FindBestUnsortedItem()] : m_heap.PeekTop();
+			if (m_traceRecorder)
+			{
+				m_traceRecorder->RecordPeekFront();
+			}
+			return front;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Determine the number of elements waiting in the queue
+		//!
+		//! @return std::size_t
+		//!    number of queued elements
+		//!************************************************************************
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize() + m_unsortedItems.size();
 		}
 
 		//************************************************************************
@@ -76,18 +124,273 @@ namespace pqueue
 		//!************************************************************************
 		void ChangeSortOrder(const typename CHeap<T>::ISortOrderPtr& sortOrder)
 		{
-			// move everything to a new heap based on the sort order
-			std::auto_ptr<CHeap<T>> newHeap(new CHeap<T>(sortOrder));
-			Reheapify(*newHeap, *m_heap);
-			// take ownership of this newly created ptr, release old heap
-			// that is now empty
-			m_heap = newHeap;
+			PQUEUE_STATS(const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+			SetAsideForSortOrder(sortOrder, m_itemsMigratedPerOperation);
+			m_heap.Merge(std::move(m_unsortedItems));
+			PQUEUE_STATS(RecordSortOrderChange(start));
+			if (m_traceRecorder)
+			{
+				m_traceRecorder->RecordChangeSortOrder();
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Apply a new sort order without rearranging the elements up front.
+		//!  The queued elements are set aside unsorted and moved into the new
+		//!  heap a few at a time on each following Push/PopFront. PeekFront and
+		//!  PopFront honor the new sort order immediately: the first access
+		//!  after the change heapifies the set aside elements in place, O(n)
+		//!  with at most 2n comparisons, and each PopFront of one of them
+		//!  after that is O(log n). No access moves more than
+		//!  itemsMigratedPerOperation of them into the heap.
+		//!
+		//! @param[in] sortOrder
+		//!		new sort order to apply
+		//! @param[in] itemsMigratedPerOperation
+		//!		how many set aside elements each Push/PopFront moves into the
+		//!		heap. 0 leaves them until PopFront reaches them.
+		//!************************************************************************
+		void ChangeSortOrderLazily(const typename CHeap<T>::ISortOrderPtr& sortOrder,
+			std::size_t itemsMigratedPerOperation)
+		{
+			PQUEUE_STATS(const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+			SetAsideForSortOrder(sortOrder, itemsMigratedPerOperation);
+			PQUEUE_STATS(RecordSortOrderChange(start));
+			if (m_traceRecorder)
+			{
+				m_traceRecorder->RecordChangeSortOrder();
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Move every element of other into this queue, leaving other empty.
+		//!  The elements are placed by this queue's sort order. The elements
+		//!  are moved, not copied, and a large merge heapifies in linear time.
+		//!
+		//! @param[in,out] other
+		//!   queue to empty into this one
+		//!************************************************************************
+		void Merge(CPqueue<T>&& other)
+		{
+			if (&other == this)
+			{
+				return;
+			}
+			std::vector<T> items;
+			other.m_heap.ReleaseItems(items);
+			items.insert(items.end(), std::make_move_iterator(other.m_unsortedItems.begin()), std::make_move_iterator(other.m_unsortedItems.end()));
+			other.m_unsortedItems.clear();
+			other.m_isUnsortedHeapOrdered = false;
+			m_heap.Merge(std::move(items));
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Access the counters of work done by this queue
+		//!
+		//! @return CPqueueStats
+		//!   counters since construction, across every heap the queue has
+		//!  used. All zero unless built with PQUEUE_ENABLE_STATS.
+		//!************************************************************************
+		CPqueueStats GetStats() const
+		{
+#ifdef PQUEUE_ENABLE_STATS
+			CPqueueStats stats(m_stats);
+			stats.heapStats += m_heap.GetStats();
+			return stats;
+#else
+			return CPqueueStats();
+#endif
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Copy the k highest priority elements without changing the queue,
+		//!  eg. to show what is next in line. Costs O(k log k) for the heap
+		//!  plus one scan of any elements set aside by a lazy sort order change.
+		//!
+		//! @param[in] k
+		//!   most elements to copy
+		//! @param[out] items
+		//!   receives the elements, front of the queue first. Any previous
+		//!  contents are discarded.
+		//!************************************************************************
+		void PeekFrontK(std::size_t k, std::vector<T>& items) const
+		{
+			m_heap.PeekTopK(k, items);
+			if (m_unsortedItems.empty())
+			{
+				return;
+			}
+			// sort pointers to the best unsorted elements, then merge them
+			// with the heap's
+			std::vector<const T*> unsortedTopK;
+			unsortedTopK.reserve(m_unsortedItems.size());
+			for (typename std::vector<T>::const_iterator currItem = m_unsortedItems.begin(); currItem != m_unsortedItems.end(); ++currItem)
+			{
+				unsortedTopK.push_back(&*currItem);
+			}
+			const std::size_t numUnsorted = k < unsortedTopK.size() ? k : unsortedTopK.size();
+			const CWrappedCustomSortPred<T>& sortOrder = m_sortOrder;
+			std::partial_sort(unsortedTopK.begin(), unsortedTopK.begin() + numUnsorted, unsortedTopK.end(),
+				[&sortOrder](const T* lhs, const T* rhs) { return sortOrder(*rhs, *lhs); });
+
+			std::vector<T> heapTopK;
+			heapTopK.swap(items);
+			std::size_t heapIdx = 0;
+			std::size_t unsortedIdx = 0;
+			while (items.size() < k && (heapIdx < heapTopK.size() || unsortedIdx < numUnsorted))
+			{
+				if (unsortedIdx == numUnsorted ||
+					(heapIdx < heapTopK.size() && !sortOrder(heapTopK[heapIdx], *unsortedTopK[unsortedIdx])))
+				{
+					items.push_back(heapTopK[heapIdx++]);
+				}
+				else
+				{
+					items.push_back(*unsortedTopK[unsortedIdx++]);
+				}
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Call function with every queued element in no particular order,
+		//!  in O(n) time
+		//!
+		//! @param[in] function
+		//!   called as function(const T&) once per element
+		//!************************************************************************
+		template <class Function>
+		void ForEach(Function function) const
+		{
+			m_heap.ForEach(function);
+			std::for_each(m_unsortedItems.begin(), m_unsortedItems.end(), function);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Log every following Push, PopFront, PeekFront and sort order
+		//!  change to a trace, eg. to replay the workload in a benchmark
+		//!
+		//! @param[in] traceRecorder
+		//!   where to log the operations, NULL to stop recording
+		//!************************************************************************
+		void SetTraceRecorder(const std::shared_ptr< CPqueueTraceRecorder<T> >& traceRecorder)
+		{
+			m_traceRecorder = traceRecorder;
 		}
 
+		//! Move only, the queued items are never copied with it
+		CPqueue(const CPqueue&) = delete;
+		CPqueue& operator=(const CPqueue&) = delete;
+		CPqueue(CPqueue&&) = default;
+		CPqueue& operator=(CPqueue&&) = default;
 
 	private:
-		std::auto_ptr< CHeap<T> > m_heap;		//!< Heap containing all the elements
+		CHeap<T> m_heap;						//!< Heap containing all the elements
+		CWrappedCustomSortPred<T> m_sortOrder;	//!< Sort order of m_heap, for comparing against unsorted items
+		//! Items set aside by a lazy sort order change. Heap ordered by the new
+		//! sort order on first access, which may be a const PeekFront.
+		mutable std::vector<T> m_unsortedItems;
+		mutable bool m_isUnsortedHeapOrdered;	//!< m_unsortedItems has been heap ordered
+		std::size_t m_itemsMigratedPerOperation;	//!< Unsorted items moved to the heap per Push/PopFront
+		std::shared_ptr< CPqueueTraceRecorder<T> > m_traceRecorder;	//!< Logs operations when set
+#ifdef PQUEUE_ENABLE_STATS
+		CPqueueStats m_stats;					//!< Sort order changes, and the work of heaps already replaced
+
+		//! Count a sort order change that started at start
+		void RecordSortOrderChange(const std::chrono::steady_clock::time_point& start)
+		{
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			++m_stats.numSortOrderChanges;
+			m_stats.totalSortOrderChangeSeconds += seconds;
+			m_stats.lastSortOrderChangeSeconds = seconds;
+		}
+#endif
+
+		//************************************************************************
+		//! @details
+		//!   Set every element aside and start a new, empty heap with the new
+		//!  sort order, see ChangeSortOrderLazily
+		//!************************************************************************
+		void SetAsideForSortOrder(const typename CHeap<T>::ISortOrderPtr& sortOrder,
+			std::size_t itemsMigratedPerOperation)
+		{
+			std::vector<T> heapItems;
+			m_heap.ReleaseItems(heapItems);
+			if (m_unsortedItems.empty())
+			{
+				m_unsortedItems.swap(heapItems);
+			}
+			else
+			{
+				// a previous change is still pending, all of it gets resorted
+				m_unsortedItems.insert(m_unsortedItems.end(), std::make_move_iterator(heapItems.begin()), std::make_move_iterator(heapItems.end()));
+			}
+			m_isUnsortedHeapOrdered = false;
 
+			PQUEUE_STATS(m_stats.heapStats += m_heap.GetStats());
+			m_heap = CHeap<T>(sortOrder);
+			m_sortOrder.SetCustomSort(sortOrder);
+			m_itemsMigratedPerOperation = itemsMigratedPerOperation;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Move up to count items from the back of the unsorted items into the
+		//!  heap. Removing from the back leaves them heap ordered if they were.
+		//!
+		//! @param[in] count
+		//!   number of items to move
+		//!************************************************************************
+		void MigrateUnsortedItems(std::size_t count)
+		{
+			while (count > 0 && !m_unsortedItems.empty())
+			{
+				m_heap.Insert(std::move(m_unsortedItems.back()));
+				m_unsortedItems.pop_back();
+				--count;
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Find the best unsorted item under the current sort order, heap
+		//!  ordering the unsorted items in O(n) if this is the first look since
+		//!  they were set aside
+		//!
+		//! @return std::size_t
+		//!   index into m_unsortedItems of the best item. Only valid when there
+		//!  are unsorted items.
+		//!************************************************************************
+		std::size_t FindBestUnsortedItem() const
+		{
+			if (!m_isUnsortedHeapOrdered)
+			{
+				std::make_heap(m_unsortedItems.begin(), m_unsortedItems.end(), m_sortOrder);
+				m_isUnsortedHeapOrdered = true;
+			}
+			return 0;
+		}
+
+		//************************************************************************
+		//! @return bool
+		//!   true if the front of the queue is one of the unsorted items rather
+		//!  than the top of the heap
+		//!************************************************************************
+		bool IsFrontUnsorted() const
+		{
+			if (m_unsortedItems.empty())
+			{
+				return false;
+			}
+			// always looked up, so the unsorted items are heap ordered after
+			const T& bestUnsorted = m_unsortedItems[FindBestUnsortedItem()];
+			return m_heap.GetSize() == 0 || m_sortOrder(m_heap.PeekTop(), bestUnsorted);
+		}
 
 	};
 }
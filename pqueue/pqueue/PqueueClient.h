@@ -0,0 +1,281 @@
+//********************************************************************
+//  FILE NAME:      PqueueClient.h
+//
+//  DESCRIPTION:    Client for CPqueueServer. Each request can be made
+//					in one call, or sent with a Send call and its
+//					response collected later with the matching Receive
+//					call, so many requests can be in flight at once.
+//					POSIX only.
+//*********************************************************************
+#ifndef PQUEUE_CLIENT_20261018_H
+#define PQUEUE_CLIENT_20261018_H
+
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PqueueProtocol.h"
+#include "PqueueSocket.h"
+
+namespace pqueue
+{
+	//! Exception thrown when the server doesn't know a queue id
+	class CUnknownQueue {};
+
+	//! Responsible for one connection to a CPqueueServer. Sends are
+	//! buffered until Flush, or until a Receive needs their response.
+	//! Responses must be received in the order the requests were sent.
+	class CPqueueClient
+	{
+	public:
+		//************************************************************************
+		//! @param[in] address
+		//!   the server's address, "unix:PATH" or "tcp:A.B.C.D:PORT"
+		//!
+		//! @throw CSocketError
+		//!   if the server can't be reached
+		//!************************************************************************
+		explicit CPqueueClient(const std::string& address) :
+		  m_receivedStart(0)
+		{
+			CSocketAddress socketAddress;
+			if (!ParseSocketAddress(address, socketAddress))
+			{
+				throw CSocketError();
+			}
+			m_socket.Reset(socket(socketAddress.storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0));
+			if (m_socket.Get() < 0 ||
+				connect(m_socket.Get(), reinterpret_cast<const sockaddr*>(&socketAddress.storage), socketAddress.length) < 0)
+			{
+				throw CSocketError();
+			}
+			SetNoDelay(m_socket.Get(), socketAddress);
+		}
+
+		//! Move only, a connection has one owner
+		CPqueueClient(const CPqueueClient&) = delete;
+		CPqueueClient& operator=(const CPqueueClient&) = delete;
+		CPqueueClient(CPqueueClient&&) = default;
+		CPqueueClient& operator=(CPqueueClient&&) = default;
+
+		//! @return std::uint32_t
+		//!   id of the queue called name, created if it didn't exist
+		//! @throw CSocketError, CProtocolError
+		std::uint32_t OpenQueue(const std::string& name)
+		{
+			SendOpenQueue(name);
+			return ReceiveOpenQueue();
+		}
+
+		//! @return std::uint64_t
+		//!   size of the queue after the push
+		//! @throw CSocketError, CProtocolError, CUnknownQueue
+		std::uint64_t Push(std::uint32_t queueId, std::int64_t priority, const std::string& payload)
+		{
+			CQueueItem item;
+			item.priority = priority;
+			item.payload = payload;
+			SendPush(queueId, &item, 1);
+			return ReceivePush();
+		}
+
+		//! Push every item in one request
+		//! @return std::uint64_t
+		//!   size of the queue after the push
+		//! @throw CSocketError, CProtocolError, CUnknownQueue
+		//!   CProtocolError also if the request would exceed MAX_FRAME_SIZE
+		std::uint64_t PushBatch(std::uint32_t queueId, const std::vector<CQueueItem>& items)
+		{
+			SendPush(queueId, items.empty() ? NULL : &items[0], items.size());
+			return ReceivePush();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Pop up to maxCount items in one request
+		//!
+		//! @param[out] items
+		//!   receives the popped items, front first. Any previous contents
+		//!  are discarded.
+		//!
+		//! @return std::size_t
+		//!   number of items popped, fewer than maxCount if the queue ran out
+		//!  or more would not fit in a response of MAX_FRAME_SIZE
+		//!
+		//! @throw CSocketError, CProtocolError, CUnknownQueue
+		//!************************************************************************
+		std::size_t PopBatch(std::uint32_t queueId, std::uint32_t maxCount, std::vector<CQueueItem>& items)
+		{
+			SendPop(queueId, maxCount);
+			return ReceivePop(items);
+		}
+
+		//! @throw CSocketError, CProtocolError, CUnknownQueue
+		std::uint64_t GetSize(std::uint32_t queueId)
+		{
+			SendGetSize(queueId);
+			return ReceiveGetSize();
+		}
+
+		//! @throw CProtocolError
+		//!   if name is longer than 65535 bytes, the most a request can carry
+		void SendOpenQueue(const std::string& name)
+		{
+			if (name.size() > 0xFFFF)
+			{
+				throw CProtocolError();
+			}
+			CFrameWriter request(m_toSend);
+			request.WriteU8(OP_OPEN);
+			request.WriteU16(static_cast<std::uint16_t>(name.size()));
+			request.WriteBytes(name);
+			request.Finish();
+		}
+
+		//! @throw CProtocolError
+		//!   if the request would exceed MAX_FRAME_SIZE, which the server
+		//!  rejects; nothing is sent
+		void SendPush(std::uint32_t queueId, const CQueueItem* items, std::size_t numItems)
+		{
+			std::size_t requestSize = 1 + 4 + 4;
+			for (std::size_t i = 0; i < numItems; ++i)
+			{
+				requestSize += GetEncodedItemSize(items[i].payload.size());
+				if (requestSize > MAX_FRAME_SIZE)
+				{
+					throw CProtocolError();
+				}
+			}
+			CFrameWriter request(m_toSend);
+			request.WriteU8(OP_PUSH);
+			request.WriteU32(queueId);
+			request.WriteU32(static_cast<std::uint32_t>(numItems));
+			for (std::size_t i = 0; i < numItems; ++i)
+			{
+				request.WriteItem(items[i]);
+			}
+			request.Finish();
+		}
+
+		void SendPop(std::uint32_t queueId, std::uint32_t maxCount)
+		{
+			CFrameWriter request(m_toSend);
+			request.WriteU8(OP_POP);
+			request.WriteU32(queueId);
+			request.WriteU32(maxCount);
+			request.Finish();
+		}
+
+		void SendGetSize(std::uint32_t queueId)
+		{
+			CFrameWriter request(m_toSend);
+			request.WriteU8(OP_SIZE);
+			request.WriteU32(queueId);
+			request.Finish();
+		}
+
+		//! Write every buffered request to the server
+		//! @throw CSocketError
+		void Flush()
+		{
+			std::size_t sentBytes = 0;
+			while (sentBytes < m_toSend.size())
+			{
+				const ssize_t numWritten = send(m_socket.Get(), m_toSend.data() + sentBytes, m_toSend.size() - sentBytes, MSG_NOSIGNAL);
+				if (numWritten < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw CSocketError();
+				}
+				sentBytes += static_cast<std::size_t>(numWritten);
+			}
+			m_toSend.clear();
+		}
+
+		std::uint32_t ReceiveOpenQueue()
+		{
+			CFrameReader response = ReceiveResponse();
+			return response.ReadU32();
+		}
+
+		std::uint64_t ReceivePush()
+		{
+			CFrameReader response = ReceiveResponse();
+			return response.ReadU64();
+		}
+
+		//! See PopBatch
+		std::size_t ReceivePop(std::vector<CQueueItem>& items)
+		{
+			CFrameReader response = ReceiveResponse();
+			items.resize(response.ReadU32());
+			for (std::size_t i = 0; i < items.size(); ++i)
+			{
+				response.ReadItem(items[i]);
+			}
+			return items.size();
+		}
+
+		std::uint64_t ReceiveGetSize()
+		{
+			CFrameReader response = ReceiveResponse();
+			return response.ReadU64();
+		}
+
+	private:
+		CFileDescriptor m_socket;		//!< connection to the server
+		std::string m_toSend;			//!< requests not yet flushed
+		std::string m_received;			//!< bytes read from the server
+		std::size_t m_receivedStart;	//!< start of the next response in m_received
+
+		//************************************************************************
+		//! @details
+		//!   Flush, then wait for the next response and check its status
+		//!
+		//! @return CFrameReader
+		//!   reader positioned after the status, valid until the next receive
+		//!
+		//! @throw CSocketError, CProtocolError, CUnknownQueue
+		//!************************************************************************
+		CFrameReader ReceiveResponse()
+		{
+			Flush();
+			std::size_t bodySize = 0;
+			while (!CFrameReader::HasCompleteFrame(m_received.data() + m_receivedStart, m_received.size() - m_receivedStart, bodySize))
+			{
+				// responses already handed out are no longer needed
+				m_received.erase(0, m_receivedStart);
+				m_receivedStart = 0;
+				char buffer[65536];
+				const ssize_t numRead = read(m_socket.Get(), buffer, sizeof(buffer));
+				if (numRead <= 0)
+				{
+					if (numRead < 0 && errno == EINTR)
+					{
+						continue;
+					}
+					throw CSocketError();
+				}
+				m_received.append(buffer, static_cast<std::size_t>(numRead));
+			}
+			CFrameReader response(m_received.data() + m_receivedStart + FRAME_HEADER_SIZE, bodySize);
+			m_receivedStart += FRAME_HEADER_SIZE + bodySize;
+			const std::uint8_t status = response.ReadU8();
+			if (status == STATUS_UNKNOWN_QUEUE)
+			{
+				throw CUnknownQueue();
+			}
+			if (status != STATUS_OK)
+			{
+				throw CProtocolError();
+			}
+			return response;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,279 @@
+//********************************************************************
+//  FILE NAME:      PqueueProtocol.h
+//
+//  DESCRIPTION:    Binary protocol spoken between CPqueueServer and
+//					CPqueueClient. Every message is a frame: a 4 byte
+//					little endian length of the rest of the frame, then
+//					the rest. Requests may be pipelined; responses come
+//					back in request order.
+//
+//  REQUESTS:       u8 op, then
+//					OP_OPEN   u16 name length, name         -> u32 queue id
+//					OP_PUSH   u32 queue id, u32 n, n items  -> u64 size
+//					OP_POP    u32 queue id, u32 max count   -> u32 n, n items
+//					OP_SIZE   u32 queue id                  -> u64 size
+//					OP_POP answers with fewer than max count items when
+//					more would take the response past MAX_FRAME_SIZE.
+//
+//  RESPONSES:      u8 status, then the result above if STATUS_OK
+//
+//  ITEMS:          i64 priority, u32 payload length, payload. The
+//					largest priority pops first, equal priorities in
+//					the order they were pushed.
+//*********************************************************************
+#ifndef PQUEUE_PROTOCOL_20261018_H
+#define PQUEUE_PROTOCOL_20261018_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pqueue
+{
+	//! Request types
+	enum EProtocolOp
+	{
+		OP_OPEN = 1,
+		OP_PUSH = 2,
+		OP_POP = 3,
+		OP_SIZE = 4
+	};
+
+	//! Response statuses
+	enum EProtocolStatus
+	{
+		STATUS_OK = 0,
+		STATUS_UNKNOWN_QUEUE = 1,	//!< the queue id was not returned by OP_OPEN
+		STATUS_BAD_REQUEST = 2		//!< unknown op or malformed body
+	};
+
+	enum
+	{
+		FRAME_HEADER_SIZE = 4,				//!< bytes of the length prefix
+		MAX_FRAME_SIZE = 16 * 1024 * 1024	//!< largest frame body either side accepts
+	};
+
+	//! Exception thrown when a frame can't be decoded, or a request would
+	//! not fit in one
+	class CProtocolError {};
+
+	//! An item on a served queue
+	struct CQueueItem
+	{
+		std::int64_t priority;	//!< larger pops first
+		std::string payload;	//!< opaque bytes
+	};
+
+	//! @return std::size_t
+	//!   bytes CFrameWriter::WriteItem writes for an item with a payload of
+	//!  payloadSize bytes
+	inline std::size_t GetEncodedItemSize(std::size_t payloadSize)
+	{
+		return 8 + 4 + payloadSize;
+	}
+
+	//! Responsible for encoding one frame onto the end of a buffer. The
+	//! length prefix is filled in by Finish.
+	class CFrameWriter
+	{
+	public:
+		//! Start a frame at the end of buffer, which must outlive the writer
+		explicit CFrameWriter(std::string& buffer) :
+		  m_buffer(buffer),
+		  m_frameStart(buffer.size())
+		{
+			m_buffer.append(FRAME_HEADER_SIZE, '\0');
+		}
+
+		void WriteU8(std::uint8_t value)
+		{
+			m_buffer.push_back(static_cast<char>(value));
+		}
+
+		void WriteU16(std::uint16_t value)
+		{
+			WriteLittleEndian(value, 2);
+		}
+
+		void WriteU32(std::uint32_t value)
+		{
+			WriteLittleEndian(value, 4);
+		}
+
+		void WriteU64(std::uint64_t value)
+		{
+			WriteLittleEndian(value, 8);
+		}
+
+		void WriteBytes(const std::string& bytes)
+		{
+			m_buffer.append(bytes);
+		}
+
+		void WriteItem(const CQueueItem& item)
+		{
+			WriteU64(static_cast<std::uint64_t>(item.priority));
+			WriteU32(static_cast<std::uint32_t>(item.payload.size()));
+			WriteBytes(item.payload);
+		}
+
+		//! @return std::size_t
+		//!   bytes written to the frame's body so far
+		std::size_t GetBodySize() const
+		{
+			return m_buffer.size() - m_frameStart - FRAME_HEADER_SIZE;
+		}
+
+		//! Discard what has been written to the frame so far
+		void Reset()
+		{
+			m_buffer.resize(m_frameStart + FRAME_HEADER_SIZE);
+		}
+
+		//! Fill in the length prefix, after which the frame is complete
+		void Finish()
+		{
+			std::uint32_t bodySize = static_cast<std::uint32_t>(GetBodySize());
+			for (std::size_t i = 0; i < FRAME_HEADER_SIZE; ++i, bodySize >>= 8)
+			{
+				m_buffer[m_frameStart + i] = static_cast<char>(bodySize & 0xFF);
+			}
+		}
+
+		CFrameWriter(const CFrameWriter&) = delete;
+		CFrameWriter& operator=(const CFrameWriter&) = delete;
+
+	private:
+		std::string& m_buffer;		//!< where frames are appended
+		std::size_t m_frameStart;	//!< offset of this frame's length prefix
+
+		void WriteLittleEndian(std::uint64_t value, std::size_t numBytes)
+		{
+			for (std::size_t i = 0; i < numBytes; ++i, value >>= 8)
+			{
+				m_buffer.push_back(static_cast<char>(value & 0xFF));
+			}
+		}
+	};
+
+	//! Responsible for decoding the body of one frame
+	class CFrameReader
+	{
+	public:
+		//************************************************************************
+		//! @param[in] body
+		//!   first byte of the frame after the length prefix, must outlive
+		//!  the reader
+		//! @param[in] size
+		//!   bytes in the body
+		//!************************************************************************
+		CFrameReader(const char* body, std::size_t size) :
+		  m_next(body),
+		  m_end(body + size)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Find the first complete frame in a buffer of received bytes
+		//!
+		//! @param[in] data
+		//!   received bytes, starting at a frame boundary
+		//! @param[in] size
+		//!   number of bytes received
+		//! @param[out] bodySize
+		//!   size of the first frame's body, set when the header is complete
+		//!
+		//! @return bool
+		//!   true if the whole first frame has been received
+		//!
+		//! @throw CProtocolError
+		//!   if the frame is larger than MAX_FRAME_SIZE
+		//!************************************************************************
+		static bool HasCompleteFrame(const char* data, std::size_t size, std::size_t& bodySize)
+		{
+			if (size < FRAME_HEADER_SIZE)
+			{
+				return false;
+			}
+			bodySize = 0;
+			for (std::size_t i = FRAME_HEADER_SIZE; i > 0; --i)
+			{
+				bodySize = (bodySize << 8) | static_cast<unsigned char>(data[i - 1]);
+			}
+			if (bodySize > MAX_FRAME_SIZE)
+			{
+				throw CProtocolError();
+			}
+			return size - FRAME_HEADER_SIZE >= bodySize;
+		}
+
+		//! @throw CProtocolError if the body is too short, for every Read
+		std::uint8_t ReadU8()
+		{
+			return static_cast<std::uint8_t>(ReadLittleEndian(1));
+		}
+
+		std::uint16_t ReadU16()
+		{
+			return static_cast<std::uint16_t>(ReadLittleEndian(2));
+		}
+
+		std::uint32_t ReadU32()
+		{
+			return static_cast<std::uint32_t>(ReadLittleEndian(4));
+		}
+
+		std::uint64_t ReadU64()
+		{
+			return ReadLittleEndian(8);
+		}
+
+		void ReadBytes(std::size_t numBytes, std::string& bytes)
+		{
+			Require(numBytes);
+			bytes.assign(m_next, numBytes);
+			m_next += numBytes;
+		}
+
+		void ReadItem(CQueueItem& item)
+		{
+			item.priority = static_cast<std::int64_t>(ReadU64());
+			ReadBytes(ReadU32(), item.payload);
+		}
+
+		//! @return bool
+		//!   true once the whole body has been read
+		bool IsAtEnd() const
+		{
+			return m_next == m_end;
+		}
+
+	private:
+		const char* m_next;		//!< next byte to read
+		const char* m_end;		//!< one past the body
+
+		void Require(std::size_t numBytes) const
+		{
+			if (static_cast<std::size_t>(m_end - m_next) < numBytes)
+			{
+				throw CProtocolError();
+			}
+		}
+
+		std::uint64_t ReadLittleEndian(std::size_t numBytes)
+		{
+			Require(numBytes);
+			std::uint64_t value = 0;
+			for (std::size_t i = numBytes; i > 0; --i)
+			{
+				value = (value << 8) | static_cast<unsigned char>(m_next[i - 1]);
+			}
+			m_next += numBytes;
+			return value;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,436 @@
+//********************************************************************
+//  FILE NAME:      PqueueServer.h
+//
+//  DESCRIPTION:    Server hosting named priority queues for other
+//					processes over a unix or tcp socket, speaking the
+//					protocol in PqueueProtocol.h. One thread serves
+//					every connection with epoll. Linux only.
+//*********************************************************************
+#ifndef PQUEUE_SERVER_20261018_H
+#define PQUEUE_SERVER_20261018_H
+
+#include <cerrno>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "PqueueProtocol.h"
+#include "PqueueSocket.h"
+#include "StableHeap.h"
+
+namespace pqueue
+{
+	//! Responsible for serving named queues to clients. Queues are created
+	//! by the first OP_OPEN of their name and live as long as the server.
+	//! Requests are answered in the order each connection sent them, and
+	//! every request a read brings in is answered before the next wait, so
+	//! pipelined requests share system calls. A client that sends requests
+	//! without reading the responses is only served until its unsent
+	//! responses pass a limit; the server then stops reading from it until
+	//! they are written, so what it holds for the client stays bounded.
+	class CPqueueServer
+	{
+	public:
+		//************************************************************************
+		//! @details
+		//!   Start listening. A unix socket's path is removed first if it
+		//!  exists, and again when the server is destroyed.
+		//!
+		//! @param[in] address
+		//!   "unix:PATH" or "tcp:A.B.C.D:PORT", port 0 for any free port
+		//! @param[in] maxPendingResponseBytes
+		//!   unsent response bytes a connection may have before the server
+		//!  stops reading its requests. A response already started is always
+		//!  finished, so a connection can hold up to a frame more.
+		//!
+		//! @throw CSocketError
+		//!   if the address is invalid or can't be listened on
+		//!************************************************************************
+		explicit CPqueueServer(const std::string& address, std::size_t maxPendingResponseBytes = 4 * MAX_FRAME_SIZE) :
+		  m_epoll(epoll_create1(EPOLL_CLOEXEC)),
+		  m_stopEvent(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+		  m_maxPendingResponseBytes(maxPendingResponseBytes)
+		{
+			if (!ParseSocketAddress(address, m_address) || m_epoll.Get() < 0 || m_stopEvent.Get() < 0)
+			{
+				throw CSocketError();
+			}
+			m_listener.Reset(socket(m_address.storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0));
+			const int isReused = 1;
+			if (!m_address.unixPath.empty())
+			{
+				unlink(m_address.unixPath.c_str());
+			}
+			else
+			{
+				setsockopt(m_listener.Get(), SOL_SOCKET, SO_REUSEADDR, &isReused, sizeof(isReused));
+			}
+			if (m_listener.Get() < 0 ||
+				bind(m_listener.Get(), reinterpret_cast<const sockaddr*>(&m_address.storage), m_address.length) < 0 ||
+				listen(m_listener.Get(), SOMAXCONN) < 0)
+			{
+				throw CSocketError();
+			}
+			SetNonBlocking(m_listener.Get());
+			Watch(m_listener.Get(), EPOLLIN);
+			Watch(m_stopEvent.Get(), EPOLLIN);
+		}
+
+		~CPqueueServer()
+		{
+			if (!m_address.unixPath.empty())
+			{
+				unlink(m_address.unixPath.c_str());
+			}
+		}
+
+		CPqueueServer(const CPqueueServer&) = delete;
+		CPqueueServer& operator=(const CPqueueServer&) = delete;
+
+		//! @return std::uint16_t
+		//!   the port a tcp server listens on, useful after asking for port 0.
+		//!  0 for a unix socket.
+		std::uint16_t GetTcpPort() const
+		{
+			sockaddr_in bound;
+			socklen_t length = sizeof(bound);
+			if (m_address.storage.ss_family != AF_INET ||
+				getsockname(m_listener.Get(), reinterpret_cast<sockaddr*>(&bound), &length) < 0)
+			{
+				return 0;
+			}
+			return ntohs(bound.sin_port);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Serve clients until Stop is called. Connections still open then
+		//!  are closed.
+		//!
+		//! @throw CSocketError
+		//!   if waiting for events fails
+		//!************************************************************************
+		void Run()
+		{
+			epoll_event events[64];
+			for (;;)
+			{
+				const int numEvents = epoll_wait(m_epoll.Get(), events, 64, -1);
+				if (numEvents < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw CSocketError();
+				}
+				for (int i = 0; i < numEvents; ++i)
+				{
+					const int fd = events[i].data.fd;
+					if (fd == m_stopEvent.Get())
+					{
+						m_connections.clear();
+						return;
+					}
+					if (fd == m_listener.Get())
+					{
+						AcceptAll();
+					}
+					else
+					{
+						ServeConnection(fd, events[i].events);
+					}
+				}
+			}
+		}
+
+		//! Make Run return. Safe to call from any thread.
+		void Stop()
+		{
+			const std::uint64_t one = 1;
+			ssize_t written = write(m_stopEvent.Get(), &one, sizeof(one));
+			(void)written;
+		}
+
+	private:
+		typedef CPackedStableHeap<std::int64_t, std::string> Queue_t;
+
+		//! A client connection and its unprocessed bytes
+		struct CConnection
+		{
+			CFileDescriptor socket;		//!< the connection
+			std::string received;		//!< bytes read but not yet processed
+			std::string toSend;			//!< responses not yet written
+			std::size_t sentBytes;		//!< bytes of toSend already written
+			bool isReceiveClosed;		//!< the peer has sent all it will, close once toSend is written
+			std::uint32_t watchedEvents;	//!< events the epoll set watches the socket for
+		};
+
+		CSocketAddress m_address;							//!< where the server listens
+		CFileDescriptor m_epoll;							//!< every socket the server watches
+		CFileDescriptor m_stopEvent;						//!< signalled by Stop
+		CFileDescriptor m_listener;							//!< accepts connections
+		std::map< int, std::unique_ptr<CConnection> > m_connections;	//!< by socket
+		std::vector< std::unique_ptr<Queue_t> > m_queues;	//!< by queue id
+		std::map<std::string, std::uint32_t> m_queueIds;	//!< queue id by name
+		std::size_t m_maxPendingResponseBytes;				//!< see the constructor
+
+		void Watch(int fd, std::uint32_t events)
+		{
+			epoll_event event;
+			event.events = events;
+			event.data.fd = fd;
+			if (epoll_ctl(m_epoll.Get(), EPOLL_CTL_ADD, fd, &event) < 0)
+			{
+				throw CSocketError();
+			}
+		}
+
+		void AcceptAll()
+		{
+			for (;;)
+			{
+				const int fd = accept4(m_listener.Get(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (fd < 0)
+				{
+					return;
+				}
+				std::unique_ptr<CConnection> connection(new CConnection());
+				connection->socket.Reset(fd);
+				connection->sentBytes = 0;
+				connection->isReceiveClosed = false;
+				connection->watchedEvents = EPOLLIN | EPOLLRDHUP;
+				SetNoDelay(fd, m_address);
+				Watch(fd, connection->watchedEvents);
+				m_connections[fd] = std::move(connection);
+			}
+		}
+
+		//! Read what has arrived, answer the complete requests and send the
+		//! responses, answering more as the responses drain. On EOF the
+		//! connection is closed once the responses to everything received are
+		//! written; on an error or a bad frame, at once.
+		void ServeConnection(int fd, std::uint32_t events)
+		{
+			std::map< int, std::unique_ptr<CConnection> >::iterator found = m_connections.find(fd);
+			if (found == m_connections.end())
+			{
+				// closed earlier in the same batch of events
+				return;
+			}
+			CConnection& connection = *found->second;
+			bool isOpen = (events & EPOLLERR) == 0;
+			if (isOpen && IsReceiving(connection) && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) != 0)
+			{
+				connection.isReceiveClosed = !ReceiveAll(connection);
+			}
+			try
+			{
+				std::size_t bodySize = 0;
+				do
+				{
+					ProcessFrames(connection);
+					isOpen = isOpen && SendPending(connection);
+				}
+				while (isOpen && connection.toSend.size() < m_maxPendingResponseBytes &&
+					CFrameReader::HasCompleteFrame(connection.received.data(), connection.received.size(), bodySize));
+			}
+			catch (CProtocolError&)
+			{
+				isOpen = false;
+			}
+			// done once the peer has sent its last request and had every answer
+			if (!isOpen || (connection.isReceiveClosed && connection.toSend.empty()))
+			{
+				// closing the socket removes it from the epoll set
+				m_connections.erase(fd);
+			}
+		}
+
+		//! @return bool
+		//!   true while the connection's requests are read, until the peer
+		//!  has sent its last and while its unsent responses are under the
+		//!  limit
+		bool IsReceiving(const CConnection& connection) const
+		{
+			return !connection.isReceiveClosed && connection.toSend.size() < m_maxPendingResponseBytes;
+		}
+
+		//! Read what has arrived, stopping once a whole frame of the largest
+		//! size could be held so one read can't buffer without bound
+		//! @return bool
+		//!   false if the peer has closed the connection or it failed
+		bool ReceiveAll(CConnection& connection)
+		{
+			char buffer[65536];
+			while (connection.received.size() < FRAME_HEADER_SIZE + MAX_FRAME_SIZE)
+			{
+				const ssize_t numRead = read(connection.socket.Get(), buffer, sizeof(buffer));
+				if (numRead > 0)
+				{
+					connection.received.append(buffer, static_cast<std::size_t>(numRead));
+					continue;
+				}
+				return numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+			}
+			// the rest is read when the socket is next readable
+			return true;
+		}
+
+		//! Write as much of the pending responses as the socket takes,
+		//! watching for it to become writable if some are left, and for
+		//! more requests while IsReceiving
+		//! @return bool
+		//!   false if the connection failed
+		bool SendPending(CConnection& connection)
+		{
+			while (connection.sentBytes < connection.toSend.size())
+			{
+				const ssize_t numWritten = send(connection.socket.Get(), connection.toSend.data() + connection.sentBytes,
+					connection.toSend.size() - connection.sentBytes, MSG_NOSIGNAL);
+				if (numWritten < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+					{
+						return false;
+					}
+					break;
+				}
+				connection.sentBytes += static_cast<std::size_t>(numWritten);
+			}
+			if (connection.sentBytes == connection.toSend.size())
+			{
+				connection.toSend.clear();
+				connection.sentBytes = 0;
+			}
+			const std::uint32_t watchedEvents = (IsReceiving(connection) ? static_cast<std::uint32_t>(EPOLLIN | EPOLLRDHUP) : 0) |
+				(connection.toSend.empty() ? 0 : static_cast<std::uint32_t>(EPOLLOUT));
+			if (watchedEvents != connection.watchedEvents)
+			{
+				epoll_event event;
+				event.events = watchedEvents;
+				event.data.fd = connection.socket.Get();
+				epoll_ctl(m_epoll.Get(), EPOLL_CTL_MOD, connection.socket.Get(), &event);
+				connection.watchedEvents = watchedEvents;
+			}
+			return true;
+		}
+
+		//! Answer the complete requests received, leaving a partial one, and
+		//! leaving the rest once the unsent responses reach the limit
+		//! @throw CProtocolError if a frame is too large
+		void ProcessFrames(CConnection& connection)
+		{
+			std::size_t processed = 0;
+			std::size_t bodySize = 0;
+			while (connection.toSend.size() < m_maxPendingResponseBytes &&
+				CFrameReader::HasCompleteFrame(connection.received.data() + processed, connection.received.size() - processed, bodySize))
+			{
+				CFrameReader request(connection.received.data() + processed + FRAME_HEADER_SIZE, bodySize);
+				CFrameWriter response(connection.toSend);
+				Answer(request, response);
+				response.Finish();
+				processed += FRAME_HEADER_SIZE + bodySize;
+			}
+			connection.received.erase(0, processed);
+		}
+
+		//! Carry out one request. Malformed requests are answered with
+		//! STATUS_BAD_REQUEST; whatever part of a batch was read before the
+		//! error has been applied.
+		void Answer(CFrameReader& request, CFrameWriter& response)
+		{
+			try
+			{
+				const std::uint8_t op = request.ReadU8();
+				if (op == OP_OPEN)
+				{
+					std::string name;
+					request.ReadBytes(request.ReadU16(), name);
+					std::map<std::string, std::uint32_t>::const_iterator found = m_queueIds.find(name);
+					std::uint32_t queueId = 0;
+					if (found != m_queueIds.end())
+					{
+						queueId = found->second;
+					}
+					else
+					{
+						queueId = static_cast<std::uint32_t>(m_queues.size());
+						m_queues.push_back(std::unique_ptr<Queue_t>(new Queue_t()));
+						m_queueIds[name] = queueId;
+					}
+					response.WriteU8(STATUS_OK);
+					response.WriteU32(queueId);
+					return;
+				}
+				if (op != OP_PUSH && op != OP_POP && op != OP_SIZE)
+				{
+					response.WriteU8(STATUS_BAD_REQUEST);
+					return;
+				}
+				const std::uint32_t queueId = request.ReadU32();
+				if (queueId >= m_queues.size())
+				{
+					response.WriteU8(STATUS_UNKNOWN_QUEUE);
+					return;
+				}
+				Queue_t& queue = *m_queues[queueId];
+				if (op == OP_PUSH)
+				{
+					CQueueItem item;
+					for (std::uint32_t numItems = request.ReadU32(); numItems > 0; --numItems)
+					{
+						request.ReadItem(item);
+						queue.Push(item.priority, item.payload);
+					}
+					response.WriteU8(STATUS_OK);
+					response.WriteU64(queue.GetSize());
+				}
+				else if (op == OP_POP)
+				{
+					// the count goes before the items, so pop them first, stopping
+					// at the first that would take the response past MAX_FRAME_SIZE
+					const std::uint32_t maxCount = request.ReadU32();
+					std::size_t responseSize = 1 + 4;
+					std::vector<CQueueItem> items;
+					while (items.size() < maxCount && queue.GetSize() > 0 &&
+						responseSize + GetEncodedItemSize(queue.PeekTop().size()) <= MAX_FRAME_SIZE)
+					{
+						CQueueItem item;
+						item.priority = queue.PeekTopPriority();
+						queue.PopTop(item.payload);
+						responseSize += GetEncodedItemSize(item.payload.size());
+						items.push_back(std::move(item));
+					}
+					response.WriteU8(STATUS_OK);
+					response.WriteU32(static_cast<std::uint32_t>(items.size()));
+					for (std::size_t i = 0; i < items.size(); ++i)
+					{
+						response.WriteItem(items[i]);
+					}
+				}
+				else
+				{
+					response.WriteU8(STATUS_OK);
+					response.WriteU64(queue.GetSize());
+				}
+			}
+			catch (CProtocolError&)
+			{
+				response.Reset();
+				response.WriteU8(STATUS_BAD_REQUEST);
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,159 @@
+//********************************************************************
+//  FILE NAME:      PqueueSocket.h
+//
+//  DESCRIPTION:    POSIX socket helpers shared by CPqueueServer and
+//					CPqueueClient. Addresses are written
+//					"unix:/path/to/socket" or "tcp:host:port" with a
+//					numeric IPv4 host.
+//*********************************************************************
+#ifndef PQUEUE_SOCKET_20261018_H
+#define PQUEUE_SOCKET_20261018_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace pqueue
+{
+	//! Exception thrown when a socket can't be created, connected or used,
+	//! or the peer has gone away
+	class CSocketError {};
+
+	//! Responsible for closing a file descriptor
+	class CFileDescriptor
+	{
+	public:
+		explicit CFileDescriptor(int fd = -1) : m_fd(fd) {}
+
+		~CFileDescriptor()
+		{
+			Reset();
+		}
+
+		//! Move only, a descriptor is closed once
+		CFileDescriptor(const CFileDescriptor&) = delete;
+		CFileDescriptor& operator=(const CFileDescriptor&) = delete;
+
+		CFileDescriptor(CFileDescriptor&& other) : m_fd(other.m_fd)
+		{
+			other.m_fd = -1;
+		}
+
+		CFileDescriptor& operator=(CFileDescriptor&& other)
+		{
+			if (&other != this)
+			{
+				Reset(other.m_fd);
+				other.m_fd = -1;
+			}
+			return *this;
+		}
+
+		int Get() const
+		{
+			return m_fd;
+		}
+
+		//! Close the current descriptor, if any, and take over fd
+		void Reset(int fd = -1)
+		{
+			if (m_fd >= 0)
+			{
+				close(m_fd);
+			}
+			m_fd = fd;
+		}
+
+	private:
+		int m_fd;	//!< the descriptor, -1 for none
+	};
+
+	//! A parsed socket address
+	struct CSocketAddress
+	{
+		sockaddr_storage storage;	//!< sockaddr_un or sockaddr_in
+		socklen_t length;			//!< bytes of storage used
+		std::string unixPath;		//!< path of a unix socket, empty for tcp
+	};
+
+	//************************************************************************
+	//! @details
+	//!   Parse "unix:PATH" or "tcp:A.B.C.D:PORT"
+	//!
+	//! @return bool
+	//!   false if text is neither, or the path is too long for a socket
+	//!************************************************************************
+	inline bool ParseSocketAddress(const std::string& text, CSocketAddress& address)
+	{
+		std::memset(&address.storage, 0, sizeof(address.storage));
+		address.unixPath.clear();
+		if (text.compare(0, 5, "unix:") == 0)
+		{
+			sockaddr_un* unixAddress = reinterpret_cast<sockaddr_un*>(&address.storage);
+			const std::string path = text.substr(5);
+			if (path.empty() || path.size() >= sizeof(unixAddress->sun_path))
+			{
+				return false;
+			}
+			unixAddress->sun_family = AF_UNIX;
+			std::memcpy(unixAddress->sun_path, path.c_str(), path.size() + 1);
+			address.length = sizeof(sockaddr_un);
+			address.unixPath = path;
+			return true;
+		}
+		if (text.compare(0, 4, "tcp:") == 0)
+		{
+			const std::string::size_type colon = text.rfind(':');
+			if (colon <= 4)
+			{
+				return false;
+			}
+			const std::string host = text.substr(4, colon - 4);
+			char* portEnd = NULL;
+			const unsigned long port = std::strtoul(text.c_str() + colon + 1, &portEnd, 10);
+			sockaddr_in* inetAddress = reinterpret_cast<sockaddr_in*>(&address.storage);
+			if (*portEnd != '\0' || colon + 1 == text.size() || port > 65535 ||
+				inet_pton(AF_INET, host.c_str(), &inetAddress->sin_addr) != 1)
+			{
+				return false;
+			}
+			inetAddress->sin_family = AF_INET;
+			inetAddress->sin_port = htons(static_cast<std::uint16_t>(port));
+			address.length = sizeof(sockaddr_in);
+			return true;
+		}
+		return false;
+	}
+
+	//! Make fd's reads and writes return instead of waiting
+	inline void SetNonBlocking(int fd)
+	{
+		const int flags = fcntl(fd, F_GETFL, 0);
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		{
+			throw CSocketError();
+		}
+	}
+
+	//! Send small frames at once rather than waiting to fill a packet. Does
+	//! nothing for unix sockets.
+	inline void SetNoDelay(int fd, const CSocketAddress& address)
+	{
+		if (address.storage.ss_family == AF_INET)
+		{
+			const int isNoDelay = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &isNoDelay, sizeof(isNoDelay));
+		}
+	}
+}
+
+#endif
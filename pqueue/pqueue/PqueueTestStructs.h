@@ -0,0 +1,101 @@
+//********************************************************************
+//  FILE NAME:      PqueueTestStructs.h
+//
+//  DESCRIPTION:    Record type and sort orders shared by the pqueue
+//					tests and benchmarks
+//
+//*********************************************************************
+#ifndef PQUEUE_TEST_STRUCTS_20261018_H
+#define PQUEUE_TEST_STRUCTS_20261018_H
+
+#include "CustomSortPred.h"
+#include "NormalizedSortKey.h"
+#include <memory>
+#include <string>
+
+namespace pqueue
+{
+	//! The following classes are to test the composite sorting
+
+	//!
+	struct CTestStruct
+	{
+		unsigned int criteriaA;
+		double criteriaB;
+		std::string criteriaC;
+
+		CTestStruct(const unsigned int& critA, const double& critB, const std::string& critC) :
+		criteriaA(critA), criteriaB(critB), criteriaC(critC)
+		{
+
+		}
+	};
+
+	typedef std::shared_ptr< ISortOrder<CTestStruct> > ISortOrderTestStructPtr;
+
+	//! Sort on criteria A
+	class CSortOnCriteriaA : public ISortOrder<CTestStruct>
+	{
+	public:
+		CSortOnCriteriaA() {}
+
+		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return lhs.criteriaA < rhs.criteriaA;
+		}
+
+		int Compare(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return ThreeWayCompare(lhs.criteriaA, rhs.criteriaA);
+		}
+	};
+	
+	//! Sort on criteria B
+	class CSortOnCriteriaB : public ISortOrder<CTestStruct>
+	{
+	public:
+		CSortOnCriteriaB() {}
+
+		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return lhs.criteriaB < rhs.criteriaB;
+		}
+
+		int Compare(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return ThreeWayCompare(lhs.criteriaB, rhs.criteriaB);
+		}
+	};
+
+	//! Sort on criteria C
+	class CSortOnCriteriaC : public ISortOrder<CTestStruct>
+	{
+	public:
+		CSortOnCriteriaC() {}
+
+		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return lhs.criteriaC < rhs.criteriaC;
+		}
+
+		int Compare(const CTestStruct& lhs, const CTestStruct& rhs) const
+		{
+			return lhs.criteriaC.compare(rhs.criteriaC);
+		}
+	};
+
+	//! Encode criteria A then B then C, agrees with a composite sort on
+	//! A then B then C
+	class CTestStructSortKeyEncoder : public ISortKeyEncoder<CTestStruct>
+	{
+	public:
+		void EncodeSortKey(const CTestStruct& item, CSortKeyBuilder& key) const
+		{
+			key.AppendUnsigned(item.criteriaA);
+			key.AppendDouble(item.criteriaB);
+			key.AppendString(item.criteriaC);
+		}
+	};
+}
+
+#endif
\ No newline at end of file
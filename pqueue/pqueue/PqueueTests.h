@@ -25,6 +25,77 @@ namespace pqueue
 	//! Test the pqueue class
 	void TestPqueue();
 
+	//! Test changing a pqueue's sort order lazily
+	void TestLazySortOrderChange();
+
+	//! Test the flattened and compile-time composite sorts
+	void TestStaticCompositeSort();
+
+	//! Test the normalized sort keys
+	void TestNormalizedSortKey();
+
+	//! Test the radix heap
+	void TestRadixHeap();
+
+	//! Test the timer wheel
+	void TestTimerWheel();
+
+	//! Test the min-max heap and the double-ended queue
+	void TestMinMaxHeap();
+
+	//! Test merging heaps and priority queues
+	void TestHeapMerge();
+
+	//! Test draining heaps in order with several threads
+	void TestParallelHeapDrain();
+
+#if defined(__cpp_impl_coroutine)
+	//! Test the coroutine priority queue
+	void TestAsyncPqueue();
+#endif
+
+	//! Test the blocking bounded queue
+	void TestBlockingPqueue();
+
+	//! Test the heap and queue statistics
+	void TestHeapStats();
+
+	//! Test recording and reading queue traces
+	void TestPqueueTrace();
+
+	//! Test moving heaps and queues
+	void TestHeapMove();
+
+	//! Test ordered and unordered reads of heaps and queues
+	void TestHeapTopK();
+
+	//! Test first in, first out tie breaking
+	void TestStableHeap();
+
+	//! Test priorities that grow while items wait
+	void TestAgingPqueue();
+
+	//! Test heaps with inline storage
+	void TestSmallHeap();
+
+	//! Test the fixed capacity, constexpr heap
+	void TestStaticHeap();
+
+	//! Test popping many heaps in lockstep
+	void TestPopTopInterleaved();
+
+	//! Test the queue server and its client, Linux only
+	void TestPqueueServer();
+
+	//! Test the queue shared between processes, Linux only
+	void TestSharedPqueue();
+
+	//! Test the cache evicting by LFU, GreedyDual and TTL policies
+	void TestEvictionCache();
+
+	//! Test the weighted fair queueing scheduler and its fairness bound
+	void TestWfqScheduler();
+
 }
 
 
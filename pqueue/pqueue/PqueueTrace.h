@@ -0,0 +1,260 @@
+//********************************************************************
+//  FILE NAME:      PqueueTrace.h
+//
+//  DESCRIPTION:    Recording of priority queue workloads. Operations
+//					on a CPqueue are logged to a compact binary trace
+//					that can be read back and replayed against any
+//					queue implementation.
+//*********************************************************************
+#ifndef PQUEUE_TRACE_20261018_H
+#define PQUEUE_TRACE_20261018_H
+
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+namespace pqueue
+{
+	//! Kinds of operations in a trace
+	enum ETraceOp
+	{
+		TRACE_PUSH = 0,					//!< key is the pushed item's trace key
+		TRACE_POP_FRONT = 1,
+		TRACE_PEEK_FRONT = 2,
+		TRACE_CHANGE_SORT_ORDER = 3,	//!< key counts the changes, 1 for the first
+		NUM_TRACE_OPS
+	};
+
+	//! One recorded operation
+	struct CTraceOp
+	{
+		ETraceOp op;					//!< what was done
+		std::uint64_t key;			//!< see ETraceOp, 0 if the op has none
+		std::uint64_t timestampNs;	//!< nanoseconds since recording started
+	};
+
+	//! Exception thrown when a trace can't be read
+	class CTraceFormatError {};
+
+	//! Responsible for writing trace operations to a stream. The stream
+	//! starts with an 8 byte magic, then each operation is an op byte, a
+	//! key for pushes and sort order changes and the time since the
+	//! previous operation. Numbers are written as base 128 varints, so a
+	//! typical push takes 3 to 6 bytes.
+	class CTraceWriter
+	{
+	public:
+		//************************************************************************
+		//! @param[in] out
+		//!   binary stream to write to, must outlive the writer
+		//!************************************************************************
+		explicit CTraceWriter(std::ostream& out) :
+		  m_out(out),
+		  m_lastTimestampNs(0)
+		{
+			m_out.write(GetMagic(), MAGIC_SIZE);
+		}
+
+		//! Append op to the trace. Timestamps must not decrease.
+		void Write(const CTraceOp& op)
+		{
+			m_out.put(static_cast<char>(op.op));
+			if (HasKey(op.op))
+			{
+				WriteVarint(op.key);
+			}
+			WriteVarint(op.timestampNs - m_lastTimestampNs);
+			m_lastTimestampNs = op.timestampNs;
+		}
+
+		//! Push buffered bytes to the stream
+		void Flush()
+		{
+			m_out.flush();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Read a whole trace back
+		//!
+		//! @param[in] in
+		//!   binary stream positioned at the start of a trace
+		//! @param[out] ops
+		//!   receives the operations in order. Any previous contents are
+		//!  discarded.
+		//!
+		//! @throw CTraceFormatError
+		//!   if the magic is wrong, an op is unknown or the trace is cut off
+		//!  inside an operation
+		//!************************************************************************
+		static void ReadTrace(std::istream& in, std::vector<CTraceOp>& ops)
+		{
+			ops.clear();
+			char magic[MAGIC_SIZE];
+			if (!in.read(magic, MAGIC_SIZE) || std::char_traits<char>::compare(magic, GetMagic(), MAGIC_SIZE) != 0)
+			{
+				throw CTraceFormatError();
+			}
+			std::uint64_t timestampNs = 0;
+			for (int opByte = in.get(); opByte != std::char_traits<char>::eof(); opByte = in.get())
+			{
+				if (opByte >= NUM_TRACE_OPS)
+				{
+					throw CTraceFormatError();
+				}
+				CTraceOp op;
+				op.op = static_cast<ETraceOp>(opByte);
+				op.key = HasKey(op.op) ? ReadVarint(in) : 0;
+				timestampNs += ReadVarint(in);
+				op.timestampNs = timestampNs;
+				ops.push_back(op);
+			}
+		}
+
+		CTraceWriter(const CTraceWriter&) = delete;
+		CTraceWriter& operator=(const CTraceWriter&) = delete;
+
+	private:
+		enum { MAGIC_SIZE = 8 };
+
+		std::ostream& m_out;				//!< where the trace goes
+		std::uint64_t m_lastTimestampNs;	//!< timestamp of the previous op
+
+		static const char* GetMagic()
+		{
+			return "PQTRACE1";
+		}
+
+		static bool HasKey(ETraceOp op)
+		{
+			return op == TRACE_PUSH || op == TRACE_CHANGE_SORT_ORDER;
+		}
+
+		//! Write value 7 bits at a time, low bits first, the high bit of a
+		//! byte set when more follow
+		void WriteVarint(std::uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				m_out.put(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			m_out.put(static_cast<char>(value));
+		}
+
+		static std::uint64_t ReadVarint(std::istream& in)
+		{
+			std::uint64_t value = 0;
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				const int byte = in.get();
+				if (byte == std::char_traits<char>::eof())
+				{
+					throw CTraceFormatError();
+				}
+				value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					return value;
+				}
+			}
+			throw CTraceFormatError();
+		}
+	};
+
+	//! Interface for reducing an item to the key recorded for it in a trace,
+	//! usually its priority
+	template <class T>
+	class ITraceKeyEncoder
+	{
+	public:
+		virtual ~ITraceKeyEncoder() {}
+
+		virtual std::uint64_t GetTraceKey(const T& item) const = 0;
+	};
+
+	//! Responsible for recording the operations of a CPqueue, see
+	//! CPqueue::SetTraceRecorder. Timestamps count from the recorder's
+	//! construction.
+	template <class T>
+	class CPqueueTraceRecorder
+	{
+	public:
+		typedef std::shared_ptr< ITraceKeyEncoder<T> > ITraceKeyEncoderPtr;	//!< typedef for a key encoder for T
+
+		//************************************************************************
+		//! @param[in] out
+		//!   binary stream to write the trace to, must outlive the recorder
+		//! @param[in] keyEncoder
+		//!   gives the key recorded for each pushed item
+		//!************************************************************************
+		CPqueueTraceRecorder(std::ostream& out, const ITraceKeyEncoderPtr& keyEncoder) :
+		  m_writer(out),
+		  m_keyEncoder(keyEncoder),
+		  m_start(std::chrono::steady_clock::now()),
+		  m_numSortOrderChanges(0),
+		  m_numRecorded(0)
+		{
+		}
+
+		void RecordPush(const T& item)
+		{
+			const std::uint64_t key = m_keyEncoder->GetTraceKey(item);
+			Record(TRACE_PUSH, key);
+		}
+
+		void RecordPopFront()
+		{
+			Record(TRACE_POP_FRONT, 0);
+		}
+
+		void RecordPeekFront()
+		{
+			Record(TRACE_PEEK_FRONT, 0);
+		}
+
+		void RecordChangeSortOrder()
+		{
+			Record(TRACE_CHANGE_SORT_ORDER, ++m_numSortOrderChanges);
+		}
+
+		//! Push buffered operations to the stream
+		void Flush()
+		{
+			m_writer.Flush();
+		}
+
+		//! @return std::uint64_t
+		//!   number of operations recorded so far
+		std::uint64_t GetNumRecorded() const
+		{
+			return m_numRecorded;
+		}
+
+		CPqueueTraceRecorder(const CPqueueTraceRecorder&) = delete;
+		CPqueueTraceRecorder& operator=(const CPqueueTraceRecorder&) = delete;
+
+	private:
+		CTraceWriter m_writer;							//!< encodes the operations
+		ITraceKeyEncoderPtr m_keyEncoder;				//!< keys of pushed items
+		std::chrono::steady_clock::time_point m_start;	//!< time 0 of the trace
+		std::uint64_t m_numSortOrderChanges;			//!< key of the latest sort order change
+		std::uint64_t m_numRecorded;					//!< operations written
+
+		void Record(ETraceOp opType, std::uint64_t key)
+		{
+			CTraceOp op;
+			op.op = opType;
+			op.key = key;
+			op.timestampNs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+			m_writer.Write(op);
+			++m_numRecorded;
+		}
+	};
+}
+
+#endif
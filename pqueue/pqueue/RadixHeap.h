@@ -0,0 +1,197 @@
+//********************************************************************
+//  FILE NAME:      RadixHeap.h
+//
+//  DESCRIPTION:    Radix heap, a priority queue for unsigned integer
+//					keys where the extracted keys never decrease (timers,
+//					Dijkstra). Items are bucketed by the highest bit in
+//					which their key differs from the last extracted key
+//					instead of being sifted by comparisons.
+//*********************************************************************
+#ifndef RADIX_HEAP_20261018_H
+#define RADIX_HEAP_20261018_H
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pqueue
+{
+	//! Responsible for keeping (key, value) items in order of increasing key,
+	//! the smallest key at the front. Push is O(1), PopFront is amortized
+	//! O(log C) where C is the spread of keys in the queue. Keys pushed must
+	//! be no smaller than the front key last seen by PeekFront or PopFront.
+	template <class Key, class Value>
+	class CRadixHeap
+	{
+		static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "radix heap keys must be unsigned integers");
+
+	public:
+		typedef std::pair<Key, Value> Item_t;		//!< key and the value queued with it
+
+		//! Exception thrown if an empty queue is accessed
+		class CCannotAccessEmptyHeap {};
+
+		//! Exception thrown if a key smaller than the last front key is pushed
+		class CKeyBelowFront {};
+
+		//************************************************************************
+		//! @details
+		//!   Construct an empty radix heap. Nothing has been at the front yet,
+		//!  so any key may be pushed.
+		//!************************************************************************
+		CRadixHeap() :
+		  m_buckets(NUM_BUCKETS),
+		  m_lastKey(0),
+		  m_size(0)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Place a new item in line based on its key
+		//!
+		//! @param[in] key
+		//!   priority of the item, smaller keys come out first
+		//! @param[in] value
+		//!   data queued with the key
+		//!
+		//! @throw CKeyBelowFront
+		//!   if key is smaller than the front key last seen by PeekFront or
+		//!  PopFront
+		//!************************************************************************
+		void Push(const Key& key, const Value& value)
+		{
+			if (key < m_lastKey)
+			{
+				throw CKeyBelowFront();
+			}
+			m_buckets[GetBucketIndex(key)].push_back(Item_t(key, value));
+			++m_size;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Look at the front of the queue, the item with the smallest key
+		//!
+		//! @return const Item_t&
+		//!    the front item. Any item with the smallest key may be returned.
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty queue
+		//!************************************************************************
+		const Item_t& PeekFront() const
+		{
+			RefillFrontBucket();
+			return m_buckets[0].back();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove the front of the queue
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	thrown on access of empty queue
+		//!************************************************************************
+		void PopFront()
+		{
+			RefillFrontBucket();
+			m_buckets[0].pop_back();
+			--m_size;
+		}
+
+		//************************************************************************
+		//! @return std::size_t
+		//!    number of queued items
+		//!************************************************************************
+		std::size_t GetSize() const
+		{
+			return m_size;
+		}
+
+		//! Move only, the queued items are never copied with it
+		CRadixHeap(const CRadixHeap&) = delete;
+		CRadixHeap& operator=(const CRadixHeap&) = delete;
+		CRadixHeap(CRadixHeap&&) = default;
+		CRadixHeap& operator=(CRadixHeap&&) = default;
+
+	private:
+		//! Bucket 0 holds keys equal to m_lastKey, bucket i holds keys whose
+		//! highest bit differing from m_lastKey is bit i - 1
+		static const std::size_t NUM_BUCKETS = std::numeric_limits<Key>::digits + 1;
+
+		mutable std::vector< std::vector<Item_t> > m_buckets;	//!< items bucketed by distance from m_lastKey
+		mutable Key m_lastKey;		//!< front key last seen, the lower bound on pushed keys
+		std::size_t m_size;			//!< number of items in all the buckets
+
+		//************************************************************************
+		//! @return std::size_t
+		//!   the bucket a key belongs in relative to m_lastKey: one more than
+		//!  the index of the highest bit where they differ, 0 if they're equal
+		//!************************************************************************
+		std::size_t GetBucketIndex(const Key& key) const
+		{
+			Key diff = static_cast<Key>(key ^ m_lastKey);
+			std::size_t bucket = 0;
+			// binary search for the highest set bit
+			for (std::size_t shift = NUM_BUCKETS / 2; shift > 0; shift /= 2)
+			{
+				if ((diff >> shift) != 0)
+				{
+					diff = static_cast<Key>(diff >> shift);
+					bucket += shift;
+				}
+			}
+			return diff != 0 ? bucket + 1 : 0;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Make sure bucket 0 holds the smallest keys. If it is empty, the
+		//!  smallest key in the first non-empty bucket becomes m_lastKey and
+		//!  that bucket's items are redistributed. They all land in lower
+		//!  buckets, which is what bounds the work per item.
+		//!
+		//! @throw CCannotAccessEmptyHeap
+		//!	if the queue is empty
+		//!************************************************************************
+		void RefillFrontBucket() const
+		{
+			if (m_size == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			if (!m_buckets[0].empty())
+			{
+				return;
+			}
+			std::size_t bucketIdx = 1;
+			while (m_buckets[bucketIdx].empty())
+			{
+				++bucketIdx;
+			}
+			std::vector<Item_t> redistributed;
+			redistributed.swap(m_buckets[bucketIdx]);
+
+			typename std::vector<Item_t>::const_iterator currItem = redistributed.begin();
+			Key minKey = currItem->first;
+			for (++currItem; currItem != redistributed.end(); ++currItem)
+			{
+				if (currItem->first < minKey)
+				{
+					minKey = currItem->first;
+				}
+			}
+			m_lastKey = minKey;
+			for (currItem = redistributed.begin(); currItem != redistributed.end(); ++currItem)
+			{
+				m_buckets[GetBucketIndex(currItem->first)].push_back(*currItem);
+			}
+			// keep the emptied bucket's storage for reuse
+			redistributed.clear();
+			m_buckets[bucketIdx].swap(redistributed);
+		}
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,307 @@
+//********************************************************************
+//  FILE NAME:      SharedPqueue.h
+//
+//  DESCRIPTION:    Priority queue shared by processes on one machine.
+//					The heap and its lock live in a POSIX shared memory
+//					object, so pushes and pops are plain memory
+//					operations with no system call unless the lock is
+//					contended. Linux only.
+//*********************************************************************
+#ifndef SHARED_PQUEUE_20261018_H
+#define SHARED_PQUEUE_20261018_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "StaticHeap.h"
+
+namespace pqueue
+{
+	//! Exception thrown when a shared queue can't be created, opened or
+	//! locked, or was created with a different layout
+	class CSharedMemoryError {};
+
+	//! How CSharedPqueue finds its shared memory
+	enum ESharedOpenMode
+	{
+		SHARED_CREATE,	//!< create the object, which must not exist
+		SHARED_OPEN		//!< attach to an object another CSharedPqueue created
+	};
+
+	//! Responsible for a heap of at most Capacity items that any process
+	//! on the machine can open by name. Each process may map the object at
+	//! a different address, so the heap is a CStaticHeap, which holds no
+	//! pointers. T and Compare must be trivially copyable, and Compare must
+	//! hold no state, since every process compares with its own copy.
+	//!
+	//! The lock is a robust process shared mutex. If a process dies while
+	//! holding it, the next process to lock it restores the heap order. The
+	//! item the dead process was pushing, or the item a pop was moving into
+	//! the popped item's place, may then be lost, and in its place another
+	//! item the operation had moved may be in the queue twice. CStaticHeap
+	//! holds the moving item aside, so no other item is affected.
+	template <class T, std::size_t Capacity, class Compare = std::less<T> >
+	class CSharedPqueue
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "items are copied between processes as bytes");
+		static_assert(std::is_empty<Compare>::value && std::is_trivially_copyable<Compare>::value,
+			"each process compares with its own Compare");
+	public:
+		//************************************************************************
+		//! @param[in] name
+		//!   name of the shared memory object, "/name" as for shm_open
+		//! @param[in] mode
+		//!   SHARED_CREATE to create an empty queue. The creator removes the
+		//!  name when destroyed; processes still attached keep the queue
+		//!  until they let go of it. SHARED_OPEN to attach to a queue
+		//!  whose creator's constructor has returned.
+		//!
+		//! @throw CSharedMemoryError
+		//!   if the object can't be created or opened, or was created for
+		//!  a different T or Capacity
+		//!************************************************************************
+		CSharedPqueue(const std::string& name, ESharedOpenMode mode) :
+		  m_name(name),
+		  m_segment(NULL),
+		  m_isCreator(mode == SHARED_CREATE)
+		{
+			const int fd = shm_open(name.c_str(), m_isCreator ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+			if (fd < 0)
+			{
+				throw CSharedMemoryError();
+			}
+			struct stat status;
+			const bool isSized = m_isCreator ? ftruncate(fd, sizeof(CSegment)) == 0 :
+				fstat(fd, &status) == 0 && status.st_size == static_cast<off_t>(sizeof(CSegment));
+			void* memory = isSized ? mmap(NULL, sizeof(CSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+			close(fd);
+			if (memory == MAP_FAILED)
+			{
+				Release();
+				throw CSharedMemoryError();
+			}
+			if (m_isCreator)
+			{
+				m_segment = new (memory) CSegment();
+				if (!InitializeMutex(m_segment->mutex))
+				{
+					Release();
+					throw CSharedMemoryError();
+				}
+				m_segment->layoutSize = sizeof(CSegment);
+				m_segment->capacity = Capacity;
+				m_segment->isReady.store(1, std::memory_order_release);
+			}
+			else
+			{
+				m_segment = static_cast<CSegment*>(memory);
+				if (m_segment->isReady.load(std::memory_order_acquire) != 1 ||
+					m_segment->layoutSize != sizeof(CSegment) || m_segment->capacity != Capacity)
+				{
+					Release();
+					throw CSharedMemoryError();
+				}
+			}
+		}
+
+		~CSharedPqueue()
+		{
+			Release();
+		}
+
+		//! Move only, each object maps the queue once
+		CSharedPqueue(const CSharedPqueue&) = delete;
+		CSharedPqueue& operator=(const CSharedPqueue&) = delete;
+
+		CSharedPqueue(CSharedPqueue&& other) :
+		  m_name(other.m_name),
+		  m_segment(other.m_segment),
+		  m_isCreator(other.m_isCreator)
+		{
+			other.m_segment = NULL;
+			other.m_isCreator = false;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Push t unless the queue is full
+		//!
+		//! @return bool
+		//!   false if the queue was full and t was not pushed
+		//!
+		//! @throw CSharedMemoryError
+		//!   if the lock can't be taken
+		//!************************************************************************
+		bool TryPush(const T& t)
+		{
+			CLock lock(*m_segment);
+			return m_segment->heap.Insert(t);
+		}
+
+		//************************************************************************
+		//! @param[out] top
+		//!   receives the "largest" item, untouched if the queue is empty
+		//!
+		//! @return bool
+		//!   false if the queue is empty
+		//!
+		//! @throw CSharedMemoryError
+		//!   if the lock can't be taken
+		//!************************************************************************
+		bool TryPop(T& top)
+		{
+			CLock lock(*m_segment);
+			return m_segment->heap.PopTop(top);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Push items under one acquisition of the lock, stopping when the
+		//!  queue fills
+		//!
+		//! @return std::size_t
+		//!   number of items pushed, from the front of items
+		//!
+		//! @throw CSharedMemoryError
+		//!   if the lock can't be taken
+		//!************************************************************************
+		std::size_t PushBatch(const T* items, std::size_t numItems)
+		{
+			CLock lock(*m_segment);
+			std::size_t numPushed = 0;
+			while (numPushed < numItems && m_segment->heap.Insert(items[numPushed]))
+			{
+				++numPushed;
+			}
+			return numPushed;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Pop up to maxCount items under one acquisition of the lock
+		//!
+		//! @param[out] items
+		//!   receives the popped items, "largest" first
+		//!
+		//! @return std::size_t
+		//!   number of items popped, fewer than maxCount if the queue ran out
+		//!
+		//! @throw CSharedMemoryError
+		//!   if the lock can't be taken
+		//!************************************************************************
+		std::size_t PopBatch(T* items, std::size_t maxCount)
+		{
+			CLock lock(*m_segment);
+			std::size_t numPopped = 0;
+			while (numPopped < maxCount && m_segment->heap.PopTop(items[numPopped]))
+			{
+				++numPopped;
+			}
+			return numPopped;
+		}
+
+		//! @return std::size_t
+		//!   items in the queue, which other processes may change at once
+		std::size_t GetSize()
+		{
+			CLock lock(*m_segment);
+			return m_segment->heap.GetSize();
+		}
+
+		static constexpr std::size_t GetCapacity()
+		{
+			return Capacity;
+		}
+
+	private:
+		typedef CStaticHeap<T, Capacity, Compare> Heap_t;
+		static_assert(std::is_trivially_copyable<Heap_t>::value, "the heap is shared as bytes");
+
+		//! Everything in the shared memory object
+		struct CSegment
+		{
+			std::atomic<std::uint32_t> isReady;	//!< 1 once the creator has initialized the rest
+			std::uint64_t layoutSize;			//!< sizeof(CSegment) of the creator
+			std::uint64_t capacity;				//!< Capacity of the creator
+			pthread_mutex_t mutex;				//!< guards heap, robust and process shared
+			Heap_t heap;						//!< the queue
+		};
+
+		//! Holds the segment's mutex for its lifetime, repairing the heap if
+		//! the previous holder died
+		class CLock
+		{
+		public:
+			explicit CLock(CSegment& segment) : m_segment(segment)
+			{
+				const int result = pthread_mutex_lock(&m_segment.mutex);
+				if (result == EOWNERDEAD)
+				{
+					m_segment.heap.RestoreOrder();
+					pthread_mutex_consistent(&m_segment.mutex);
+				}
+				else if (result != 0)
+				{
+					throw CSharedMemoryError();
+				}
+			}
+
+			~CLock()
+			{
+				pthread_mutex_unlock(&m_segment.mutex);
+			}
+
+			CLock(const CLock&) = delete;
+			CLock& operator=(const CLock&) = delete;
+
+		private:
+			CSegment& m_segment;	//!< whose mutex is held
+		};
+
+		std::string m_name;		//!< name of the shared memory object
+		CSegment* m_segment;	//!< the mapped object, NULL once moved from
+		bool m_isCreator;		//!< remove the name when destroyed
+
+		static bool InitializeMutex(pthread_mutex_t& mutex)
+		{
+			pthread_mutexattr_t attributes;
+			if (pthread_mutexattr_init(&attributes) != 0)
+			{
+				return false;
+			}
+			const bool isInitialized = pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED) == 0 &&
+				pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST) == 0 &&
+				pthread_mutex_init(&mutex, &attributes) == 0;
+			pthread_mutexattr_destroy(&attributes);
+			return isInitialized;
+		}
+
+		void Release()
+		{
+			if (m_segment != NULL)
+			{
+				munmap(m_segment, sizeof(CSegment));
+				m_segment = NULL;
+			}
+			if (m_isCreator)
+			{
+				shm_unlink(m_name.c_str());
+				m_isCreator = false;
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,178 @@
+//********************************************************************
+//  FILE NAME:      SmallHeap.h
+//
+//  DESCRIPTION:    Heap for a handful of items. The first N items live
+//					inside the heap object itself, so a heap that never
+//					outgrows them never allocates, and the sort order is
+//					held by value instead of through a shared_ptr.
+//*********************************************************************
+#ifndef SMALL_HEAP_20261018_H
+#define SMALL_HEAP_20261018_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "BasicHeapSortOrders.h"
+
+namespace pqueue
+{
+	//! Largest N for which CSmallHeap defaults to a sorted array over a
+	//! binary heap, see the "smallheap" benchmark
+	enum { SMALL_HEAP_LINEAR_SCAN_MAX = 16 };
+
+	//! Responsible for keeping the "largest" item on top, as CHeap does,
+	//! without allocating while it holds N items or fewer. Past N the items
+	//! spill into a std::vector and stay there.
+	//!
+	//! SortOrder is any class with bool LessThan(const T&, const T&) const
+	//! (an ISortOrder works); it is a member of known type, so its calls
+	//! are not virtual. T must be default constructible.
+	//!
+	//! With isLinearScan the inline items are kept sorted, top last: Insert
+	//! scans back for its slot and PopTop just drops the last item, which
+	//! beats sifting for a few items. On spilling the reversed array is a
+	//! valid binary heap, which is used from then on.
+	template <class T, std::size_t N, class SortOrder = CStdLessSortOrder<T>, bool isLinearScan = (N <= SMALL_HEAP_LINEAR_SCAN_MAX)>
+	class CSmallHeap
+	{
+	public:
+		//! Exception thrown when accessing an empty heap
+		class CCannotAccessEmptyHeap {};
+
+		//************************************************************************
+		//! @param[in] sortOrder
+		//!   defines the "largest" item
+		//!************************************************************************
+		explicit CSmallHeap(const SortOrder& sortOrder = SortOrder()) :
+		  m_sortOrder(sortOrder),
+		  m_numInline(0),
+		  m_isSpilled(false)
+		{
+		}
+
+		//! Move only, the items are never copied with the heap
+		CSmallHeap(const CSmallHeap&) = delete;
+		CSmallHeap& operator=(const CSmallHeap&) = delete;
+		CSmallHeap(CSmallHeap&&) = default;
+		CSmallHeap& operator=(CSmallHeap&&) = default;
+
+		//! Insert t, allocating only if the heap outgrows its inline items
+		void Insert(const T& t)
+		{
+			if (!m_isSpilled && m_numInline == N)
+			{
+				Spill();
+			}
+			if (m_isSpilled)
+			{
+				m_spilledItems.push_back(t);
+				std::push_heap(m_spilledItems.begin(), m_spilledItems.end(), CLessPred(m_sortOrder));
+			}
+			else if (isLinearScan)
+			{
+				std::size_t slot = m_numInline;
+				for (; slot > 0 && m_sortOrder.LessThan(t, m_inlineItems[slot - 1]); --slot)
+				{
+					m_inlineItems[slot] = std::move(m_inlineItems[slot - 1]);
+				}
+				m_inlineItems[slot] = t;
+				++m_numInline;
+			}
+			else
+			{
+				m_inlineItems[m_numInline++] = t;
+				std::push_heap(m_inlineItems, m_inlineItems + m_numInline, CLessPred(m_sortOrder));
+			}
+		}
+
+		//! @return const T&
+		//!   the "largest" item
+		//! @throw CCannotAccessEmptyHeap
+		const T& PeekTop() const
+		{
+			if (GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			if (m_isSpilled)
+			{
+				return m_spilledItems.front();
+			}
+			return isLinearScan ? m_inlineItems[m_numInline - 1] : m_inlineItems[0];
+		}
+
+		//! Discard the top item
+		//! @throw CCannotAccessEmptyHeap
+		void PopTop()
+		{
+			if (GetSize() == 0)
+			{
+				throw CCannotAccessEmptyHeap();
+			}
+			if (m_isSpilled)
+			{
+				std::pop_heap(m_spilledItems.begin(), m_spilledItems.end(), CLessPred(m_sortOrder));
+				m_spilledItems.pop_back();
+			}
+			else
+			{
+				if (!isLinearScan)
+				{
+					std::pop_heap(m_inlineItems, m_inlineItems + m_numInline, CLessPred(m_sortOrder));
+				}
+				--m_numInline;
+			}
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_isSpilled ? m_spilledItems.size() : m_numInline;
+		}
+
+		//! @return bool
+		//!   true once the heap has outgrown its inline items
+		bool IsSpilled() const
+		{
+			return m_isSpilled;
+		}
+
+	private:
+		//! Adapts the sort order to the standard heap algorithms
+		class CLessPred
+		{
+		public:
+			explicit CLessPred(const SortOrder& sortOrder) : m_sortOrder(&sortOrder) {}
+			bool operator()(const T& lhs, const T& rhs) const
+			{
+				return m_sortOrder->LessThan(lhs, rhs);
+			}
+		private:
+			const SortOrder* m_sortOrder;
+		};
+
+		SortOrder m_sortOrder;			//!< defines the "largest" item
+		T m_inlineItems[N];				//!< the items until the heap spills
+		std::size_t m_numInline;		//!< items in m_inlineItems
+		bool m_isSpilled;				//!< the items are in m_spilledItems
+		std::vector<T> m_spilledItems;	//!< binary heap of the items once spilled
+
+		//! Move the inline items into m_spilledItems as a binary heap
+		void Spill()
+		{
+			m_spilledItems.reserve(2 * N);
+			std::move(m_inlineItems, m_inlineItems + m_numInline, std::back_inserter(m_spilledItems));
+			if (isLinearScan)
+			{
+				// sorted top last, reversed it is sorted top first
+				std::reverse(m_spilledItems.begin(), m_spilledItems.end());
+			}
+			m_numInline = 0;
+			m_isSpilled = true;
+		}
+	};
+}
+
+#endif
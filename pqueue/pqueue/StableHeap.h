@@ -0,0 +1,337 @@
+//********************************************************************
+//  FILE NAME:      StableHeap.h
+//
+//  DESCRIPTION:    Heaps that hand out items of equal priority in the
+//					order they were inserted. Each item is stamped with
+//					an insertion sequence number that breaks ties. For
+//					integral priorities the priority and the sequence
+//					are packed into one integer key.
+//*********************************************************************
+#ifndef STABLE_HEAP_20261018_H
+#define STABLE_HEAP_20261018_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! An item and the order it was inserted in
+	template <class T>
+	struct CSequencedItem
+	{
+		T item;						//!< the user's item
+		std::uint64_t sequence;		//!< 0 for the first item inserted
+	};
+
+	//! Sort order that ranks items by a user sort order and breaks ties in
+	//! favor of the earlier inserted item
+	template <class T>
+	class CFifoTieSortOrder : public ISortOrder< CSequencedItem<T> >
+	{
+	private:
+		std::shared_ptr< ISortOrder<T> > m_itemSortOrder;	//!< the user's sort order
+	public:
+		explicit CFifoTieSortOrder(const std::shared_ptr< ISortOrder<T> >& itemSortOrder) :
+		  m_itemSortOrder(itemSortOrder)
+		{
+		}
+
+		bool LessThan(const CSequencedItem<T>& lhs, const CSequencedItem<T>& rhs) const
+		{
+			const int result = m_itemSortOrder->Compare(lhs.item, rhs.item);
+			if (result != 0)
+			{
+				return result < 0;
+			}
+			return rhs.sequence < lhs.sequence;
+		}
+	};
+
+	//! Responsible for keeping the "largest" item on top, as CHeap does, and
+	//! handing out items that tie under the sort order first in, first out.
+	//! Works with any sort order; one that overrides Compare is called once
+	//! per comparison, otherwise a tie costs a second call to LessThan.
+	template <class T>
+	class CStableHeap
+	{
+	public:
+		typedef typename CHeap<T>::ISortOrderPtr ISortOrderPtr;	//!< typedef for a sort order for T
+
+		//************************************************************************
+		//! @param[in] sortOrder
+		//!   defines the "largest" item, ties are broken by insertion order
+		//!************************************************************************
+		explicit CStableHeap(const ISortOrderPtr& sortOrder) :
+		  m_heap(typename CHeap< CSequencedItem<T> >::ISortOrderPtr(new CFifoTieSortOrder<T>(sortOrder))),
+		  m_nextSequence(0)
+		{
+		}
+
+		//! Move only, the items are never copied with the heap
+		CStableHeap(const CStableHeap&) = delete;
+		CStableHeap& operator=(const CStableHeap&) = delete;
+		CStableHeap(CStableHeap&&) = default;
+		CStableHeap& operator=(CStableHeap&&) = default;
+
+		//! Insert t behind every item it ties with
+		void Insert(const T& t)
+		{
+			CSequencedItem<T> sequenced = { t, m_nextSequence++ };
+			m_heap.Insert(sequenced);
+		}
+
+		//! @return const T&
+		//!   the "largest" item, the earliest inserted of any ties
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		const T& PeekTop() const
+		{
+			return m_heap.PeekTop().item;
+		}
+
+		//! Discard the top item
+		void PopTop()
+		{
+			m_heap.PopTop();
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize();
+		}
+
+	private:
+		CHeap< CSequencedItem<T> > m_heap;	//!< stamped items
+		std::uint64_t m_nextSequence;		//!< stamp of the next item
+	};
+
+	//! Key with a 64 bit priority and a 64 bit sequence, compared as one
+	//! 128 bit unsigned integer
+	struct CPackedKey128
+	{
+		std::uint64_t high;		//!< priority bits
+		std::uint64_t low;		//!< sequence bits
+
+		bool operator<(const CPackedKey128& rhs) const
+		{
+			return high < rhs.high || (high == rhs.high && low < rhs.low);
+		}
+	};
+
+	//! How keys are packed for a priority type: priorities of up to 32 bits
+	//! share a 64 bit key with the sequence, 64 bit priorities use a 128
+	//! bit key
+	template <class Priority, bool isWide = (sizeof(Priority) > 4)>
+	struct CPackedKeyTraits
+	{
+		typedef std::uint64_t Key_t;
+		typedef typename std::make_unsigned<Priority>::type UPriority_t;
+		enum { SEQUENCE_BITS = 64 - 8 * sizeof(Priority) };
+
+		static Key_t Pack(UPriority_t priorityBits, std::uint64_t sequenceBits)
+		{
+			return (static_cast<Key_t>(priorityBits) << SEQUENCE_BITS) | sequenceBits;
+		}
+
+		static UPriority_t GetPriorityBits(const Key_t& key)
+		{
+			return static_cast<UPriority_t>(key >> SEQUENCE_BITS);
+		}
+	};
+
+	template <class Priority>
+	struct CPackedKeyTraits<Priority, true>
+	{
+		typedef CPackedKey128 Key_t;
+		typedef typename std::make_unsigned<Priority>::type UPriority_t;
+		enum { SEQUENCE_BITS = 64 };
+
+		static Key_t Pack(UPriority_t priorityBits, std::uint64_t sequenceBits)
+		{
+			const Key_t key = { static_cast<std::uint64_t>(priorityBits), sequenceBits };
+			return key;
+		}
+
+		static UPriority_t GetPriorityBits(const Key_t& key)
+		{
+			return static_cast<UPriority_t>(key.high);
+		}
+	};
+
+	//! Responsible for queueing values by an integral priority, equal
+	//! priorities first in, first out. The priority and the insertion
+	//! sequence are packed into one unsigned key, priority in the high bits
+	//! and the sequence inverted in the low bits, so every comparison is a
+	//! single integer compare.
+	//!
+	//! Priorities of up to 32 bits leave 64 - bits sequence numbers; when
+	//! they run out the queued items are renumbered, see Renumber.
+	template <class Priority, class Value>
+	class CPackedStableHeap
+	{
+		static_assert(std::is_integral<Priority>::value, "packed priorities must be integers");
+	private:
+		typedef CPackedKeyTraits<Priority> Traits_t;
+		typedef typename Traits_t::Key_t Key_t;
+		typedef typename Traits_t::UPriority_t UPriority_t;
+
+		//! A queued value and its key
+		struct CEntry
+		{
+			Key_t key;			//!< packed priority and sequence
+			Value value;		//!< the user's value
+		};
+
+		//! Orders entries by key alone
+		class CKeySortOrder : public ISortOrder<CEntry>
+		{
+		public:
+			bool LessThan(const CEntry& lhs, const CEntry& rhs) const
+			{
+				return lhs.key < rhs.key;
+			}
+		};
+
+	public:
+		//************************************************************************
+		//! @param[in] isSmallestFirst
+		//!   false to hand out the largest priority first, true for the
+		//!  smallest
+		//!************************************************************************
+		explicit CPackedStableHeap(bool isSmallestFirst = false) :
+		  m_heap(typename CHeap<CEntry>::ISortOrderPtr(new CKeySortOrder())),
+		  m_isSmallestFirst(isSmallestFirst),
+		  m_nextSequence(0)
+		{
+		}
+
+		//! Move only, the items are never copied with the heap
+		CPackedStableHeap(const CPackedStableHeap&) = delete;
+		CPackedStableHeap& operator=(const CPackedStableHeap&) = delete;
+		CPackedStableHeap(CPackedStableHeap&&) = default;
+		CPackedStableHeap& operator=(CPackedStableHeap&&) = default;
+
+		//************************************************************************
+		//! @details
+		//!   Queue value behind every value with the same priority
+		//!
+		//! @param[in] priority
+		//!   the value's priority
+		//! @param[in] value
+		//!   value to queue
+		//!************************************************************************
+		void Push(Priority priority, const Value& value)
+		{
+			if (m_nextSequence > GetMaxSequence())
+			{
+				Renumber();
+			}
+			CEntry entry = { Pack(priority, m_nextSequence++), value };
+			m_heap.Insert(entry);
+		}
+
+		//! @return const Value&
+		//!   the value at the front
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		const Value& PeekTop() const
+		{
+			return m_heap.PeekTop().value;
+		}
+
+		//! @return Priority
+		//!   the priority of the value at the front
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		Priority PeekTopPriority() const
+		{
+			UPriority_t priorityBits = Traits_t::GetPriorityBits(m_heap.PeekTop().key);
+			if (m_isSmallestFirst)
+			{
+				priorityBits = static_cast<UPriority_t>(~priorityBits);
+			}
+			if (std::numeric_limits<Priority>::is_signed)
+			{
+				priorityBits = static_cast<UPriority_t>(priorityBits ^ GetSignBit());
+			}
+			return static_cast<Priority>(priorityBits);
+		}
+
+		//! Discard the value at the front
+		void PopTop()
+		{
+			m_heap.PopTop();
+		}
+
+		//! Move the value at the front into value, then discard it
+		//! @throw CHeap::CCannotAccessEmptyHeap
+		void PopTop(Value& value)
+		{
+			CEntry top;
+			m_heap.PopTop(top);
+			value = std::move(top.value);
+		}
+
+		std::size_t GetSize() const
+		{
+			return m_heap.GetSize();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Give the queued values new sequence numbers 0..n-1 in their
+		//!  current order, freeing every later number. Called by Push when the
+		//!  sequence numbers run out; costs O(n log n).
+		//!************************************************************************
+		void Renumber()
+		{
+			std::vector<CEntry> entries;
+			m_heap.ReleaseItems(entries);
+			std::sort(entries.begin(), entries.end(), [](const CEntry& lhs, const CEntry& rhs) { return rhs.key < lhs.key; });
+			for (std::size_t i = 0; i < entries.size(); ++i)
+			{
+				entries[i].key = Traits_t::Pack(Traits_t::GetPriorityBits(entries[i].key), GetMaxSequence() - i);
+			}
+			m_nextSequence = entries.size();
+			m_heap.Merge(std::move(entries));
+		}
+
+	private:
+		CHeap<CEntry> m_heap;			//!< queued values, largest key on top
+		bool m_isSmallestFirst;			//!< priorities are inverted before packing
+		std::uint64_t m_nextSequence;	//!< sequence number of the next value
+
+		static UPriority_t GetSignBit()
+		{
+			return static_cast<UPriority_t>(UPriority_t(1) << (sizeof(UPriority_t) * 8 - 1));
+		}
+
+		static std::uint64_t GetMaxSequence()
+		{
+			return Traits_t::SEQUENCE_BITS >= 64 ? std::numeric_limits<std::uint64_t>::max() : (std::uint64_t(1) << (Traits_t::SEQUENCE_BITS % 64)) - 1;
+		}
+
+		//! Priority made unsigned with its order kept, or reversed for
+		//! smallest first, above the inverted sequence so earlier values
+		//! have larger keys
+		Key_t Pack(Priority priority, std::uint64_t sequence) const
+		{
+			UPriority_t priorityBits = static_cast<UPriority_t>(priority);
+			if (std::numeric_limits<Priority>::is_signed)
+			{
+				priorityBits = static_cast<UPriority_t>(priorityBits ^ GetSignBit());
+			}
+			if (m_isSmallestFirst)
+			{
+				priorityBits = static_cast<UPriority_t>(~priorityBits);
+			}
+			return Traits_t::Pack(priorityBits, GetMaxSequence() - sequence);
+		}
+	};
+}
+
+#endif
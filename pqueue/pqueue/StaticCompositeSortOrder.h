@@ -0,0 +1,117 @@
+//********************************************************************
+//  FILE NAME:      StaticCompositeSortOrder.h
+//
+//  DESCRIPTION:    Composite sort order whose criteria are fixed at
+//					compile time. Unlike CCompositeSortOrder the
+//					criteria are held by value and called directly,
+//					so the whole comparison can be inlined.
+//*********************************************************************
+#ifndef STATIC_COMPOSITE_SORT_ORDER_20261018_H
+#define STATIC_COMPOSITE_SORT_ORDER_20261018_H
+
+#include "CustomSortPred.h"
+
+namespace pqueue
+{
+	//! Chain of sort criteria evaluated in order. Each criterion must
+	//! provide int Compare(const T&, const T&) const (any ISortOrder does).
+	//! The criteria are members of known type, so the calls are not virtual.
+	template <class T, class... CriteriaT>
+	class CSortCriteriaChain;
+
+	//! End of the chain, everything compared equal
+	template <class T>
+	class CSortCriteriaChain<T>
+	{
+	public:
+		int Compare(const T& /*lhs*/, const T& /*rhs*/) const
+		{
+			return 0;
+		}
+	};
+
+	template <class T, class FirstT, class... RestT>
+	class CSortCriteriaChain<T, FirstT, RestT...>
+	{
+	private:
+		FirstT m_first;							//!< criterion consulted first
+		CSortCriteriaChain<T, RestT...> m_rest;	//!< consulted when m_first finds a tie
+	public:
+		CSortCriteriaChain() {}
+
+		CSortCriteriaChain(const FirstT& first, const RestT&... rest) :
+		  m_first(first),
+		  m_rest(rest...)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Three-way compare using the first criterion, falling through to
+		//!  the rest of the chain on a tie
+		//!
+		//! @return int
+		//!   negative if lhs < rhs, positive if rhs < lhs, 0 if all equal
+		//!************************************************************************
+		int Compare(const T& lhs, const T& rhs) const
+		{
+			const int result = m_first.Compare(lhs, rhs);
+			if (result != 0)
+			{
+				return result;
+			}
+			return m_rest.Compare(lhs, rhs);
+		}
+	};
+
+	//! Sort on multiple criteria known at compile time. Equivalent to a
+	//! CCompositeSortOrder over the same criteria in the same order, but
+	//! costs one virtual call per comparison instead of one or two per
+	//! criterion.
+	template <class T, class... CriteriaT>
+	class CStaticCompositeSortOrder : public ISortOrder<T>
+	{
+	private:
+		CSortCriteriaChain<T, CriteriaT...> m_sortCriteria;	//!< criteria in order of precedence
+	public:
+		//************************************************************************
+		//! @details
+		//!   Construct the composite sort order with default constructed
+		//!  criteria
+		//!************************************************************************
+		CStaticCompositeSortOrder() {}
+
+		//************************************************************************
+		//! @details
+		//!   Construct the composite sort order from criteria instances
+		//!
+		//! @param[in] criteria
+		//!   sort orders to use, in order of precedence
+		//!************************************************************************
+		explicit CStaticCompositeSortOrder(const CriteriaT&... criteria) :
+		  m_sortCriteria(criteria...)
+		{
+		}
+
+		//************************************************************************
+		//! @return bool
+		//!   true if lhs < rhs based on the definition of this sort order
+		//!************************************************************************
+		bool LessThan(const T& lhs, const T& rhs) const
+		{
+			return m_sortCriteria.Compare(lhs, rhs) < 0;
+		}
+
+		//************************************************************************
+		//! @return int
+		//!   negative if lhs < rhs, positive if rhs < lhs, 0 if all criteria
+		//!  consider them equal
+		//!************************************************************************
+		int Compare(const T& lhs, const T& rhs) const
+		{
+			return m_sortCriteria.Compare(lhs, rhs);
+		}
+	};
+}
+
+#endif
\ No newline at end of file
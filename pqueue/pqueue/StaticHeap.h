@@ -0,0 +1,220 @@
+//********************************************************************
+//  FILE NAME:      StaticHeap.h
+//
+//  DESCRIPTION:    Fixed capacity heap for code that must not allocate
+//					or throw. Every operation is constexpr, so tables
+//					can be heap ordered at compile time.
+//*********************************************************************
+#ifndef STATIC_HEAP_20261018_H
+#define STATIC_HEAP_20261018_H
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+namespace pqueue
+{
+	//! Responsible for keeping the "largest" item of at most Capacity items
+	//! on top, in a std::array inside the object. Nothing allocates and
+	//! nothing throws unless T or Compare do: a full or empty heap is
+	//! reported by the return value.
+	//!
+	//! Compare is called as compare(lhs, rhs), true if lhs belongs below
+	//! rhs, as for std::push_heap; it must be constexpr for the heap to be
+	//! used in constant expressions. T must be default constructible.
+	//!
+	//! Insert and PopTop take at most GetMaxSiftSteps() steps of one
+	//! comparison (two for PopTop) and one item write, whatever the
+	//! contents. The item being sifted is held aside while the items on its
+	//! path move into the hole it leaves, so if they are cut short only
+	//! that item is missing, and the item that last moved is in two places.
+	template <class T, std::size_t Capacity, class Compare = std::less<T> >
+	class CStaticHeap
+	{
+		static_assert(Capacity > 0, "a static heap needs room for an item");
+	public:
+		//! Construct an empty heap
+		constexpr explicit CStaticHeap(const Compare& compare = Compare()) :
+		  m_items(),
+		  m_size(0),
+		  m_compare(compare)
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Construct a heap of items, heapified bottom up in O(N)
+		//!
+		//! @param[in] items
+		//!   initial items in any order, no more than Capacity of them
+		//!************************************************************************
+		template <std::size_t N>
+		constexpr explicit CStaticHeap(const T (&items)[N], const Compare& compare = Compare()) :
+		  m_items(),
+		  m_size(N),
+		  m_compare(compare)
+		{
+			static_assert(N <= Capacity, "more items than the heap can hold");
+			for (std::size_t i = 0; i < N; ++i)
+			{
+				m_items[i] = items[i];
+			}
+			RestoreOrder();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Insert t unless the heap is full
+		//!
+		//! @return bool
+		//!   false if the heap was full and t was not inserted
+		//!************************************************************************
+		constexpr bool Insert(const T& t)
+		{
+			if (m_size == Capacity)
+			{
+				return false;
+			}
+			SiftUp(m_size++, t);
+			return true;
+		}
+
+		//************************************************************************
+		//! @param[out] top
+		//!   receives a copy of the "largest" item, untouched if the heap is
+		//!  empty
+		//!
+		//! @return bool
+		//!   false if the heap is empty
+		//!************************************************************************
+		constexpr bool PeekTop(T& top) const
+		{
+			if (m_size == 0)
+			{
+				return false;
+			}
+			top = m_items[0];
+			return true;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Discard the top item
+		//!
+		//! @return bool
+		//!   false if the heap is empty
+		//!************************************************************************
+		constexpr bool PopTop()
+		{
+			if (m_size == 0)
+			{
+				return false;
+			}
+			--m_size;
+			SiftDown(0, m_items[m_size]);
+			return true;
+		}
+
+		//! PeekTop then PopTop, see both
+		constexpr bool PopTop(T& top)
+		{
+			return PeekTop(top) && PopTop();
+		}
+
+		constexpr std::size_t GetSize() const
+		{
+			return m_size;
+		}
+
+		constexpr bool IsFull() const
+		{
+			return m_size == Capacity;
+		}
+
+		static constexpr std::size_t GetCapacity()
+		{
+			return Capacity;
+		}
+
+		//! @return std::size_t
+		//!   most levels an item moves in one Insert or PopTop, the depth of
+		//!  a full heap
+		static constexpr std::size_t GetMaxSiftSteps()
+		{
+			std::size_t depth = 0;
+			for (std::size_t levelEnd = 1; levelEnd < Capacity; levelEnd = 2 * levelEnd + 1)
+			{
+				++depth;
+			}
+			return depth;
+		}
+
+		//! Heapify the items bottom up in O(N), whatever order an interrupted
+		//! Insert or PopTop left them in
+		constexpr void RestoreOrder()
+		{
+			for (std::size_t parent = m_size / 2; parent > 0; --parent)
+			{
+				SiftDown(parent - 1, m_items[parent - 1]);
+			}
+		}
+
+		//! Discard every item
+		constexpr void Clear()
+		{
+			m_size = 0;
+		}
+
+		//! @return const T*
+		//!   the items in heap array order, the top first, GetSize() of them
+		constexpr const T* GetItems() const
+		{
+			return m_items.data();
+		}
+
+	private:
+		std::array<T, Capacity> m_items;	//!< the heap, m_size items used
+		std::size_t m_size;					//!< items in the heap
+		Compare m_compare;					//!< true if its lhs belongs below its rhs
+
+		//! Move parents of the hole at index down into it while they belong
+		//! below item, then fill the hole with item. item is taken by value
+		//! here and in SiftDown, since it may be one of the items moved.
+		constexpr void SiftUp(std::size_t index, T item)
+		{
+			while (index > 0)
+			{
+				const std::size_t parent = (index - 1) / 2;
+				if (!m_compare(m_items[parent], item))
+				{
+					break;
+				}
+				m_items[index] = m_items[parent];
+				index = parent;
+			}
+			m_items[index] = item;
+		}
+
+		//! Move the larger child of the hole at index up into it while item
+		//! belongs below it, then fill the hole with item
+		constexpr void SiftDown(std::size_t index, T item)
+		{
+			for (std::size_t child = 2 * index + 1; child < m_size; child = 2 * index + 1)
+			{
+				if (child + 1 < m_size && m_compare(m_items[child], m_items[child + 1]))
+				{
+					++child;
+				}
+				if (!m_compare(item, m_items[child]))
+				{
+					break;
+				}
+				m_items[index] = m_items[child];
+				index = child;
+			}
+			m_items[index] = item;
+		}
+	};
+}
+
+#endif
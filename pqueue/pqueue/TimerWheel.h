@@ -0,0 +1,385 @@
+//********************************************************************
+//  FILE NAME:      TimerWheel.h
+//
+//  DESCRIPTION:    Hierarchical timing wheel for scheduling deadlines.
+//					Timers are hashed into slots by deadline so that
+//					scheduling and cancelling are O(1); only deadlines
+//					beyond the reach of the wheel go into a heap.
+//*********************************************************************
+#ifndef TIMER_WHEEL_20261018_H
+#define TIMER_WHEEL_20261018_H
+
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+#include "Heap.h"
+#include "BasicHeapSortOrders.h"
+
+namespace pqueue
+{
+	//! Responsible for holding values until their deadline (in ticks) has
+	//! passed. The wheel has NUM_LEVELS levels of SLOTS_PER_LEVEL slots; a
+	//! timer sits on the level of the highest SLOT_BITS digit in which its
+	//! deadline differs from the current time and moves down a level each
+	//! time the current time reaches its slot. Deadlines that differ above
+	//! the top level wait in an overflow CHeap.
+	template <class Value>
+	class CTimerWheel
+	{
+	public:
+		typedef std::uint64_t Tick_t;			//!< unit of time for deadlines
+		typedef std::uint64_t TimerId_t;		//!< handle returned by Schedule, used to Cancel
+
+		//************************************************************************
+		//! @details
+		//!   Construct an empty timer wheel
+		//!
+		//! @param[in] startTime
+		//!   current time of the wheel
+		//!************************************************************************
+		explicit CTimerWheel(Tick_t startTime = 0) :
+		  m_currentTime(startTime),
+		  m_slotHeads(NUM_LEVELS * SLOTS_PER_LEVEL, NIL),
+		  m_slotTails(NUM_LEVELS * SLOTS_PER_LEVEL, NIL),
+		  m_levelCounts(NUM_LEVELS, 0),
+		  m_freeHead(NIL),
+		  m_size(0),
+		  m_overflow(typename OverflowHeap_t::ISortOrderPtr(new CStdGreaterSortOrder<OverflowItem_t>()))
+		{
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Schedule value to come out of PopExpired once the time reaches
+		//!  deadline. O(1) unless the deadline is too far out for the wheel.
+		//!
+		//! @param[in] deadline
+		//!   tick the timer expires at. Deadlines already passed expire on the
+		//!  next PopExpired.
+		//! @param[in] value
+		//!   data handed back when the timer expires
+		//!
+		//! @return TimerId_t
+		//!   handle for cancelling the timer
+		//!************************************************************************
+		TimerId_t Schedule(Tick_t deadline, const Value& value)
+		{
+			const std::uint32_t nodeIdx = AllocateNode();
+			CTimerNode& node = m_nodes[nodeIdx];
+			node.deadline = deadline < m_currentTime ? m_currentTime : deadline;
+			node.value = value;
+			Place(nodeIdx);
+			++m_size;
+			return (static_cast<TimerId_t>(node.generation) << 32) | nodeIdx;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Cancel a scheduled timer so it never expires. O(1).
+		//!
+		//! @param[in] timerId
+		//!   handle returned by Schedule
+		//!
+		//! @return bool
+		//!   true if the timer was cancelled, false if it had already expired
+		//!  or been cancelled
+		//!************************************************************************
+		bool Cancel(TimerId_t timerId)
+		{
+			const std::uint32_t nodeIdx = static_cast<std::uint32_t>(timerId & 0xFFFFFFFF);
+			const std::uint32_t generation = static_cast<std::uint32_t>(timerId >> 32);
+			if (nodeIdx >= m_nodes.size() || m_nodes[nodeIdx].generation != generation)
+			{
+				return false;
+			}
+			CTimerNode& node = m_nodes[nodeIdx];
+			if (node.slot == SLOT_OVERFLOW)
+			{
+				// can't take it out of the heap, it's freed when it surfaces
+				node.slot = SLOT_CANCELLED;
+			}
+			else if (node.slot == SLOT_CANCELLED || node.slot == SLOT_FREE)
+			{
+				return false;
+			}
+			else
+			{
+				Unlink(nodeIdx);
+				FreeNode(nodeIdx);
+			}
+			--m_size;
+			return true;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Advance the current time to now and hand back every timer whose
+		//!  deadline is at or before now, in order of deadline.
+		//!
+		//! @param[in] now
+		//!   new current time. Times before the current time don't move the
+		//!  wheel backwards.
+		//! @param[out] expired
+		//!   values of the expired timers are appended to this
+		//!************************************************************************
+		void PopExpired(Tick_t now, std::vector<Value>& expired)
+		{
+			for (;;)
+			{
+				FireSlot(m_currentTime & SLOT_MASK, expired);
+				if (m_currentTime >= now)
+				{
+					return;
+				}
+				m_currentTime = GetNextInterestingTime(now);
+				Cascade();
+			}
+		}
+
+		//! Number of timers scheduled and not yet expired or cancelled
+		std::size_t GetSize() const
+		{
+			return m_size;
+		}
+
+		//! Current time of the wheel, the last time given to PopExpired
+		Tick_t GetCurrentTime() const
+		{
+			return m_currentTime;
+		}
+
+		//! Move only, the queued items are never copied with it
+		CTimerWheel(const CTimerWheel&) = delete;
+		CTimerWheel& operator=(const CTimerWheel&) = delete;
+		CTimerWheel(CTimerWheel&&) = default;
+		CTimerWheel& operator=(CTimerWheel&&) = default;
+
+	private:
+		enum
+		{
+			SLOT_BITS = 8,
+			NUM_LEVELS = 4,
+			SLOTS_PER_LEVEL = 1 << SLOT_BITS,
+			SLOT_MASK = SLOTS_PER_LEVEL - 1,
+			SLOT_OVERFLOW = NUM_LEVELS * SLOTS_PER_LEVEL,	//!< node is in m_overflow
+			SLOT_CANCELLED = SLOT_OVERFLOW + 1,				//!< in m_overflow, cancelled
+			SLOT_FREE = SLOT_OVERFLOW + 2,					//!< on the free list
+			NIL = 0xFFFFFFFF								//!< end of a node list
+		};
+
+		//! A scheduled timer, linked into its slot's list
+		struct CTimerNode
+		{
+			Tick_t deadline;				//!< when the timer expires
+			Value value;					//!< handed back on expiry
+			std::uint32_t prev;			//!< previous node in the slot, or NIL
+			std::uint32_t next;			//!< next node in the slot (or free list), or NIL
+			std::uint32_t slot;			//!< level * SLOTS_PER_LEVEL + slot, or one of the SLOT_ markers
+			std::uint32_t generation;		//!< bumped on free so stale TimerId_ts are rejected
+
+			CTimerNode() : deadline(0), value(), prev(NIL), next(NIL), slot(SLOT_FREE), generation(0) {}
+		};
+
+		typedef std::pair<Tick_t, std::uint32_t> OverflowItem_t;	//!< (deadline, node index)
+		typedef CHeap<OverflowItem_t> OverflowHeap_t;
+
+		Tick_t m_currentTime;							//!< time the wheel is at
+		std::vector<CTimerNode> m_nodes;				//!< every timer node, live or free
+		std::vector<std::uint32_t> m_slotHeads;		//!< first node of each slot
+		std::vector<std::uint32_t> m_slotTails;		//!< last node of each slot, timers fire in schedule order
+		std::vector<std::size_t> m_levelCounts;			//!< number of nodes on each level
+		std::uint32_t m_freeHead;						//!< first free node
+		std::size_t m_size;								//!< live timers
+		OverflowHeap_t m_overflow;						//!< timers beyond the top level, soonest on top
+
+		//! @return the SLOT_BITS digit of time at level
+		static std::uint32_t GetDigit(Tick_t time, unsigned int level)
+		{
+			return static_cast<std::uint32_t>((time >> (level * SLOT_BITS)) & SLOT_MASK);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Put a node in the slot for its deadline relative to the current
+		//!  time, or in the overflow heap
+		//!************************************************************************
+		void Place(std::uint32_t nodeIdx)
+		{
+			CTimerNode& node = m_nodes[nodeIdx];
+			const Tick_t diff = node.deadline ^ m_currentTime;
+			unsigned int level = 0;
+			while (level < NUM_LEVELS && (diff >> ((level + 1) * SLOT_BITS)) != 0)
+			{
+				++level;
+			}
+			if (level == NUM_LEVELS)
+			{
+				node.slot = SLOT_OVERFLOW;
+				m_overflow.Insert(OverflowItem_t(node.deadline, nodeIdx));
+				return;
+			}
+
+			node.slot = level * SLOTS_PER_LEVEL + GetDigit(node.deadline, level);
+			node.next = NIL;
+			node.prev = m_slotTails[node.slot];
+			if (node.prev == NIL)
+			{
+				m_slotHeads[node.slot] = nodeIdx;
+			}
+			else
+			{
+				m_nodes[node.prev].next = nodeIdx;
+			}
+			m_slotTails[node.slot] = nodeIdx;
+			++m_levelCounts[level];
+		}
+
+		//! Take a node out of its slot's list
+		void Unlink(std::uint32_t nodeIdx)
+		{
+			CTimerNode& node = m_nodes[nodeIdx];
+			if (node.prev == NIL)
+			{
+				m_slotHeads[node.slot] = node.next;
+			}
+			else
+			{
+				m_nodes[node.prev].next = node.next;
+			}
+			if (node.next == NIL)
+			{
+				m_slotTails[node.slot] = node.prev;
+			}
+			else
+			{
+				m_nodes[node.next].prev = node.prev;
+			}
+			--m_levelCounts[node.slot / SLOTS_PER_LEVEL];
+		}
+
+		//! Get a node off the free list, or grow the pool
+		std::uint32_t AllocateNode()
+		{
+			if (m_freeHead == NIL)
+			{
+				m_nodes.push_back(CTimerNode());
+				return static_cast<std::uint32_t>(m_nodes.size() - 1);
+			}
+			const std::uint32_t nodeIdx = m_freeHead;
+			m_freeHead = m_nodes[nodeIdx].next;
+			return nodeIdx;
+		}
+
+		//! Return a node to the free list, invalidating its TimerId_t
+		void FreeNode(std::uint32_t nodeIdx)
+		{
+			CTimerNode& node = m_nodes[nodeIdx];
+			node.value = Value();
+			node.slot = SLOT_FREE;
+			++node.generation;
+			node.next = m_freeHead;
+			m_freeHead = nodeIdx;
+		}
+
+		//! Expire every timer in the given level 0 slot
+		void FireSlot(std::uint32_t slot, std::vector<Value>& expired)
+		{
+			std::size_t numFired = 0;
+			std::uint32_t nodeIdx = m_slotHeads[slot];
+			while (nodeIdx != NIL)
+			{
+				const std::uint32_t nextIdx = m_nodes[nodeIdx].next;
+				expired.push_back(m_nodes[nodeIdx].value);
+				FreeNode(nodeIdx);
+				++numFired;
+				nodeIdx = nextIdx;
+			}
+			m_slotHeads[slot] = NIL;
+			m_slotTails[slot] = NIL;
+			m_levelCounts[0] -= numFired;
+			m_size -= numFired;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Find the next time after the current time where something could
+		//!  happen: the next tick if level 0 has timers, otherwise the next
+		//!  time the lowest occupied level gets cascaded. Never past now.
+		//!************************************************************************
+		Tick_t GetNextInterestingTime(Tick_t now) const
+		{
+			unsigned int level = 0;
+			while (level < NUM_LEVELS && m_levelCounts[level] == 0)
+			{
+				++level;
+			}
+			if (level == NUM_LEVELS && m_overflow.GetSize() == 0)
+			{
+				return now;
+			}
+			const Tick_t span = static_cast<Tick_t>(1) << (level * SLOT_BITS);
+			Tick_t next = (m_currentTime | (span - 1)) + 1;
+			if (level == NUM_LEVELS)
+			{
+				// nothing on the wheel, go straight to the soonest overflow timer
+				const Tick_t overflowStart = m_overflow.PeekTop().first & ~(span - 1);
+				if (overflowStart > next)
+				{
+					next = overflowStart;
+				}
+			}
+			return next < now ? next : now;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   After the current time moves, move the timers in any slot the time
+		//!  has just reached down the wheel, top level first. Overflow timers
+		//!  that now fit on the wheel come off the heap.
+		//!************************************************************************
+		void Cascade()
+		{
+			const Tick_t wheelSpan = static_cast<Tick_t>(1) << (NUM_LEVELS * SLOT_BITS);
+			if ((m_currentTime & (wheelSpan - 1)) == 0)
+			{
+				while (m_overflow.GetSize() > 0 &&
+					(m_overflow.PeekTop().first & ~(wheelSpan - 1)) == m_currentTime)
+				{
+					const std::uint32_t nodeIdx = m_overflow.PeekTop().second;
+					m_overflow.PopTop();
+					if (m_nodes[nodeIdx].slot == SLOT_CANCELLED)
+					{
+						FreeNode(nodeIdx);
+					}
+					else
+					{
+						Place(nodeIdx);
+					}
+				}
+			}
+
+			for (unsigned int level = NUM_LEVELS - 1; level > 0; --level)
+			{
+				const Tick_t span = static_cast<Tick_t>(1) << (level * SLOT_BITS);
+				if ((m_currentTime & (span - 1)) != 0)
+				{
+					continue;
+				}
+				const std::uint32_t slot = level * SLOTS_PER_LEVEL + GetDigit(m_currentTime, level);
+				std::uint32_t nodeIdx = m_slotHeads[slot];
+				m_slotHeads[slot] = NIL;
+				m_slotTails[slot] = NIL;
+				while (nodeIdx != NIL)
+				{
+					const std::uint32_t nextIdx = m_nodes[nodeIdx].next;
+					--m_levelCounts[level];
+					Place(nodeIdx);
+					nodeIdx = nextIdx;
+				}
+			}
+		}
+	};
+}
+
+#endif
\ No newline at end of file
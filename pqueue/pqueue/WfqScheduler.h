@@ -0,0 +1,326 @@
+//********************************************************************
+//  FILE NAME:      WfqScheduler.h
+//
+//  DESCRIPTION:    Weighted fair queueing across flows (tenants), each
+//					with its own heap. Flows are scheduled by WF2Q+:
+//					of the flows whose virtual start time has been
+//					reached, the one with the earliest virtual finish
+//					time is served next, so a flow with twice the
+//					weight gets twice the service however much the
+//					others queue.
+//*********************************************************************
+#ifndef WFQ_SCHEDULER_20261018_H
+#define WFQ_SCHEDULER_20261018_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Heap.h"
+
+namespace pqueue
+{
+	//! Responsible for sharing service between flows in proportion to their
+	//! weights. Within a flow, items come out in the flow's sort order.
+	//!
+	//! Each item has a cost, the service it takes (eg. bytes or expected
+	//! run time). A flow's virtual finish time is its start time plus the
+	//! cost of its front item divided by its weight. The virtual time
+	//! advances by the cost served divided by the total weight of every
+	//! flow, and jumps to the earliest start time when no flow with items
+	//! has started. While every flow has items, the normalized service
+	//! (cost served / weight) of any two differs by at most the largest
+	//! cost divided by each weight.
+	//!
+	//! A flow's tags are set when it reaches the front of its flow heap
+	//! using the front item's cost, and the flow is charged the cost of the
+	//! item actually served; a higher priority item pushed meanwhile is
+	//! served in its place and the difference is settled on the next tag.
+	//!
+	//! PopFront is O(log flows + log items), plus O(log flows) for each
+	//! flow that becomes eligible.
+	template <class T>
+	class CWfqScheduler
+	{
+	public:
+		typedef std::uint32_t FlowId_t;	//!< returned by AddFlow
+
+		//! Exception thrown by PopFront when no flow has items
+		class CCannotAccessEmptyScheduler {};
+
+		//! Exception thrown for a flow id AddFlow did not return
+		class CUnknownFlow {};
+
+		//! Exception thrown for a weight that is not positive
+		class CInvalidWeight {};
+
+		CWfqScheduler() :
+		  m_eligibleFlows(typename CHeap<CFlowTag>::ISortOrderPtr(new CFinishTimeSortOrder())),
+		  m_waitingFlows(typename CHeap<CFlowTag>::ISortOrderPtr(new CStartTimeSortOrder())),
+		  m_virtualTime(0.0),
+		  m_totalWeight(0.0),
+		  m_numItems(0)
+		{
+		}
+
+		//! Move only, like the heaps it is built on
+		CWfqScheduler(const CWfqScheduler&) = delete;
+		CWfqScheduler& operator=(const CWfqScheduler&) = delete;
+		CWfqScheduler(CWfqScheduler&&) = default;
+		CWfqScheduler& operator=(CWfqScheduler&&) = default;
+
+		//************************************************************************
+		//! @details
+		//!   Add an empty flow
+		//!
+		//! @param[in] weight
+		//!   share of service relative to the other flows, positive
+		//! @param[in] sortOrder
+		//!   order of the flow's items, the "largest" served first
+		//!
+		//! @return FlowId_t
+		//!   id of the flow, counting up from 0
+		//!
+		//! @throw CInvalidWeight
+		//!   if weight is not positive
+		//!************************************************************************
+		FlowId_t AddFlow(double weight, const typename CHeap<T>::ISortOrderPtr& sortOrder)
+		{
+			if (!(weight > 0.0))
+			{
+				throw CInvalidWeight();
+			}
+			m_flows.push_back(std::unique_ptr<CFlow>(new CFlow(weight, sortOrder)));
+			m_totalWeight += weight;
+			return static_cast<FlowId_t>(m_flows.size() - 1);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Change a flow's weight. Its current tags stand; the new weight
+		//!  applies from the next item it is charged for.
+		//!
+		//! @throw CUnknownFlow, CInvalidWeight
+		//!************************************************************************
+		void SetWeight(FlowId_t flowId, double weight)
+		{
+			CFlow& flow = GetFlow(flowId);
+			if (!(weight > 0.0))
+			{
+				throw CInvalidWeight();
+			}
+			m_totalWeight += weight - flow.weight;
+			flow.weight = weight;
+		}
+
+		//! @throw CUnknownFlow
+		double GetWeight(FlowId_t flowId) const
+		{
+			return GetFlow(flowId).weight;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Queue item on a flow
+		//!
+		//! @param[in] cost
+		//!   service the item takes, positive
+		//!
+		//! @throw CUnknownFlow
+		//!************************************************************************
+		void Push(FlowId_t flowId, const T& item, double cost = 1.0)
+		{
+			CFlow& flow = GetFlow(flowId);
+			const CCostedItem costedItem = { item, cost };
+			flow.items.Insert(costedItem);
+			++m_numItems;
+			if (flow.items.GetSize() == 1)
+			{
+				// newly backlogged, it gets no credit for the time it was idle
+				flow.start = flow.finish > m_virtualTime ? flow.finish : m_virtualTime;
+				ScheduleFlow(flowId);
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Remove and return the next item to serve
+		//!
+		//! @param[out] item
+		//!   receives the item
+		//!
+		//! @return FlowId_t
+		//!   flow the item was pushed on
+		//!
+		//! @throw CCannotAccessEmptyScheduler
+		//!   if no flow has items
+		//!************************************************************************
+		FlowId_t PopFront(T& item)
+		{
+			if (m_numItems == 0)
+			{
+				throw CCannotAccessEmptyScheduler();
+			}
+			MakeFlowsEligible();
+			if (m_eligibleFlows.GetSize() == 0)
+			{
+				// every flow is ahead of the virtual time, skip to the first
+				m_virtualTime = m_waitingFlows.PeekTop().start;
+				MakeFlowsEligible();
+			}
+			const FlowId_t flowId = m_eligibleFlows.PeekTop().flow;
+			m_eligibleFlows.PopTop();
+
+			CFlow& flow = *m_flows[flowId];
+			const CCostedItem served = flow.items.PeekTop();
+			flow.items.PopTop();
+			--m_numItems;
+			item = served.item;
+			m_virtualTime += served.cost / m_totalWeight;
+			flow.finish = flow.start + served.cost / flow.weight;
+			if (flow.items.GetSize() > 0)
+			{
+				flow.start = flow.finish;
+				ScheduleFlow(flowId);
+			}
+			return flowId;
+		}
+
+		//! @return std::size_t
+		//!   items queued on every flow
+		std::size_t GetSize() const
+		{
+			return m_numItems;
+		}
+
+		//! @throw CUnknownFlow
+		std::size_t GetFlowSize(FlowId_t flowId) const
+		{
+			return GetFlow(flowId).items.GetSize();
+		}
+
+		std::size_t GetNumFlows() const
+		{
+			return m_flows.size();
+		}
+
+		//! @return double
+		//!   the virtual time, normalized service each backlogged flow is due
+		double GetVirtualTime() const
+		{
+			return m_virtualTime;
+		}
+
+	private:
+		//! A queued item and the service it takes
+		struct CCostedItem
+		{
+			T item;			//!< as pushed
+			double cost;	//!< as pushed
+		};
+
+		//! Orders costed items by the flow's sort order of T
+		class CCostedItemSortOrder : public ISortOrder<CCostedItem>
+		{
+		public:
+			explicit CCostedItemSortOrder(const typename CHeap<T>::ISortOrderPtr& sortOrder) : m_sortOrder(sortOrder) {}
+
+			bool LessThan(const CCostedItem& lhs, const CCostedItem& rhs) const
+			{
+				return m_sortOrder->LessThan(lhs.item, rhs.item);
+			}
+
+		private:
+			typename CHeap<T>::ISortOrderPtr m_sortOrder;	//!< the flow's order
+		};
+
+		//! A flow and its virtual times
+		struct CFlow
+		{
+			CFlow(double flowWeight, const typename CHeap<T>::ISortOrderPtr& sortOrder) :
+			  items(typename CHeap<CCostedItem>::ISortOrderPtr(new CCostedItemSortOrder(sortOrder))),
+			  weight(flowWeight),
+			  start(0.0),
+			  finish(0.0)
+			{
+			}
+
+			CHeap<CCostedItem> items;	//!< the flow's queue
+			double weight;				//!< share of service
+			double start;				//!< virtual start time of the front item, while backlogged
+			double finish;				//!< virtual finish time of the last item served
+		};
+
+		//! A backlogged flow in m_eligibleFlows or m_waitingFlows
+		struct CFlowTag
+		{
+			double start;		//!< virtual start time of the flow's front item
+			double finish;		//!< virtual finish time of the flow's front item
+			FlowId_t flow;		//!< the flow
+		};
+
+		//! Earliest finish on top, lowest flow id of equals
+		class CFinishTimeSortOrder : public ISortOrder<CFlowTag>
+		{
+		public:
+			bool LessThan(const CFlowTag& lhs, const CFlowTag& rhs) const
+			{
+				return rhs.finish < lhs.finish || (rhs.finish == lhs.finish && rhs.flow < lhs.flow);
+			}
+		};
+
+		//! Earliest start on top, lowest flow id of equals
+		class CStartTimeSortOrder : public ISortOrder<CFlowTag>
+		{
+		public:
+			bool LessThan(const CFlowTag& lhs, const CFlowTag& rhs) const
+			{
+				return rhs.start < lhs.start || (rhs.start == lhs.start && rhs.flow < lhs.flow);
+			}
+		};
+
+		std::vector< std::unique_ptr<CFlow> > m_flows;	//!< by flow id
+		CHeap<CFlowTag> m_eligibleFlows;				//!< backlogged flows started by the virtual time
+		CHeap<CFlowTag> m_waitingFlows;					//!< backlogged flows starting after the virtual time
+		double m_virtualTime;							//!< see GetVirtualTime
+		double m_totalWeight;							//!< total weight of every flow
+		std::size_t m_numItems;							//!< see GetSize
+
+		CFlow& GetFlow(FlowId_t flowId) const
+		{
+			if (flowId >= m_flows.size())
+			{
+				throw CUnknownFlow();
+			}
+			return *m_flows[flowId];
+		}
+
+		//! Tag a backlogged flow from its front item and queue it
+		void ScheduleFlow(FlowId_t flowId)
+		{
+			const CFlow& flow = *m_flows[flowId];
+			const CFlowTag tag = { flow.start, flow.start + flow.items.PeekTop().cost / flow.weight, flowId };
+			if (tag.start <= m_virtualTime)
+			{
+				m_eligibleFlows.Insert(tag);
+			}
+			else
+			{
+				m_waitingFlows.Insert(tag);
+			}
+		}
+
+		//! Move the flows whose start the virtual time has reached
+		void MakeFlowsEligible()
+		{
+			while (m_waitingFlows.GetSize() > 0 && m_waitingFlows.PeekTop().start <= m_virtualTime)
+			{
+				m_eligibleFlows.Insert(m_waitingFlows.PeekTop());
+				m_waitingFlows.PopTop();
+			}
+		}
+	};
+}
+
+#endif
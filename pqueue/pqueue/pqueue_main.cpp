@@ -18,6 +18,31 @@ int main()
 	TestHeap();
 	TestCompositeSort();
 	TestPqueue();
+	TestLazySortOrderChange();
+	TestStaticCompositeSort();
+	TestNormalizedSortKey();
+	TestRadixHeap();
+	TestTimerWheel();
+	TestMinMaxHeap();
+	TestHeapMerge();
+	TestParallelHeapDrain();
+#if defined(__cpp_impl_coroutine)
+	TestAsyncPqueue();
+#endif
+	TestBlockingPqueue();
+	TestHeapStats();
+	TestPqueueTrace();
+	TestHeapMove();
+	TestHeapTopK();
+	TestStableHeap();
+	TestAgingPqueue();
+	TestSmallHeap();
+	TestStaticHeap();
+	TestPopTopInterleaved();
+	TestPqueueServer();
+	TestSharedPqueue();
+	TestEvictionCache();
+	TestWfqScheduler();
 
 	return 0;
 }
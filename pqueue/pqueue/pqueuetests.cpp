@@ -13,9 +13,46 @@
 #include "HeapUtils.h"
 #include "BasicHeapSortOrders.h"
 #include "Pqueue.h"
+#include "PqueueTestStructs.h"
+#include "StaticCompositeSortOrder.h"
+#include "NormalizedSortKey.h"
+#include "RadixHeap.h"
+#include "TimerWheel.h"
+#include "MinMaxHeap.h"
+#include "DoubleEndedPqueue.h"
+#include "ParallelHeapDrain.h"
+#include "AsyncPqueue.h"
+#include "BlockingPqueue.h"
+#include "StableHeap.h"
+#include "AgingPqueue.h"
+#include "SmallHeap.h"
+#include "StaticHeap.h"
+#include "InterleavedHeapOps.h"
+#include "EvictionCache.h"
+#include "WfqScheduler.h"
+#ifdef __linux__
+#include "PqueueServer.h"
+#include "PqueueClient.h"
+#include "SharedPqueue.h"
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+#include "PqueueTrace.h"
 #include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 
 
 namespace pqueue
@@ -145,60 +182,6 @@ namespace pqueue
 		assert(reheaped.PeekTop() == 30);
 	}
 
-	//! The following classes are to test the composite sorting
-
-	//!
-	struct CTestStruct
-	{
-		unsigned int criteriaA;
-		double criteriaB;
-		std::string criteriaC;
-
-		CTestStruct(const unsigned int& critA, const double& critB, const std::string& critC) :
-		criteriaA(critA), criteriaB(critB), criteriaC(critC)
-		{
-
-		}
-	};
-
-	typedef boost::shared_ptr< ISortOrder<CTestStruct> > ISortOrderTestStructPtr;
-
-	//! Sort on criteria A
-	class CSortOnCriteriaA : public ISortOrder<CTestStruct>
-	{
-	public:
-		CSortOnCriteriaA() {}
-
-		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
-		{
-			return lhs.criteriaA < rhs.criteriaA;
-		}
-	};
-	
-	//! Sort on criteria B
-	class CSortOnCriteriaB : public ISortOrder<CTestStruct>
-	{
-	public:
-		CSortOnCriteriaB() {}
-
-		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
-		{
-			return lhs.criteriaB < rhs.criteriaB;
-		}
-	};
-
-	//! Sort on criteria C
-	class CSortOnCriteriaC : public ISortOrder<CTestStruct>
-	{
-	public:
-		CSortOnCriteriaC() {}
-
-		bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
-		{
-			return lhs.criteriaC < rhs.criteriaC;
-		}
-	};
-
 	//************************************************************************
 	//! @details
 	//!   Run the heap through a series of tests using a composite sort
@@ -381,4 +364,2213 @@ namespace pqueue
 
 
 	}
+
+	//************************************************************************
+	//! @details
+	//!   Change sort orders lazily and make sure the front of the queue
+	//!  always honors the newest sort order while the old items are still
+	//!  being migrated
+	//!************************************************************************
+	void TestLazySortOrderChange()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int>::ISortOrderPtr gtSortOrder(new CStdGreaterSortOrder<int>());
+
+		// the eager queue is the reference the lazy queue must agree with
+		CPqueue<int> lazyPqueue(ltSortOrder);
+		CPqueue<int> eagerPqueue(ltSortOrder);
+		for (int i = 0; i < 100; ++i)
+		{
+			lazyPqueue.Push((i * 37) % 50);
+			eagerPqueue.Push((i * 37) % 50);
+		}
+
+		// nothing migrates on its own, only PopFront digs into the old items
+		lazyPqueue.ChangeSortOrderLazily(gtSortOrder, 0);
+		eagerPqueue.ChangeSortOrder(gtSortOrder);
+		assert(lazyPqueue.GetSize() == 100);
+		assert(lazyPqueue.PeekFront() == 0);
+		for (int i = 0; i < 20; ++i)
+		{
+			assert(lazyPqueue.PeekFront() == eagerPqueue.PeekFront());
+			lazyPqueue.PopFront();
+			eagerPqueue.PopFront();
+		}
+
+		// new items go straight into the new heap
+		lazyPqueue.Push(-1);
+		eagerPqueue.Push(-1);
+		assert(lazyPqueue.PeekFront() == -1);
+		lazyPqueue.Push(1000);
+		eagerPqueue.Push(1000);
+
+		// change again while the first change is still pending
+		lazyPqueue.ChangeSortOrderLazily(ltSortOrder, 3);
+		eagerPqueue.ChangeSortOrder(ltSortOrder);
+		assert(lazyPqueue.PeekFront() == 1000);
+		while (eagerPqueue.GetSize() > 0)
+		{
+			assert(lazyPqueue.GetSize() == eagerPqueue.GetSize());
+			assert(lazyPqueue.PeekFront() == eagerPqueue.PeekFront());
+			lazyPqueue.PopFront();
+			eagerPqueue.PopFront();
+		}
+		assert(lazyPqueue.GetSize() == 0);
+
+		// the first pop after a change heap orders the set aside items in at
+		// most 2n comparisons, later pops take O(log n), and with no
+		// migration asked for none of the items move into the heap
+		class CCountingSortOrder : public ISortOrder<int>
+		{
+		public:
+			CCountingSortOrder(std::size_t& numComparisons, bool isSmallestFirst) :
+			  m_numComparisons(numComparisons),
+			  m_isSmallestFirst(isSmallestFirst)
+			{
+			}
+
+			bool LessThan(const int& lhs, const int& rhs) const
+			{
+				++m_numComparisons;
+				return m_isSmallestFirst ? rhs < lhs : lhs < rhs;
+			}
+
+		private:
+			std::size_t& m_numComparisons;
+			bool m_isSmallestFirst;
+		};
+		const int numItems = 4096;
+		for (int isSmallestFirst = 0; isSmallestFirst < 2; ++isSmallestFirst)
+		{
+			CPqueue<int> costPqueue(ltSortOrder);
+			for (int i = 0; i < numItems; ++i)
+			{
+				costPqueue.Push((i * 7919) % numItems);
+			}
+			std::size_t numComparisons = 0;
+			costPqueue.ChangeSortOrderLazily(CHeap<int>::ISortOrderPtr(new CCountingSortOrder(numComparisons, isSmallestFirst != 0)), 0);
+#ifdef PQUEUE_ENABLE_STATS
+			const std::uint64_t numInsertsBefore = costPqueue.GetStats().heapStats.numInserts;
+#endif
+			costPqueue.PopFront();
+			assert(numComparisons <= 2 * numItems);
+			for (int i = 1; i < 100; ++i)
+			{
+				numComparisons = 0;
+				assert(costPqueue.PeekFront() == (isSmallestFirst ? i : numItems - 1 - i));
+				costPqueue.PopFront();
+				assert(numComparisons <= 2 * 12 + 2);
+			}
+#ifdef PQUEUE_ENABLE_STATS
+			assert(costPqueue.GetStats().heapStats.numInserts == numInsertsBefore);
+#endif
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Make sure the three-way, flattened and compile-time composite sorts
+	//!  all agree with each other
+	//!************************************************************************
+	void TestStaticCompositeSort()
+	{
+		ISortOrderTestStructPtr  criteriaASort(new CSortOnCriteriaA());
+		ISortOrderTestStructPtr  criteriaBSort(new CSortOnCriteriaB());
+		ISortOrderTestStructPtr  criteriaCSort(new CSortOnCriteriaC());
+
+		// the default Compare is built out of LessThan
+		CTestStruct smallStruct(1, 2.0, "Hello");
+		CTestStruct bigStruct(5, 3.0, "ZZZZZ");
+		assert(criteriaASort->ISortOrder<CTestStruct>::Compare(smallStruct, bigStruct) < 0);
+		assert(criteriaASort->ISortOrder<CTestStruct>::Compare(bigStruct, smallStruct) > 0);
+		assert(criteriaASort->ISortOrder<CTestStruct>::Compare(smallStruct, smallStruct) == 0);
+
+		// Sort on C then A then B, with A then B nested in its own composite
+		std::vector< ISortOrderTestStructPtr > sortCriteriaAB;
+		sortCriteriaAB.push_back(criteriaASort);
+		sortCriteriaAB.push_back(criteriaBSort);
+		ISortOrderTestStructPtr sortByAThenB(new CCompositeSortOrder<CTestStruct>(sortCriteriaAB));
+
+		std::vector< ISortOrderTestStructPtr > sortCriteriaCAB;
+		sortCriteriaCAB.push_back(criteriaCSort);
+		sortCriteriaCAB.push_back(sortByAThenB);
+		CCompositeSortOrder<CTestStruct> nestedSortByCThenAThenB(sortCriteriaCAB);
+		assert(nestedSortByCThenAThenB.GetNumCriteria() == 3);
+
+		CStaticCompositeSortOrder<CTestStruct, CSortOnCriteriaC, CSortOnCriteriaA, CSortOnCriteriaB> staticSortByCThenAThenB;
+
+		std::vector<CTestStruct> testStructs;
+		const char* names[] = {"Tom", "Dick", "Harry"};
+		for (unsigned int i = 0; i < 27; ++i)
+		{
+			testStructs.push_back(CTestStruct(i % 3, (i / 3) % 3, names[i / 9]));
+		}
+		for (std::size_t lhs = 0; lhs < testStructs.size(); ++lhs)
+		{
+			for (std::size_t rhs = 0; rhs < testStructs.size(); ++rhs)
+			{
+				const CTestStruct& lhsStruct = testStructs[lhs];
+				const CTestStruct& rhsStruct = testStructs[rhs];
+				int expected = criteriaCSort->ISortOrder<CTestStruct>::Compare(lhsStruct, rhsStruct);
+				if (expected == 0)
+				{
+					expected = criteriaASort->ISortOrder<CTestStruct>::Compare(lhsStruct, rhsStruct);
+				}
+				if (expected == 0)
+				{
+					expected = criteriaBSort->ISortOrder<CTestStruct>::Compare(lhsStruct, rhsStruct);
+				}
+				const int nestedResult = nestedSortByCThenAThenB.Compare(lhsStruct, rhsStruct);
+				const int staticResult = staticSortByCThenAThenB.Compare(lhsStruct, rhsStruct);
+				assert((expected < 0) == (nestedResult < 0) && (expected > 0) == (nestedResult > 0));
+				assert((expected < 0) == (staticResult < 0) && (expected > 0) == (staticResult > 0));
+				assert((expected < 0) == staticSortByCThenAThenB.LessThan(lhsStruct, rhsStruct));
+				assert((expected < 0) == nestedSortByCThenAThenB.LessThan(lhsStruct, rhsStruct));
+			}
+		}
+
+		// and the heap comes out the same either way
+		ISortOrderTestStructPtr staticSortOrder(new CStaticCompositeSortOrder<CTestStruct, CSortOnCriteriaC, CSortOnCriteriaA, CSortOnCriteriaB>());
+		CHeap<CTestStruct> staticHeap(staticSortOrder);
+		for (std::size_t i = 0; i < testStructs.size(); ++i)
+		{
+			staticHeap.Insert(testStructs[i]);
+		}
+		assert(staticHeap.PeekTop().criteriaC == "Tom");
+		assert(staticHeap.PeekTop().criteriaA == 2);
+		assert(staticHeap.PeekTop().criteriaB == 2.0);
+		staticHeap.PopTop();
+		assert(staticHeap.PeekTop().criteriaC == "Tom");
+		assert(staticHeap.PeekTop().criteriaA == 2);
+		assert(staticHeap.PeekTop().criteriaB == 1.0);
+	}
+
+	//! Append a value to a sort key with the builder method for its type
+	void AppendToSortKey(CSortKeyBuilder& key, int value) { key.AppendSigned(value); }
+	void AppendToSortKey(CSortKeyBuilder& key, double value) { key.AppendDouble(value); }
+	void AppendToSortKey(CSortKeyBuilder& key, const std::string& value) { key.AppendString(value); }
+
+	//************************************************************************
+	//! @details
+	//!   Encode values into normalized keys and make sure memcmp on the keys
+	//!  orders them the same way the values are ordered
+	//!************************************************************************
+	template <class T>
+	void CheckNormalizedKeyOrder(const std::vector<T>& ascendingValues)
+	{
+		for (std::size_t i = 1; i < ascendingValues.size(); ++i)
+		{
+			unsigned char lowerKey[16] = {0};
+			unsigned char upperKey[16] = {0};
+			CSortKeyBuilder lowerBuilder(lowerKey, sizeof(lowerKey));
+			CSortKeyBuilder upperBuilder(upperKey, sizeof(upperKey));
+			AppendToSortKey(lowerBuilder, ascendingValues[i - 1]);
+			AppendToSortKey(upperBuilder, ascendingValues[i]);
+			assert(lowerBuilder.IsComplete() && upperBuilder.IsComplete());
+			assert(memcmp(lowerKey, upperKey, sizeof(lowerKey)) < 0);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run the normalized sort keys and the heap built on them through a
+	//!  series of tests
+	//!************************************************************************
+	void TestNormalizedSortKey()
+	{
+		std::vector<int> ints;
+		ints.push_back(-2000000000);
+		ints.push_back(-5);
+		ints.push_back(-1);
+		ints.push_back(0);
+		ints.push_back(3);
+		ints.push_back(2000000000);
+		CheckNormalizedKeyOrder(ints);
+
+		std::vector<double> doubles;
+		doubles.push_back(-1e300);
+		doubles.push_back(-2.5);
+		doubles.push_back(-1e-300);
+		doubles.push_back(0.0);
+		doubles.push_back(1e-300);
+		doubles.push_back(3.0);
+		doubles.push_back(1e300);
+		CheckNormalizedKeyOrder(doubles);
+
+		std::vector<std::string> strings;
+		strings.push_back("");
+		strings.push_back(std::string("\0", 1));
+		strings.push_back("\x01");
+		strings.push_back("a");
+		strings.push_back(std::string("a\0", 2));
+		strings.push_back(std::string("a\0b", 3));
+		strings.push_back("a\x01");
+		strings.push_back("ab");
+		strings.push_back("b");
+		CheckNormalizedKeyOrder(strings);
+
+		// -0.0 == 0.0 so they must get the same key
+		unsigned char negZeroKey[8] = {0};
+		unsigned char zeroKey[8] = {0};
+		CSortKeyBuilder negZeroBuilder(negZeroKey, sizeof(negZeroKey));
+		CSortKeyBuilder zeroBuilder(zeroKey, sizeof(zeroKey));
+		negZeroBuilder.AppendDouble(-0.0);
+		zeroBuilder.AppendDouble(0.0);
+		assert(memcmp(negZeroKey, zeroKey, sizeof(zeroKey)) == 0);
+
+		// A string that doesn't fit closes the key
+		unsigned char shortKey[4] = {0};
+		CSortKeyBuilder shortBuilder(shortKey, sizeof(shortKey));
+		shortBuilder.AppendString("Harry");
+		shortBuilder.AppendUnsigned(7u);
+		assert(!shortBuilder.IsComplete());
+		assert(memcmp(shortKey, "Harr", 4) == 0);
+
+		// 15 byte keys only hold 3 bytes of criteria C, so Harry and Harold
+		// tie on their keys and have to fall back on the full sort order
+		ISortOrderTestStructPtr  criteriaASort(new CSortOnCriteriaA());
+		ISortOrderTestStructPtr  criteriaBSort(new CSortOnCriteriaB());
+		ISortOrderTestStructPtr  criteriaCSort(new CSortOnCriteriaC());
+		std::vector< ISortOrderTestStructPtr > sortCriteria;
+		sortCriteria.push_back(criteriaASort);
+		sortCriteria.push_back(criteriaBSort);
+		sortCriteria.push_back(criteriaCSort);
+		ISortOrderTestStructPtr sortByAThenBThenC(new CCompositeSortOrder<CTestStruct>(sortCriteria));
+		std::shared_ptr< ISortKeyEncoder<CTestStruct> > encoder(new CTestStructSortKeyEncoder());
+
+		CHeap<CTestStruct> referenceHeap(sortByAThenBThenC);
+		CNormalizedKeyHeap<CTestStruct, 15> keyedHeap(sortByAThenBThenC, encoder);
+		const char* names[] = {"Harry", "Harold", "Har", "Tom", ""};
+		for (unsigned int i = 0; i < 60; ++i)
+		{
+			CTestStruct testStruct(i % 2, ((i * 7) % 3) - 1.0, names[(i * 11) % 5]);
+			referenceHeap.Insert(testStruct);
+			keyedHeap.Insert(testStruct);
+		}
+		assert(keyedHeap.GetSize() == 60);
+		while (referenceHeap.GetSize() > 0)
+		{
+			assert(keyedHeap.PeekTop().criteriaA == referenceHeap.PeekTop().criteriaA);
+			assert(keyedHeap.PeekTop().criteriaB == referenceHeap.PeekTop().criteriaB);
+			assert(keyedHeap.PeekTop().criteriaC == referenceHeap.PeekTop().criteriaC);
+			keyedHeap.PopTop();
+			referenceHeap.PopTop();
+		}
+		assert(keyedHeap.GetSize() == 0);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run the radix heap through a series of tests, checking it against a
+	//!  heap with the smallest items on top
+	//!************************************************************************
+	void TestRadixHeap()
+	{
+		CRadixHeap<unsigned int, int> radixHeap;
+		radixHeap.Push(5, 50);
+		radixHeap.Push(13, 130);
+		radixHeap.Push(3, 30);
+		radixHeap.Push(13, 131);
+		assert(radixHeap.GetSize() == 4);
+		assert(radixHeap.PeekFront().first == 3);
+		assert(radixHeap.PeekFront().second == 30);
+		radixHeap.PopFront();
+		assert(radixHeap.PeekFront().first == 5);
+
+		// nothing below the front can go in any more
+		bool threw = false;
+		try
+		{
+			radixHeap.Push(4, 40);
+		}
+		catch (CRadixHeap<unsigned int, int>::CKeyBelowFront&)
+		{
+			threw = true;
+		}
+		assert(threw);
+		radixHeap.Push(5, 51);
+		radixHeap.PopFront();
+		radixHeap.PopFront();
+		assert(radixHeap.PeekFront().first == 13);
+		radixHeap.PopFront();
+		radixHeap.PopFront();
+		assert(radixHeap.GetSize() == 0);
+
+		threw = false;
+		try
+		{
+			radixHeap.PeekFront();
+		}
+		catch (CRadixHeap<unsigned int, int>::CCannotAccessEmptyHeap&)
+		{
+			threw = true;
+		}
+		assert(threw);
+
+		// interleave pushes above the front with pops
+		CHeap<unsigned int>::ISortOrderPtr gtSortOrder(new CStdGreaterSortOrder<unsigned int>());
+		CHeap<unsigned int> referenceHeap(gtSortOrder);
+		CRadixHeap<unsigned int, int> bigRadixHeap;
+		unsigned int front = 0;
+		for (unsigned int i = 0; i < 3000; ++i)
+		{
+			if (i % 3 == 2 && referenceHeap.GetSize() > 0)
+			{
+				front = referenceHeap.PeekTop();
+				assert(bigRadixHeap.PeekFront().first == front);
+				referenceHeap.PopTop();
+				bigRadixHeap.PopFront();
+			}
+			else
+			{
+				const unsigned int key = front + (i * 7919) % (1u << (i % 20));
+				referenceHeap.Insert(key);
+				bigRadixHeap.Push(key, 0);
+			}
+		}
+		while (referenceHeap.GetSize() > 0)
+		{
+			assert(bigRadixHeap.PeekFront().first == referenceHeap.PeekTop());
+			referenceHeap.PopTop();
+			bigRadixHeap.PopFront();
+		}
+		assert(bigRadixHeap.GetSize() == 0);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run the timer wheel through a series of tests
+	//!************************************************************************
+	void TestTimerWheel()
+	{
+		typedef CTimerWheel<int>::Tick_t Tick_t;
+		CTimerWheel<int> timerWheel;
+		std::vector<int> expired;
+
+		timerWheel.Schedule(10, 10);
+		timerWheel.Schedule(5, 5);
+		CTimerWheel<int>::TimerId_t timer300 = timerWheel.Schedule(300, 300);
+		timerWheel.Schedule(70000, 70000);
+		const Tick_t farAway = static_cast<Tick_t>(1) << 40;
+		timerWheel.Schedule(farAway, 40);
+		CTimerWheel<int>::TimerId_t cancelledFarAway = timerWheel.Schedule(farAway + 1, 41);
+		assert(timerWheel.GetSize() == 6);
+
+		timerWheel.PopExpired(4, expired);
+		assert(expired.empty());
+		timerWheel.PopExpired(10, expired);
+		assert(expired.size() == 2 && expired[0] == 5 && expired[1] == 10);
+		expired.clear();
+
+		assert(timerWheel.Cancel(timer300));
+		assert(!timerWheel.Cancel(timer300));
+		assert(timerWheel.Cancel(cancelledFarAway));
+		assert(!timerWheel.Cancel(cancelledFarAway));
+		assert(timerWheel.GetSize() == 2);
+
+		// deadlines already passed come out on the next call
+		timerWheel.Schedule(3, 3);
+		timerWheel.PopExpired(10, expired);
+		assert(expired.size() == 1 && expired[0] == 3);
+		expired.clear();
+
+		timerWheel.PopExpired(69999, expired);
+		assert(expired.empty());
+		timerWheel.PopExpired(70000, expired);
+		assert(expired.size() == 1 && expired[0] == 70000);
+		expired.clear();
+
+		timerWheel.PopExpired(farAway - 1, expired);
+		assert(expired.empty());
+		timerWheel.PopExpired(farAway + 5, expired);
+		assert(expired.size() == 1 && expired[0] == 40);
+		assert(timerWheel.GetSize() == 0);
+		assert(timerWheel.GetCurrentTime() == farAway + 5);
+		expired.clear();
+
+		// lots of timers spread over every level, a third of them cancelled,
+		// come out exactly once, in deadline order, no earlier than due
+		CTimerWheel<int> busyWheel(1000);
+		std::vector<Tick_t> deadlines;
+		std::vector<bool> cancelled;
+		std::vector<CTimerWheel<int>::TimerId_t> timerIds;
+		for (int i = 0; i < 5000; ++i)
+		{
+			const Tick_t deadline = 1000 + (static_cast<Tick_t>(i) * 2654435761u) % (static_cast<Tick_t>(1) << (i % 36));
+			deadlines.push_back(deadline);
+			cancelled.push_back(false);
+			timerIds.push_back(busyWheel.Schedule(deadline, i));
+		}
+		for (int i = 0; i < 5000; i += 3)
+		{
+			assert(busyWheel.Cancel(timerIds[i]));
+			cancelled[i] = true;
+		}
+		std::vector<bool> fired(deadlines.size(), false);
+		Tick_t now = 1000;
+		for (unsigned int step = 0; busyWheel.GetSize() > 0; ++step)
+		{
+			now += 1 + (static_cast<Tick_t>(step) * 40503u) % (static_cast<Tick_t>(1) << (step % 34));
+			busyWheel.PopExpired(now, expired);
+			for (std::size_t i = 0; i < expired.size(); ++i)
+			{
+				const int timer = expired[i];
+				assert(!cancelled[timer] && !fired[timer]);
+				assert(deadlines[timer] <= now);
+				assert(i == 0 || deadlines[expired[i - 1]] <= deadlines[timer]);
+				fired[timer] = true;
+			}
+			expired.clear();
+		}
+		for (std::size_t i = 0; i < deadlines.size(); ++i)
+		{
+			assert(fired[i] != cancelled[i]);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the min-max heap against a sorted copy of its contents, popping
+	//!  from both ends, and the double-ended queue built on it
+	//!************************************************************************
+	void TestMinMaxHeap()
+	{
+		CMinMaxHeap<int> minMaxHeap(CMinMaxHeap<int>::ISortOrderPtr(new CStdLessSortOrder<int>()));
+		bool thrown = false;
+		try
+		{
+			minMaxHeap.PeekMax();
+		}
+		catch (CMinMaxHeap<int>::CCannotAccessEmptyHeap&)
+		{
+			thrown = true;
+		}
+		assert(thrown);
+
+		minMaxHeap.Insert(5);
+		assert(minMaxHeap.PeekMin() == 5 && minMaxHeap.PeekMax() == 5);
+		minMaxHeap.PopMax();
+		assert(minMaxHeap.GetSize() == 0);
+
+		std::multiset<int> expected;
+		unsigned int seed = 12345;
+		for (int i = 0; i < 3000; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			const int value = static_cast<int>((seed >> 16) % 500);
+			// mostly inserts at first, mostly pops later on
+			if (expected.empty() || (seed >> 8) % 4 < (i < 1500 ? 3u : 1u))
+			{
+				minMaxHeap.Insert(value);
+				expected.insert(value);
+			}
+			else if (value % 2 == 0)
+			{
+				minMaxHeap.PopMin();
+				expected.erase(expected.begin());
+			}
+			else
+			{
+				minMaxHeap.PopMax();
+				expected.erase(--expected.end());
+			}
+			assert(minMaxHeap.GetSize() == expected.size());
+			if (!expected.empty())
+			{
+				assert(minMaxHeap.PeekMin() == *expected.begin());
+				assert(minMaxHeap.PeekMax() == *expected.rbegin());
+			}
+		}
+
+		// a bounded queue keeping the 10 highest priorities, evicting the back
+		CDoubleEndedPqueue<CTestStruct> boundedQueue(CDoubleEndedPqueue<CTestStruct>::ISortOrderPtr(new CSortOnCriteriaA()));
+		for (int i = 0; i < 100; ++i)
+		{
+			boundedQueue.Push(CTestStruct((i * 37) % 100, i, ""));
+			if (boundedQueue.GetSize() > 10)
+			{
+				boundedQueue.PopBack();
+			}
+		}
+		assert(boundedQueue.PeekBack().criteriaA == 90);
+		boundedQueue.ChangeSortOrder(CDoubleEndedPqueue<CTestStruct>::ISortOrderPtr(new CSortOnCriteriaB()));
+		double lastB = 1000.0;
+		while (boundedQueue.GetSize() > 0)
+		{
+			assert(boundedQueue.PeekFront().criteriaA >= 90);
+			assert(boundedQueue.PeekFront().criteriaB < lastB);
+			lastB = boundedQueue.PeekFront().criteriaB;
+			boundedQueue.PopFront();
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Pop everything off heap, checking it comes out largest first and
+	//!  matches the sorted expected items
+	//!************************************************************************
+	void CheckHeapDrainsTo(CHeap<int>& heap, std::vector<int> expected)
+	{
+		std::sort(expected.begin(), expected.end());
+		assert(heap.GetSize() == expected.size());
+		while (!expected.empty())
+		{
+			assert(heap.PeekTop() == expected.back());
+			heap.PopTop();
+			expected.pop_back();
+		}
+		assert(heap.GetSize() == 0);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test merging heaps of similar and of very different sizes, and
+	//!  merging priority queues with sort order changes still pending
+	//!************************************************************************
+	void TestHeapMerge()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int>::ISortOrderPtr gtSortOrder(new CStdGreaterSortOrder<int>());
+		const std::size_t sizes[][2] = { { 0, 0 }, { 0, 50 }, { 50, 0 }, { 1000, 3 }, { 3, 1000 }, { 700, 900 } };
+		for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+		{
+			CHeap<int> dest(ltSortOrder);
+			CHeap<int> src(gtSortOrder);	// merged items follow dest's order
+			std::vector<int> expected;
+			for (std::size_t j = 0; j < sizes[i][0]; ++j)
+			{
+				const int value = static_cast<int>((j * 7919) % 1009);
+				dest.Insert(value);
+				expected.push_back(value);
+			}
+			for (std::size_t j = 0; j < sizes[i][1]; ++j)
+			{
+				const int value = static_cast<int>((j * 104729) % 997);
+				src.Insert(value);
+				expected.push_back(value);
+			}
+			dest.Merge(std::move(src));
+			assert(src.GetSize() == 0);
+			CheckHeapDrainsTo(dest, expected);
+		}
+
+		// a few items merged into a large heap are moved in, not copied: a
+		// long string that stays at the back keeps its buffer
+		CHeap<std::string>::ISortOrderPtr stringSortOrder(new CStdLessSortOrder<std::string>());
+		CHeap<std::string> strings(stringSortOrder);
+		for (int j = 0; j < 100; ++j)
+		{
+			strings.Insert(std::string(64, 'z'));
+		}
+		std::vector<std::string> fewStrings(1, std::string(64, 'a'));
+		const char* const fewBuffer = fewStrings[0].data();
+		strings.Merge(std::move(fewStrings));
+		const std::string* lastString = NULL;
+		for (CHeap<std::string>::COrderedIterator currString = strings.BeginOrdered(); currString != strings.EndOrdered(); ++currString)
+		{
+			lastString = &*currString;
+		}
+		assert(fewStrings.empty() && strings.GetSize() == 101 && lastString->data() == fewBuffer);
+
+		// heapifying a bulk merge moves items, it never copies them
+		struct CCopyCounted
+		{
+			int value;
+			int* numCopies;
+
+			CCopyCounted(int aValue, int* copies) : value(aValue), numCopies(copies) {}
+			CCopyCounted(const CCopyCounted& other) : value(other.value), numCopies(other.numCopies) { ++*numCopies; }
+			CCopyCounted(CCopyCounted&& other) noexcept : value(other.value), numCopies(other.numCopies) {}
+			CCopyCounted& operator=(const CCopyCounted& other) { value = other.value; numCopies = other.numCopies; ++*numCopies; return *this; }
+			CCopyCounted& operator=(CCopyCounted&& other) noexcept { value = other.value; numCopies = other.numCopies; return *this; }
+		};
+		class CCopyCountedSortOrder : public ISortOrder<CCopyCounted>
+		{
+		public:
+			bool LessThan(const CCopyCounted& lhs, const CCopyCounted& rhs) const
+			{
+				return lhs.value < rhs.value;
+			}
+		};
+		int numCopies = 0;
+		CHeap<CCopyCounted> counted(CHeap<CCopyCounted>::ISortOrderPtr(new CCopyCountedSortOrder()));
+		std::vector<CCopyCounted> manyCounted;
+		for (int j = 0; j < 500; ++j)
+		{
+			manyCounted.push_back(CCopyCounted((j * 7919) % 1009, &numCopies));
+		}
+		numCopies = 0;
+		counted.Merge(std::move(manyCounted));
+		assert(numCopies == 0 && counted.GetSize() == 500);
+		for (int previous = 1009; counted.GetSize() > 0; counted.PopTop())
+		{
+			assert(counted.PeekTop().value <= previous);
+			previous = counted.PeekTop().value;
+		}
+		assert(numCopies == 0);
+
+		// merging into itself changes nothing
+		CHeap<int> selfMerged(ltSortOrder);
+		selfMerged.Insert(3);
+		selfMerged.Insert(9);
+		selfMerged.Merge(std::move(selfMerged));
+		std::vector<int> selfExpected;
+		selfExpected.push_back(3);
+		selfExpected.push_back(9);
+		CheckHeapDrainsTo(selfMerged, selfExpected);
+
+		// shard queues, both holding items set aside by a lazy sort change
+		CPqueue<int> consolidated(ltSortOrder);
+		CPqueue<int> shard(ltSortOrder);
+		for (int i = 0; i < 200; ++i)
+		{
+			consolidated.Push(i * 2);
+			shard.Push(i * 2 + 1);
+		}
+		consolidated.ChangeSortOrderLazily(gtSortOrder, 1);
+		shard.ChangeSortOrderLazily(ltSortOrder, 0);
+		assert(shard.PeekFront() == 399);
+		consolidated.Merge(std::move(shard));
+		assert(shard.GetSize() == 0);
+		assert(consolidated.GetSize() == 400);
+		for (int i = 0; i < 400; ++i)
+		{
+			assert(consolidated.PeekFront() == i);
+			consolidated.PopFront();
+		}
+	}
+
+	//! Collects drained items, optionally giving up after a number of them
+	struct CDrainCollector
+	{
+		std::vector<int> items;
+		std::size_t throwAfter;
+
+		CDrainCollector() : throwAfter(0) {}
+		void operator()(const int& item)
+		{
+			if (throwAfter > 0 && items.size() == throwAfter)
+			{
+				throw std::runtime_error("consumer gave up");
+			}
+			items.push_back(item);
+		}
+	};
+
+	//************************************************************************
+	//! @details
+	//!   Test draining many heaps in order with several threads, including
+	//!  empty heaps, heavy duplicates and a consumer that throws
+	//!************************************************************************
+	void TestParallelHeapDrain()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		const std::size_t threadCounts[] = { 1, 4, 7 };
+		for (std::size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+		{
+			std::vector< std::shared_ptr< CHeap<int> > > heaps;
+			std::vector< CHeap<int>* > heapPtrs;
+			std::vector<int> expected;
+			unsigned int seed = 777;
+			for (std::size_t i = 0; i < 64; ++i)
+			{
+				heaps.push_back(std::shared_ptr< CHeap<int> >(new CHeap<int>(ltSortOrder)));
+				heapPtrs.push_back(heaps.back().get());
+				// every 8th heap stays empty, the others differ in size
+				const std::size_t heapSize = i % 8 == 0 ? 0 : (i * 13) % 90;
+				for (std::size_t j = 0; j < heapSize; ++j)
+				{
+					seed = seed * 1103515245 + 12345;
+					const int value = static_cast<int>((seed >> 16) % (i < 32 ? 50 : 100000));
+					heaps.back()->Insert(value);
+					expected.push_back(value);
+				}
+			}
+			std::sort(expected.rbegin(), expected.rend());
+
+			CParallelHeapDrainer<int> drainer(ltSortOrder, threadCounts[t], 16);
+			CDrainCollector collector;
+			drainer.Drain(heapPtrs, collector);
+			assert(collector.items == expected && drainer.GetLastMergeSeconds() >= 0.0);
+			for (std::size_t i = 0; i < heaps.size(); ++i)
+			{
+				assert(heaps[i]->GetSize() == 0);
+			}
+
+			// nothing to drain
+			drainer.Drain(heapPtrs, collector);
+			assert(collector.items.size() == expected.size());
+		}
+
+		// a consumer that throws stops the merging threads
+		std::vector< std::shared_ptr< CHeap<int> > > heaps;
+		std::vector< CHeap<int>* > heapPtrs;
+		for (int i = 0; i < 8; ++i)
+		{
+			heaps.push_back(std::shared_ptr< CHeap<int> >(new CHeap<int>(ltSortOrder)));
+			heapPtrs.push_back(heaps.back().get());
+			for (int j = 0; j < 1000; ++j)
+			{
+				heaps.back()->Insert(i * 1000 + j);
+			}
+		}
+		CParallelHeapDrainer<int> drainer(ltSortOrder, 4, 8);
+		CDrainCollector collector;
+		collector.throwAfter = 100;
+		bool thrown = false;
+		try
+		{
+			drainer.Drain(heapPtrs, collector);
+		}
+		catch (std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown);
+		assert(collector.items.size() == 100 && collector.items[0] == 7999 && collector.items[99] == 7900);
+	}
+
+#if defined(__cpp_impl_coroutine)
+	//! Coroutine that starts running when called and frees itself when done
+	struct CDetachedTask
+	{
+		struct promise_type
+		{
+			CDetachedTask get_return_object() { return CDetachedTask(); }
+			std::suspend_never initial_suspend() { return std::suspend_never(); }
+			std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	//! Single threaded event loop running posted coroutines in order
+	class CTestEventLoop
+	{
+	private:
+		std::deque< std::coroutine_handle<> > m_ready;
+	public:
+		void Post(std::coroutine_handle<> coroutine)
+		{
+			m_ready.push_back(coroutine);
+		}
+
+		//! Resume posted coroutines until there are none left
+		void Run()
+		{
+			while (!m_ready.empty())
+			{
+				std::coroutine_handle<> coroutine = m_ready.front();
+				m_ready.pop_front();
+				coroutine.resume();
+			}
+		}
+	};
+
+	//! Pop numItems items from queue, recording each with the consumer's id
+	CDetachedTask ConsumeItems(CAsyncPqueue<int>& queue, int consumerId, int numItems, std::vector< std::pair<int, int> >& consumed)
+	{
+		for (int i = 0; i < numItems; ++i)
+		{
+			const int item = co_await queue.Pop();
+			consumed.push_back(std::make_pair(consumerId, item));
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the coroutine queue: waiters suspend until a push, are served
+	//!  in the order they waited and get the highest priority item, both
+	//!  with inline resumption and through an event loop
+	//!************************************************************************
+	void TestAsyncPqueue()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		std::vector< std::pair<int, int> > consumed;
+
+		// items already queued come out without suspending, best first
+		CAsyncPqueue<int> inlineQueue(ltSortOrder);
+		inlineQueue.Push(3);
+		inlineQueue.Push(8);
+		inlineQueue.Push(5);
+		ConsumeItems(inlineQueue, 0, 2, consumed);
+		assert(consumed.size() == 2 && consumed[0].second == 8 && consumed[1].second == 5);
+		assert(inlineQueue.GetSize() == 1 && inlineQueue.GetNumWaiters() == 0);
+		consumed.clear();
+
+		// waiters suspend and are resumed inside Push, longest waiting first
+		ConsumeItems(inlineQueue, 1, 3, consumed);
+		assert(consumed.size() == 1 && consumed[0].second == 3);
+		ConsumeItems(inlineQueue, 2, 1, consumed);
+		assert(inlineQueue.GetNumWaiters() == 2);
+		inlineQueue.Push(10);
+		assert(consumed.size() == 2 && consumed[1] == std::make_pair(1, 10));
+		inlineQueue.Push(20);
+		assert(consumed.size() == 3 && consumed[2] == std::make_pair(2, 20));
+		inlineQueue.Push(30);
+		assert(consumed.size() == 4 && consumed[3] == std::make_pair(1, 30));
+		assert(inlineQueue.GetNumWaiters() == 0 && inlineQueue.GetSize() == 0);
+		consumed.clear();
+
+		// resumed through the loop, so items pushed meanwhile queue up
+		CTestEventLoop loop;
+		CAsyncPqueue<int> loopQueue(ltSortOrder, [&loop](std::coroutine_handle<> coroutine) { loop.Post(coroutine); });
+		ConsumeItems(loopQueue, 1, 2, consumed);
+		ConsumeItems(loopQueue, 2, 2, consumed);
+		loopQueue.Push(4);
+		assert(consumed.empty() && loopQueue.GetNumWaiters() == 1);
+		loopQueue.Push(1);
+		loopQueue.Push(9);
+		loopQueue.Push(7);
+		assert(loopQueue.GetNumWaiters() == 0 && loopQueue.GetSize() == 2);
+		loop.Run();
+		// consumer 1 was handed 4 and consumer 2 was handed 1. Consumer 1
+		// runs first and pops the best of what is left without waiting.
+		assert(consumed.size() == 4);
+		assert(consumed[0] == std::make_pair(1, 4) && consumed[1] == std::make_pair(1, 9));
+		assert(consumed[2] == std::make_pair(2, 1) && consumed[3] == std::make_pair(2, 7));
+		assert(loopQueue.GetSize() == 0);
+	}
+#endif
+
+	//************************************************************************
+	//! @details
+	//!   Test the blocking queue on one thread (capacity, timeouts, batches,
+	//!  close) and with several producers and consumers
+	//!************************************************************************
+	void TestBlockingPqueue()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CBlockingPqueue<int> queue(ltSortOrder, 3);
+		assert(queue.TryPush(4) && queue.TryPush(9) && queue.Push(1));
+		assert(!queue.TryPush(5));
+		assert(queue.GetSize() == 3);
+
+		int item = 0;
+		assert(queue.PopFront(item) && item == 9);
+		std::vector<int> batch;
+		assert(queue.PopBatch(batch, 5) == 2 && batch[0] == 4 && batch[1] == 1);
+		assert(!queue.PopFrontFor(item, std::chrono::milliseconds(5)));
+		assert(item == 9);
+
+		queue.Push(7);
+		queue.Push(2);
+		queue.Close();
+		assert(queue.IsClosed());
+		assert(!queue.Push(8) && !queue.TryPush(8));
+		assert(queue.PopFrontFor(item, std::chrono::seconds(10)) && item == 7);
+		queue.Drain(batch);
+		assert(batch.size() == 1 && batch[0] == 2);
+		assert(!queue.PopFront(item));
+		assert(queue.PopBatch(batch, 5) == 0 && batch.empty());
+
+		// a producer blocked on a full queue gives up when it is closed
+		CBlockingPqueue<int> fullQueue(ltSortOrder, 1);
+		fullQueue.Push(1);
+		bool blockedPushResult = true;
+		std::thread blockedProducer([&]() { blockedPushResult = fullQueue.Push(2); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		fullQueue.Close();
+		blockedProducer.join();
+		assert(!blockedPushResult);
+
+		// every item pushed by several producers through a small queue comes
+		// out exactly once
+		const int numProducers = 4;
+		const int itemsPerProducer = 2000;
+		CBlockingPqueue<int> pipeline(ltSortOrder, 16);
+		std::vector<std::thread> producers;
+		for (int producer = 0; producer < numProducers; ++producer)
+		{
+			producers.push_back(std::thread([&pipeline, producer, itemsPerProducer]() {
+				for (int i = 0; i < itemsPerProducer; ++i)
+				{
+					pipeline.Push(producer * itemsPerProducer + i);
+				}
+			}));
+		}
+		std::vector<int> received[2];
+		std::vector<std::thread> consumers;
+		for (int consumer = 0; consumer < 2; ++consumer)
+		{
+			std::vector<int>& myItems = received[consumer];
+			consumers.push_back(std::thread([&pipeline, &myItems, consumer]() {
+				int poppedItem = 0;
+				std::vector<int> poppedBatch;
+				for (;;)
+				{
+					if (consumer == 0)
+					{
+						if (!pipeline.PopFront(poppedItem))
+						{
+							return;
+						}
+						myItems.push_back(poppedItem);
+					}
+					else
+					{
+						if (pipeline.PopBatch(poppedBatch, 8) == 0)
+						{
+							return;
+						}
+						assert(std::is_sorted(poppedBatch.rbegin(), poppedBatch.rend()));
+						myItems.insert(myItems.end(), poppedBatch.begin(), poppedBatch.end());
+					}
+				}
+			}));
+		}
+		for (std::size_t i = 0; i < producers.size(); ++i)
+		{
+			producers[i].join();
+		}
+		pipeline.Close();
+		for (std::size_t i = 0; i < consumers.size(); ++i)
+		{
+			consumers[i].join();
+		}
+		std::vector<int> allReceived(received[0]);
+		allReceived.insert(allReceived.end(), received[1].begin(), received[1].end());
+		std::sort(allReceived.begin(), allReceived.end());
+		assert(allReceived.size() == static_cast<std::size_t>(numProducers * itemsPerProducer));
+		for (std::size_t i = 0; i < allReceived.size(); ++i)
+		{
+			assert(allReceived[i] == static_cast<int>(i));
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the heap and queue counters. Without PQUEUE_ENABLE_STATS they
+	//!  must all stay zero.
+	//!************************************************************************
+	void TestHeapStats()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int>::ISortOrderPtr gtSortOrder(new CStdGreaterSortOrder<int>());
+		CHeap<int> heap(ltSortOrder);
+		// every item inserted is the largest so far and climbs to the root
+		for (int i = 0; i < 100; ++i)
+		{
+			heap.Insert(i);
+		}
+		for (int i = 0; i < 10; ++i)
+		{
+			heap.PopTop();
+		}
+		const CHeapStats heapStats = heap.GetStats();
+
+		CPqueue<int> queue(ltSortOrder);
+		for (int i = 0; i < 50; ++i)
+		{
+			queue.Push(i);
+		}
+		queue.ChangeSortOrder(gtSortOrder);
+		queue.PopFront();
+		const CPqueueStats queueStats = queue.GetStats();
+
+		std::uint64_t numSifts = 0;
+		for (std::size_t i = 0; i < CHeapStats::NUM_DEPTH_BUCKETS; ++i)
+		{
+			numSifts += heapStats.siftDepths[i];
+		}
+#ifdef PQUEUE_ENABLE_STATS
+		assert(heapStats.numInserts == 100 && heapStats.numPops == 10);
+		assert(heapStats.peakSize == 100);
+		assert(heapStats.numComparisons >= heapStats.numSwaps && heapStats.numSwaps > 100);
+		assert(heapStats.numReallocations > 0 && heapStats.numReallocations < 100);
+		assert(numSifts == 110);
+		// the 100th item starts on level 6 and climbs all the way
+		assert(heapStats.siftDepths[6] > 0 && heapStats.siftDepths[7] == 0);
+
+		// the first heap's work is kept when the sort order change replaces it
+		assert(queueStats.numSortOrderChanges == 1);
+		assert(queueStats.heapStats.numInserts == 100 && queueStats.heapStats.numPops == 1);
+		assert(queueStats.heapStats.peakSize == 50);
+		assert(queueStats.totalSortOrderChangeSeconds >= queueStats.lastSortOrderChangeSeconds);
+		assert(queueStats.lastSortOrderChangeSeconds >= 0.0);
+#else
+		assert(heapStats.numInserts == 0 && heapStats.numPops == 0 && heapStats.numComparisons == 0);
+		assert(heapStats.numSwaps == 0 && heapStats.peakSize == 0 && heapStats.numReallocations == 0);
+		assert(numSifts == 0);
+		assert(queueStats.numSortOrderChanges == 0 && queueStats.heapStats.numInserts == 0);
+		assert(queueStats.totalSortOrderChangeSeconds == 0.0);
+#endif
+	}
+
+	//! Records an int's value as its trace key
+	class CIntTraceKeyEncoder : public ITraceKeyEncoder<int>
+	{
+	public:
+		std::uint64_t GetTraceKey(const int& item) const
+		{
+			return static_cast<std::uint64_t>(item);
+		}
+	};
+
+	//************************************************************************
+	//! @details
+	//!   Test recording a queue's operations to a trace and reading them
+	//!  back, and rejecting damaged traces
+	//!************************************************************************
+	void TestPqueueTrace()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int>::ISortOrderPtr gtSortOrder(new CStdGreaterSortOrder<int>());
+		std::stringstream trace(std::ios::in | std::ios::out | std::ios::binary);
+		std::shared_ptr< CPqueueTraceRecorder<int> > recorder(new CPqueueTraceRecorder<int>(trace,
+			CPqueueTraceRecorder<int>::ITraceKeyEncoderPtr(new CIntTraceKeyEncoder())));
+
+		CPqueue<int> queue(ltSortOrder);
+		queue.Push(1);		// not recorded
+		queue.SetTraceRecorder(recorder);
+		queue.Push(5);
+		queue.Push(300000);
+		assert(queue.PeekFront() == 300000);
+		queue.PopFront();
+		queue.ChangeSortOrder(gtSortOrder);
+		queue.ChangeSortOrderLazily(ltSortOrder, 1);
+		queue.PopFront();
+		queue.SetTraceRecorder(std::shared_ptr< CPqueueTraceRecorder<int> >());
+		queue.PopFront();	// not recorded
+		recorder->Flush();
+		assert(recorder->GetNumRecorded() == 7);
+
+		std::vector<CTraceOp> ops;
+		CTraceWriter::ReadTrace(trace, ops);
+		const ETraceOp expectedOps[] = { TRACE_PUSH, TRACE_PUSH, TRACE_PEEK_FRONT, TRACE_POP_FRONT,
+			TRACE_CHANGE_SORT_ORDER, TRACE_CHANGE_SORT_ORDER, TRACE_POP_FRONT };
+		const std::uint64_t expectedKeys[] = { 5, 300000, 0, 0, 1, 2, 0 };
+		assert(ops.size() == 7);
+		for (std::size_t i = 0; i < ops.size(); ++i)
+		{
+			assert(ops[i].op == expectedOps[i] && ops[i].key == expectedKeys[i]);
+			assert(i == 0 || ops[i - 1].timestampNs <= ops[i].timestampNs);
+		}
+
+		// damaged traces are rejected rather than misread
+		const std::string traceBytes = trace.str();
+		std::string badMagic(traceBytes);
+		badMagic[0] = 'X';
+		std::string unknownOp(traceBytes);
+		unknownOp[8] = 9;
+		const std::string cutOff(traceBytes, 0, 10);
+		const std::string* damagedTraces[] = { &badMagic, &unknownOp, &cutOff };
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			std::istringstream damaged(*damagedTraces[i], std::ios::in | std::ios::binary);
+			bool thrown = false;
+			try
+			{
+				CTraceWriter::ReadTrace(damaged, ops);
+			}
+			catch (CTraceFormatError&)
+			{
+				thrown = true;
+			}
+			assert(thrown);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test moving heaps and queues, which hands over the items without
+	//!  copying them and leaves the source empty but usable
+	//!************************************************************************
+	void TestHeapMove()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int> heap(ltSortOrder);
+		for (int i = 0; i < 20; ++i)
+		{
+			heap.Insert(i * 7 % 20);
+		}
+		CHeap<int> movedHeap(std::move(heap));
+		assert(heap.GetSize() == 0 && movedHeap.GetSize() == 20);
+		heap.Insert(3);
+		assert(heap.PeekTop() == 3);
+
+		// the comparison counter follows the heap when stats are on
+		const std::uint64_t comparisonsBefore = movedHeap.GetStats().numComparisons;
+		movedHeap.PopTop();
+		assert(movedHeap.PeekTop() == 18);
+#ifdef PQUEUE_ENABLE_STATS
+		assert(movedHeap.GetStats().numComparisons > comparisonsBefore);
+#else
+		assert(comparisonsBefore == 0);
+#endif
+		heap = std::move(movedHeap);
+		assert(heap.GetSize() == 19 && heap.PeekTop() == 18);
+
+		// a heap in a container can be moved around as it grows
+		std::vector< CHeap<int> > heaps;
+		for (int i = 0; i < 10; ++i)
+		{
+			heaps.push_back(CHeap<int>(ltSortOrder));
+			heaps.back().Insert(i);
+			heaps.back().Insert(-i);
+		}
+		for (int i = 0; i < 10; ++i)
+		{
+			assert(heaps[i].GetSize() == 2 && heaps[i].PeekTop() == i);
+		}
+
+		CPqueue<int> queue(ltSortOrder);
+		for (int i = 0; i < 10; ++i)
+		{
+			queue.Push(i);
+		}
+		queue.ChangeSortOrderLazily(CHeap<int>::ISortOrderPtr(new CStdGreaterSortOrder<int>()), 1);
+		CPqueue<int> movedQueue(std::move(queue));
+		assert(movedQueue.GetSize() == 10 && movedQueue.PeekFront() == 0);
+		movedQueue.PopFront();
+		assert(movedQueue.PeekFront() == 1);
+
+		CDoubleEndedPqueue<int> doubleEnded(ltSortOrder);
+		doubleEnded.Push(4);
+		doubleEnded.Push(9);
+		CDoubleEndedPqueue<int> movedDoubleEnded(std::move(doubleEnded));
+		assert(movedDoubleEnded.PeekFront() == 9 && movedDoubleEnded.PeekBack() == 4);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test reading the top of a heap or queue in order, and visiting every
+	//!  item, without changing it
+	//!************************************************************************
+	void TestHeapTopK()
+	{
+		CHeap<int>::ISortOrderPtr ltSortOrder(new CStdLessSortOrder<int>());
+		CHeap<int> heap(ltSortOrder);
+		std::vector<int> expected;
+		for (int i = 0; i < 200; ++i)
+		{
+			// plenty of duplicates
+			heap.Insert(i * 37 % 61);
+			expected.push_back(i * 37 % 61);
+		}
+		std::sort(expected.begin(), expected.end(), std::greater<int>());
+
+		const std::size_t ks[] = { 0, 1, 7, 50, 200, 250 };
+		for (std::size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); ++i)
+		{
+			std::vector<int> topK(3, -1);
+			heap.PeekTopK(ks[i], topK);
+			const std::size_t numExpected = ks[i] < expected.size() ? ks[i] : expected.size();
+			assert(topK == std::vector<int>(expected.begin(), expected.begin() + numExpected));
+		}
+
+		std::vector<int> ordered(heap.BeginOrdered(), heap.EndOrdered());
+		assert(ordered == expected);
+		CHeap<int>::COrderedIterator second = heap.BeginOrdered();
+		assert(*second++ == expected[0] && *second == expected[1]);
+		assert(heap.BeginOrdered() != heap.EndOrdered());
+
+		int sum = 0;
+		std::size_t count = 0;
+		heap.ForEach([&sum, &count](const int& item) { sum += item; ++count; });
+		assert(count == expected.size() && sum == std::accumulate(expected.begin(), expected.end(), 0));
+
+		// nothing was disturbed
+		CheckHeapDrainsTo(heap, expected);
+		CHeap<int> emptyHeap(ltSortOrder);
+		assert(emptyHeap.BeginOrdered() == emptyHeap.EndOrdered());
+
+		// a queue merges the heap with the elements set aside by a lazy
+		// sort order change
+		CPqueue<int> queue(ltSortOrder);
+		for (int i = 0; i < 40; ++i)
+		{
+			queue.Push(i);
+		}
+		queue.ChangeSortOrderLazily(CHeap<int>::ISortOrderPtr(new CStdGreaterSortOrder<int>()), 3);
+		for (int i = 40; i < 50; ++i)
+		{
+			queue.Push(i - 45);
+		}
+		std::vector<int> frontK;
+		queue.PeekFrontK(8, frontK);
+		const int expectedFront[] = { -5, -4, -3, -2, -1, 0, 0, 1 };
+		assert(frontK == std::vector<int>(expectedFront, expectedFront + 8));
+		std::size_t numQueued = 0;
+		queue.ForEach([&numQueued](const int&) { ++numQueued; });
+		assert(numQueued == 50 && queue.GetSize() == 50);
+		for (std::size_t i = 0; i < 8; ++i)
+		{
+			assert(queue.PeekFront() == expectedFront[i]);
+			queue.PopFront();
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test that stable heaps hand out equal priorities first in, first
+	//!  out, with a sort order or with packed integer priorities
+	//!************************************************************************
+	void TestStableHeap()
+	{
+		// (priority, id) pairs sorted on priority alone, the stable heap
+		// should only need the three-way compare
+		typedef std::pair<int, int> Job_t;
+		class CJobPrioritySortOrder : public ISortOrder<Job_t>
+		{
+		public:
+			explicit CJobPrioritySortOrder(std::size_t& numLessThanCalls) :
+			  m_numLessThanCalls(numLessThanCalls)
+			{
+			}
+
+			bool LessThan(const Job_t& lhs, const Job_t& rhs) const
+			{
+				++m_numLessThanCalls;
+				return lhs.first < rhs.first;
+			}
+
+			int Compare(const Job_t& lhs, const Job_t& rhs) const
+			{
+				return ThreeWayCompare(lhs.first, rhs.first);
+			}
+
+		private:
+			std::size_t& m_numLessThanCalls;
+		};
+		std::size_t numLessThanCalls = 0;
+		CStableHeap<Job_t> stableHeap(CStableHeap<Job_t>::ISortOrderPtr(new CJobPrioritySortOrder(numLessThanCalls)));
+		CPackedStableHeap<int, int> packedHeap;
+		CPackedStableHeap<std::int64_t, int> widePackedHeap;
+		CPackedStableHeap<std::uint8_t, int> smallestFirstHeap(true);
+		for (int id = 0; id < 300; ++id)
+		{
+			const int priority = (id * 7) % 5 - 2;
+			stableHeap.Insert(Job_t(priority, id));
+			packedHeap.Push(priority, id);
+			widePackedHeap.Push(static_cast<std::int64_t>(priority) * 10000000000LL, id);
+			smallestFirstHeap.Push(static_cast<std::uint8_t>(priority + 2), id);
+		}
+		assert(packedHeap.GetSize() == 300 && widePackedHeap.GetSize() == 300);
+
+		Job_t previous(3, -1);
+		for (int i = 0; i < 300; ++i)
+		{
+			const Job_t job = stableHeap.PeekTop();
+			stableHeap.PopTop();
+			// priorities never rise, ids rise within a priority
+			assert(job.first < previous.first || (job.first == previous.first && job.second > previous.second));
+			assert(packedHeap.PeekTopPriority() == job.first && packedHeap.PeekTop() == job.second);
+			assert(widePackedHeap.PeekTopPriority() == job.first * 10000000000LL && widePackedHeap.PeekTop() == job.second);
+			packedHeap.PopTop();
+			widePackedHeap.PopTop();
+			previous = job;
+		}
+		assert(numLessThanCalls == 0);
+
+		// smallest first, still first in first out within a priority
+		int previousPriority = -1;
+		int previousId = -1;
+		while (smallestFirstHeap.GetSize() > 0)
+		{
+			const int priority = smallestFirstHeap.PeekTopPriority();
+			const int id = smallestFirstHeap.PeekTop();
+			assert(priority > previousPriority || (priority == previousPriority && id > previousId));
+			previousPriority = priority;
+			previousId = id;
+			smallestFirstHeap.PopTop();
+		}
+
+		// renumbering keeps the order of what is queued and of later pushes
+		for (int id = 0; id < 10; ++id)
+		{
+			packedHeap.Push(id % 2, id);
+		}
+		packedHeap.Renumber();
+		packedHeap.Push(1, 10);
+		packedHeap.Push(0, 11);
+		const int expectedIds[] = { 1, 3, 5, 7, 9, 10, 0, 2, 4, 6, 8, 11 };
+		for (std::size_t i = 0; i < 12; ++i)
+		{
+			assert(packedHeap.PeekTop() == expectedIds[i]);
+			packedHeap.PopTop();
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test that aged queues hand out the value with the largest effective
+	//!  priority, across renormalizations, for both aging modes
+	//!************************************************************************
+	void TestAgingPqueue()
+	{
+		const EAgingMode modes[] = { AGING_ADDITIVE, AGING_MULTIPLICATIVE };
+		for (std::size_t modeIdx = 0; modeIdx < 4; ++modeIdx)
+		{
+			const EAgingMode mode = modes[modeIdx % 2];
+			const double agingRate = mode == AGING_ADDITIVE ? 0.5 : 0.01;
+			// renormalize often so the checks below cross several of them,
+			// or only when asked
+			const CAgingPqueue<int>::Tick_t renormalizeInterval = modeIdx < 2 ? 37 : CAgingPqueue<int>::MANUAL_RENORMALIZE;
+			CAgingPqueue<int> queue(agingRate, mode, 100, renormalizeInterval);
+			std::vector<double> priorities;
+			std::vector<CAgingPqueue<int>::Tick_t> pushTimes;
+			std::vector<bool> isQueued;
+			CAgingPqueue<int>::Tick_t now = 100;
+			for (int step = 0; step < 400; ++step)
+			{
+				const double priority = 1.0 + (step * 37) % 101;
+				queue.Push(priority, step);
+				priorities.push_back(priority);
+				pushTimes.push_back(now);
+				isQueued.push_back(true);
+				now += step % 3;
+				queue.AdvanceTime(now);
+				if (step == 250)
+				{
+					queue.Renormalize();
+				}
+				if (step % 4 != 3)
+				{
+					continue;
+				}
+
+				// the front is the best value by brute force
+				double bestPriority = 0.0;
+				for (std::size_t i = 0; i < priorities.size(); ++i)
+				{
+					if (!isQueued[i])
+					{
+						continue;
+					}
+					const double waited = static_cast<double>(now - pushTimes[i]);
+					const double effective = mode == AGING_ADDITIVE ? priorities[i] + agingRate * waited : priorities[i] * std::exp(agingRate * waited);
+					bestPriority = effective > bestPriority ? effective : bestPriority;
+				}
+				const int front = queue.PeekFront();
+				assert(std::fabs(queue.PeekFrontPriority() - bestPriority) < 1e-6 * bestPriority);
+				const double frontWaited = static_cast<double>(now - pushTimes[front]);
+				const double frontPriority = mode == AGING_ADDITIVE ? priorities[front] + agingRate * frontWaited : priorities[front] * std::exp(agingRate * frontWaited);
+				assert(std::fabs(frontPriority - bestPriority) < 1e-6 * bestPriority);
+				isQueued[front] = false;
+				queue.PopFront();
+			}
+			assert(queue.GetCurrentTime() == now && queue.GetSize() == 300);
+
+			// time never goes back
+			queue.AdvanceTime(0);
+			assert(queue.GetCurrentTime() == now);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run a mix of inserts and pops, growing past the inline items, and
+	//!  make sure the heap agrees with a sorted multiset of the same items
+	//!************************************************************************
+	template <class SmallHeap_t>
+	void CheckSmallHeapOrder(std::size_t numInline)
+	{
+		SmallHeap_t heap;
+		std::multiset<int> expected;
+		unsigned int random = 12345;
+		for (int step = 0; step < 2000; ++step)
+		{
+			random = random * 1103515245 + 12345;
+			// grow for a while, then shrink back into and out of the inline items
+			const bool isInsert = (step / 100) % 2 == 0 ? random % 4 != 0 : random % 4 == 0;
+			if (isInsert || expected.empty())
+			{
+				const int value = static_cast<int>((random >> 16) % 50);
+				heap.Insert(value);
+				expected.insert(value);
+			}
+			else
+			{
+				assert(heap.PeekTop() == *expected.rbegin());
+				heap.PopTop();
+				expected.erase(--expected.end());
+			}
+			assert(heap.GetSize() == expected.size());
+			assert(heap.IsSpilled() || expected.size() <= numInline);
+		}
+		while (!expected.empty())
+		{
+			assert(heap.PeekTop() == *expected.rbegin());
+			heap.PopTop();
+			expected.erase(--expected.end());
+		}
+		assert(heap.GetSize() == 0);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test small heaps with inline items, in both modes, before and after
+	//!  they spill
+	//!************************************************************************
+	void TestSmallHeap()
+	{
+		CheckSmallHeapOrder< CSmallHeap<int, 4> >(4);
+		CheckSmallHeapOrder< CSmallHeap<int, 4, CStdLessSortOrder<int>, false> >(4);
+		CheckSmallHeapOrder< CSmallHeap<int, 16> >(16);
+		CheckSmallHeapOrder< CSmallHeap<int, 16, CStdLessSortOrder<int>, false> >(16);
+		CheckSmallHeapOrder< CSmallHeap<int, 32> >(32);
+
+		CSmallHeap<int, 4, CStdGreaterSortOrder<int> > smallestFirst;
+		const int values[] = { 5, 3, 9, 1, 7, 3 };
+		for (std::size_t i = 0; i < 4; ++i)
+		{
+			smallestFirst.Insert(values[i]);
+		}
+		assert(!smallestFirst.IsSpilled() && smallestFirst.PeekTop() == 1);
+		smallestFirst.Insert(values[4]);
+		smallestFirst.Insert(values[5]);
+		assert(smallestFirst.IsSpilled());
+
+		// moving keeps the items, inline or spilled
+		CSmallHeap<int, 4, CStdGreaterSortOrder<int> > moved(std::move(smallestFirst));
+		const int expectedOrder[] = { 1, 3, 3, 5, 7, 9 };
+		for (std::size_t i = 0; i < 6; ++i)
+		{
+			assert(moved.PeekTop() == expectedOrder[i]);
+			moved.PopTop();
+		}
+		bool isThrown = false;
+		try
+		{
+			moved.PeekTop();
+		}
+		catch (CSmallHeap<int, 4, CStdGreaterSortOrder<int> >::CCannotAccessEmptyHeap&)
+		{
+			isThrown = true;
+		}
+		assert(isThrown);
+	}
+
+	//! Heap ordered table built at compile time
+	constexpr CStaticHeap<int, 8> MakeStaticHeapTable()
+	{
+		const int items[] = { 4, 9, 1, 7, 3, 6 };
+		CStaticHeap<int, 8> heap(items);
+		heap.Insert(8);
+		heap.PopTop();
+		return heap;
+	}
+
+	//! Pop a heap empty at compile time, checking the order items come out
+	template <class StaticHeap_t, class Compare>
+	constexpr bool IsStaticHeapDrainOrdered(StaticHeap_t heap, Compare compare)
+	{
+		int previous = 0;
+		for (bool isFirst = true; heap.GetSize() > 0; isFirst = false)
+		{
+			int top = 0;
+			if (!heap.PopTop(top) || (!isFirst && compare(previous, top)))
+			{
+				return false;
+			}
+			previous = top;
+		}
+		return true;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the fixed capacity heap, at compile time and at run time, full
+	//!  and empty
+	//!************************************************************************
+	void TestStaticHeap()
+	{
+		constexpr CStaticHeap<int, 8> table = MakeStaticHeapTable();
+		static_assert(table.GetSize() == 6, "the 9 was popped");
+		static_assert(table.GetItems()[0] == 8, "the 8 is on top");
+		static_assert(IsStaticHeapDrainOrdered(table, std::less<int>()), "largest first");
+		constexpr int smallestFirstItems[] = { 5, 2, 8, 2, 9, 0, 7 };
+		static_assert(IsStaticHeapDrainOrdered(CStaticHeap<int, 7, std::greater<int> >(smallestFirstItems), std::greater<int>()), "smallest first");
+		static_assert(CStaticHeap<int, 1>::GetMaxSiftSteps() == 0 && CStaticHeap<int, 7>::GetMaxSiftSteps() == 2 &&
+			CStaticHeap<int, 8>::GetMaxSiftSteps() == 3, "depth of a full heap");
+
+		// run time, against a sorted multiset
+		CStaticHeap<int, 64> heap;
+		std::multiset<int> expected;
+		unsigned int random = 777;
+		for (int step = 0; step < 5000; ++step)
+		{
+			random = random * 1103515245 + 12345;
+			const int value = static_cast<int>((random >> 16) % 1000);
+			if ((random >> 8) % 3 != 0)
+			{
+				assert(heap.Insert(value) == (expected.size() < 64));
+				if (expected.size() < 64)
+				{
+					expected.insert(value);
+				}
+			}
+			else
+			{
+				int top = -1;
+				assert(heap.PopTop(top) == !expected.empty());
+				if (!expected.empty())
+				{
+					assert(top == *expected.rbegin());
+					expected.erase(--expected.end());
+				}
+			}
+			assert(heap.GetSize() == expected.size() && heap.IsFull() == (expected.size() == 64));
+		}
+
+		heap.Clear();
+		int top = -1;
+		assert(!heap.PeekTop(top) && top == -1 && !heap.PopTop());
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test that popping many heaps interleaved gives the same tops and
+	//!  leaves the same heaps as popping them one at a time
+	//!************************************************************************
+	void TestPopTopInterleaved()
+	{
+		const std::size_t numHeaps = 40;
+		const CHeap<int>::ISortOrderPtr sortOrder(new CStdLessSortOrder<int>());
+		std::vector< std::shared_ptr< CHeap<int> > > heaps;
+		std::vector< std::shared_ptr< CHeap<int> > > expectedHeaps;
+		std::vector< CHeap<int>* > heapPtrs;
+		unsigned int random = 4242;
+		for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+		{
+			heaps.push_back(std::shared_ptr< CHeap<int> >(new CHeap<int>(sortOrder)));
+			expectedHeaps.push_back(std::shared_ptr< CHeap<int> >(new CHeap<int>(sortOrder)));
+			heapPtrs.push_back(heaps.back().get());
+			// sizes from 20 to a few hundred, with duplicate values
+			for (std::size_t i = 0; i < 20 + heapIdx * 7; ++i)
+			{
+				random = random * 1103515245 + 12345;
+				const int value = static_cast<int>((random >> 16) % 500);
+				heaps.back()->Insert(value);
+				expectedHeaps.back()->Insert(value);
+			}
+		}
+
+		std::vector<int> tops;
+		for (int round = 0; round < 20; ++round)
+		{
+			PopTopInterleaved(&heapPtrs[0], numHeaps, tops);
+			assert(tops.size() == numHeaps);
+			for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+			{
+				assert(tops[heapIdx] == expectedHeaps[heapIdx]->PeekTop());
+				expectedHeaps[heapIdx]->PopTop();
+				assert(heaps[heapIdx]->GetSize() == expectedHeaps[heapIdx]->GetSize());
+			}
+		}
+		for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+		{
+			while (expectedHeaps[heapIdx]->GetSize() > 0)
+			{
+				assert(heaps[heapIdx]->PeekTop() == expectedHeaps[heapIdx]->PeekTop());
+				heaps[heapIdx]->PopTop();
+				expectedHeaps[heapIdx]->PopTop();
+			}
+		}
+
+		// a pop that empties a heap, then an empty heap changes nothing
+		heaps[0]->Insert(7);
+		heaps[1]->Insert(9);
+		PopTopInterleaved(&heapPtrs[0], 2, tops);
+		assert(tops.size() == 2 && tops[0] == 7 && tops[1] == 9 && heaps[0]->GetSize() == 0);
+		heaps[1]->Insert(3);
+		bool isThrown = false;
+		try
+		{
+			PopTopInterleaved(&heapPtrs[0], 2, tops);
+		}
+		catch (CHeap<int>::CCannotAccessEmptyHeap&)
+		{
+			isThrown = true;
+		}
+		assert(isThrown && heaps[1]->GetSize() == 1);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the queue server and client over a unix socket and over tcp:
+	//!  named queues, batches, pipelining and errors
+	//!************************************************************************
+	void TestPqueueServer()
+	{
+#ifdef __linux__
+		std::ostringstream address;
+		address << "unix:/tmp/pqueue_tests_" << getpid() << ".sock";
+		CPqueueServer server(address.str());
+		std::thread serverThread([&server]() { server.Run(); });
+		{
+			CPqueueClient client(address.str());
+			const std::uint32_t jobs = client.OpenQueue("jobs");
+			const std::uint32_t other = client.OpenQueue("other");
+			assert(jobs != other && client.OpenQueue("jobs") == jobs);
+
+			// largest priority first, ties first in first out
+			std::vector<CQueueItem> items(5);
+			const std::int64_t priorities[] = { 5, -3, 5, 9, 5 };
+			for (std::size_t i = 0; i < items.size(); ++i)
+			{
+				items[i].priority = priorities[i];
+				items[i].payload = std::string(1, static_cast<char>('a' + i));
+			}
+			assert(client.PushBatch(jobs, items) == 5);
+			assert(client.Push(other, 1, std::string("\0binary\xff", 8)) == 1);
+			std::vector<CQueueItem> popped;
+			assert(client.PopBatch(jobs, 4, popped) == 4);
+			assert(popped[0].payload == "d" && popped[0].priority == 9);
+			assert(popped[1].payload == "a" && popped[2].payload == "c" && popped[3].payload == "e");
+			assert(client.GetSize(jobs) == 1);
+
+			// a second connection sees the same queues
+			CPqueueClient otherClient(address.str());
+			assert(otherClient.OpenQueue("other") == other);
+			assert(otherClient.PopBatch(other, 10, popped) == 1 && popped[0].payload == std::string("\0binary\xff", 8));
+
+			// pipelined: every request sent before any response is read
+			for (std::int64_t i = 0; i < 100; ++i)
+			{
+				CQueueItem item = { i, "x" };
+				client.SendPush(other, &item, 1);
+			}
+			client.SendPop(other, 1000);
+			client.SendGetSize(other);
+			for (std::uint64_t i = 0; i < 100; ++i)
+			{
+				assert(client.ReceivePush() == i + 1);
+			}
+			assert(client.ReceivePop(popped) == 100 && popped[0].priority == 99 && popped[99].priority == 0);
+			assert(client.ReceiveGetSize() == 0);
+
+			bool isThrown = false;
+			try
+			{
+				client.GetSize(12345);
+			}
+			catch (CUnknownQueue&)
+			{
+				isThrown = true;
+			}
+			assert(isThrown && client.GetSize(jobs) == 1);
+
+			// a pop answers with as many items as fit in one frame
+			const std::uint32_t large = client.OpenQueue("large");
+			const std::string largePayload(MAX_FRAME_SIZE / 3, 'L');
+			for (std::int64_t i = 0; i < 4; ++i)
+			{
+				client.Push(large, i, largePayload);
+			}
+			assert(client.PopBatch(large, 10, popped) == 2 && popped[0].priority == 3 && popped[1].payload == largePayload);
+			assert(client.PopBatch(large, 10, popped) == 2 && popped[1].priority == 0 && client.GetSize(large) == 0);
+
+			// requests too large to send are rejected before anything is buffered
+			std::vector<CQueueItem> tooMany(3);
+			for (std::size_t i = 0; i < tooMany.size(); ++i)
+			{
+				tooMany[i].priority = 0;
+				tooMany[i].payload = largePayload;
+			}
+			int numThrown = 0;
+			try
+			{
+				client.PushBatch(large, tooMany);
+			}
+			catch (CProtocolError&)
+			{
+				++numThrown;
+			}
+			try
+			{
+				client.OpenQueue(std::string(0x10000, 'n'));
+			}
+			catch (CProtocolError&)
+			{
+				++numThrown;
+			}
+			assert(numThrown == 2 && client.GetSize(large) == 0);
+			assert(client.OpenQueue(std::string(0xFFFF, 'n')) != large);
+
+			// requests followed by EOF are all answered before the server
+			// closes, even when the answers take more than one write
+			client.Push(large, 1, largePayload);
+			client.Push(large, 2, largePayload);
+			CSocketAddress socketAddress;
+			assert(ParseSocketAddress(address.str(), socketAddress));
+			CFileDescriptor rawSocket(socket(socketAddress.storage.ss_family, SOCK_STREAM, 0));
+			assert(connect(rawSocket.Get(), reinterpret_cast<const sockaddr*>(&socketAddress.storage), socketAddress.length) == 0);
+			std::string requests;
+			{
+				CFrameWriter pop(requests);
+				pop.WriteU8(OP_POP);
+				pop.WriteU32(large);
+				pop.WriteU32(10);
+				pop.Finish();
+				CFrameWriter size(requests);
+				size.WriteU8(OP_SIZE);
+				size.WriteU32(large);
+				size.Finish();
+			}
+			assert(write(rawSocket.Get(), requests.data(), requests.size()) == static_cast<ssize_t>(requests.size()));
+			shutdown(rawSocket.Get(), SHUT_WR);
+			std::string responses;
+			char buffer[65536];
+			for (ssize_t numRead = 1; numRead > 0; )
+			{
+				numRead = read(rawSocket.Get(), buffer, sizeof(buffer));
+				responses.append(buffer, numRead > 0 ? static_cast<std::size_t>(numRead) : 0);
+			}
+			std::size_t popSize = 0;
+			std::size_t sizeSize = 0;
+			assert(CFrameReader::HasCompleteFrame(responses.data(), responses.size(), popSize));
+			const std::size_t sizeStart = FRAME_HEADER_SIZE + popSize;
+			assert(CFrameReader::HasCompleteFrame(responses.data() + sizeStart, responses.size() - sizeStart, sizeSize));
+			assert(responses.size() == sizeStart + FRAME_HEADER_SIZE + sizeSize);
+			CFrameReader popResponse(responses.data() + FRAME_HEADER_SIZE, popSize);
+			assert(popResponse.ReadU8() == STATUS_OK && popResponse.ReadU32() == 2);
+			CFrameReader sizeResponse(responses.data() + sizeStart + FRAME_HEADER_SIZE, sizeSize);
+			assert(sizeResponse.ReadU8() == STATUS_OK && sizeResponse.ReadU64() == 0);
+		}
+		server.Stop();
+		serverThread.join();
+
+		// tcp on any free port
+		CPqueueServer tcpServer("tcp:127.0.0.1:0");
+		assert(tcpServer.GetTcpPort() != 0);
+		std::thread tcpServerThread([&tcpServer]() { tcpServer.Run(); });
+		{
+			std::ostringstream tcpAddress;
+			tcpAddress << "tcp:127.0.0.1:" << tcpServer.GetTcpPort();
+			CPqueueClient client(tcpAddress.str());
+			const std::uint32_t queueId = client.OpenQueue("tcp");
+			assert(client.Push(queueId, 7, "seven") == 1);
+			std::vector<CQueueItem> popped;
+			assert(client.PopBatch(queueId, 1, popped) == 1 && popped[0].payload == "seven" && popped[0].priority == 7);
+		}
+		tcpServer.Stop();
+		tcpServerThread.join();
+
+		// a client that sends without reading stalls once its unsent
+		// responses pass the limit, then gets every answer as it reads
+		CPqueueServer limitedServer(address.str(), 4096);
+		std::thread limitedServerThread([&limitedServer]() { limitedServer.Run(); });
+		{
+			CPqueueClient client(address.str());
+			const std::uint32_t queueId = client.OpenQueue("limited");
+			CSocketAddress socketAddress;
+			assert(ParseSocketAddress(address.str(), socketAddress));
+			CFileDescriptor rawSocket(socket(socketAddress.storage.ss_family, SOCK_STREAM, 0));
+			assert(connect(rawSocket.Get(), reinterpret_cast<const sockaddr*>(&socketAddress.storage), socketAddress.length) == 0);
+			SetNonBlocking(rawSocket.Get());
+			std::string request;
+			{
+				CFrameWriter size(request);
+				size.WriteU8(OP_SIZE);
+				size.WriteU32(queueId);
+				size.Finish();
+			}
+			// without the limit the server would read all of these; wait a
+			// moment at each stall so it can catch up if it is going to
+			std::size_t numSent = 0;
+			int numStalls = 0;
+			while (numStalls < 10 && numSent < 1000000)
+			{
+				if (write(rawSocket.Get(), request.data(), request.size()) == static_cast<ssize_t>(request.size()))
+				{
+					++numSent;
+					numStalls = 0;
+				}
+				else
+				{
+					++numStalls;
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+			}
+			assert(numStalls == 10);
+			const std::size_t responseSize = FRAME_HEADER_SIZE + 1 + 8;
+			std::size_t numReceived = 0;
+			char buffer[65536];
+			while (numReceived < numSent * responseSize)
+			{
+				const ssize_t numRead = read(rawSocket.Get(), buffer, sizeof(buffer));
+				if (numRead > 0)
+				{
+					numReceived += static_cast<std::size_t>(numRead);
+				}
+				else
+				{
+					assert(numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+			assert(numReceived == numSent * responseSize && client.GetSize(queueId) == 0);
+		}
+		limitedServer.Stop();
+		limitedServerThread.join();
+
+		CSocketAddress parsed;
+		assert(!ParseSocketAddress("tcp:127.0.0.1", parsed) && !ParseSocketAddress("tcp:localhost:80", parsed) &&
+			!ParseSocketAddress("udp:1.2.3.4:5", parsed) && ParseSocketAddress("unix:/tmp/x", parsed));
+#endif
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the shared queue from two mappings in this process, from a
+	//!  child process, and after a child is killed in the middle of its
+	//!  pushes and pops
+	//!************************************************************************
+	void TestSharedPqueue()
+	{
+#ifdef __linux__
+		typedef CSharedPqueue<int, 100> Shared_t;
+		std::ostringstream name;
+		name << "/pqueue_tests_" << getpid();
+		Shared_t created(name.str(), SHARED_CREATE);
+
+		int numThrown = 0;
+		try
+		{
+			Shared_t duplicate(name.str(), SHARED_CREATE);
+		}
+		catch (CSharedMemoryError&)
+		{
+			++numThrown;
+		}
+		try
+		{
+			CSharedPqueue<int, 50> otherCapacity(name.str(), SHARED_OPEN);
+		}
+		catch (CSharedMemoryError&)
+		{
+			++numThrown;
+		}
+		try
+		{
+			Shared_t missing(name.str() + "_missing", SHARED_OPEN);
+		}
+		catch (CSharedMemoryError&)
+		{
+			++numThrown;
+		}
+		assert(numThrown == 3);
+
+		// a second mapping, at another address, sees the same queue
+		Shared_t opened(name.str(), SHARED_OPEN);
+		assert(created.TryPush(5) && opened.TryPush(9) && opened.TryPush(1));
+		int top = 0;
+		assert(created.TryPop(top) && top == 9 && opened.GetSize() == 2);
+
+		std::vector<int> values(200);
+		std::iota(values.begin(), values.end(), 0);
+		assert(created.PushBatch(&values[0], values.size()) == 98 && !opened.TryPush(0));
+		std::vector<int> popped(200);
+		assert(opened.PopBatch(&popped[0], popped.size()) == 100);
+		assert(std::is_sorted(popped.begin(), popped.begin() + 100, std::greater<int>()) && popped[0] == 97);
+		assert(!created.TryPop(top) && top == 9);
+
+		// another process
+		pid_t child = fork();
+		if (child == 0)
+		{
+			Shared_t childQueue(name.str(), SHARED_OPEN);
+			for (int i = 0; i < 50; ++i)
+			{
+				childQueue.TryPush(i);
+			}
+			_exit(0);
+		}
+		int status = 0;
+		assert(child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+		assert(created.GetSize() == 50 && created.TryPop(top) && top == 49);
+
+		// a process killed at any point, perhaps holding the lock, leaves a
+		// usable heap
+		child = fork();
+		if (child == 0)
+		{
+			Shared_t childQueue(name.str(), SHARED_OPEN);
+			int childTop = 0;
+			for (int i = 0; ; ++i)
+			{
+				childQueue.TryPush(i % 1000);
+				if (i % 3 == 0)
+				{
+					childQueue.TryPop(childTop);
+				}
+			}
+		}
+		// the child pushes more than it pops, so it fills the queue, however
+		// slowly it gets scheduled
+		const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+		while (created.GetSize() < Shared_t::GetCapacity() && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		const bool wasFilled = created.GetSize() == Shared_t::GetCapacity();
+		assert(child > 0 && kill(child, SIGKILL) == 0 && waitpid(child, &status, 0) == child);
+		assert(wasFilled && created.TryPop(top) && created.TryPush(5000));
+		const std::size_t numLeft = opened.PopBatch(&popped[0], popped.size());
+		assert(numLeft >= 1 && numLeft <= 100 && popped[0] == 5000);
+		assert(std::is_sorted(popped.begin(), popped.begin() + numLeft, std::greater<int>()));
+		assert(opened.GetSize() == 0);
+#endif
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the eviction cache with each policy, and against a brute force
+	//!  LFU model for the indexed heap's bookkeeping
+	//!************************************************************************
+	void TestEvictionCache()
+	{
+		typedef CEvictionCache<std::string, int> Cache_t;
+
+		// LFU, least recently used of equals first
+		Cache_t lfu(3, Cache_t::IEvictionPolicyPtr(new CLfuEvictionPolicy()));
+		lfu.Put("a", 1);
+		lfu.Put("b", 2);
+		lfu.Put("c", 3);
+		assert(lfu.Get("a") != NULL && lfu.Get("a") != NULL && *lfu.Get("b") == 2);
+		assert(*lfu.PeekVictim() == "c");
+		lfu.Put("d", 4);
+		assert(lfu.Get("c") == NULL && lfu.GetSize() == 3 && lfu.GetNumEvictions() == 1);
+		lfu.Put("a", 10);
+		assert(*lfu.Get("a") == 10 && lfu.GetSize() == 3 && *lfu.PeekVictim() == "d");
+		assert(lfu.Erase("d") && !lfu.Erase("d") && lfu.GetSize() == 2 && *lfu.PeekVictim() == "b");
+
+		// GreedyDual, cheap entries first, inflation ages out the rest
+		Cache_t greedyDual(2, Cache_t::IEvictionPolicyPtr(new CGreedyDualEvictionPolicy()));
+		greedyDual.Put("x", 0, 10.0);
+		greedyDual.Put("y", 0, 1.0);
+		greedyDual.Put("z", 0, 5.0);
+		assert(greedyDual.Get("y") == NULL && *greedyDual.PeekVictim() == "z");
+		greedyDual.Put("w", 0, 1.0);
+		assert(greedyDual.Get("z") == NULL && greedyDual.Get("x") != NULL);
+		greedyDual.Put("v", 0, 1.0);
+		assert(greedyDual.Get("w") == NULL && greedyDual.Get("x") != NULL && greedyDual.GetNumEvictions() == 3);
+
+		// TTL weighted, soonest expiry first, expired entries are misses
+		Cache_t ttl(3, Cache_t::IEvictionPolicyPtr(new CTtlWeightedEvictionPolicy()), 100);
+		ttl.Put("a", 1, 1.0, 100);
+		ttl.Put("b", 2, 1.0, 10);
+		ttl.Put("c", 3);
+		assert(*ttl.PeekVictim() == "b");
+		ttl.AdvanceTime(109);
+		assert(ttl.Get("b") != NULL);
+		ttl.AdvanceTime(110);
+		assert(ttl.Get("b") == NULL && ttl.GetSize() == 2 && ttl.GetNumEvictions() == 0);
+		ttl.Put("d", 4, 1.0, 50);
+		ttl.Put("e", 5, 1.0, 5);
+		assert(ttl.Get("d") == NULL && *ttl.PeekVictim() == "e" && *ttl.Get("c") == 3);
+
+		// random puts, gets and erases checked against brute force LFU
+		CEvictionCache<int, int> cache(16, CEvictionCache<int, int>::IEvictionPolicyPtr(new CLfuEvictionPolicy()));
+		std::map< int, std::pair<std::uint64_t, std::uint64_t> > model;		// key -> hits, last use
+		std::uint64_t sequence = 0;
+		unsigned int random = 4949;
+		for (int op = 0; op < 20000; ++op)
+		{
+			random = random * 1103515245 + 12345;
+			const int key = static_cast<int>((random >> 16) % 48);
+			const unsigned int action = (random >> 8) % 10;
+			if (action < 4)
+			{
+				if (model.count(key) == 0 && model.size() == 16)
+				{
+					std::map< int, std::pair<std::uint64_t, std::uint64_t> >::iterator victim = model.begin();
+					for (std::map< int, std::pair<std::uint64_t, std::uint64_t> >::iterator entry = model.begin(); entry != model.end(); ++entry)
+					{
+						victim = entry->second < victim->second ? entry : victim;
+					}
+					model.erase(victim);
+				}
+				cache.Put(key, op);
+				model[key] = std::make_pair(0, sequence++);
+			}
+			else if (action < 9)
+			{
+				const int* value = cache.Get(key);
+				assert((value != NULL) == (model.count(key) != 0));
+				if (value != NULL)
+				{
+					model[key] = std::make_pair(model[key].first + 1, sequence++);
+				}
+			}
+			else
+			{
+				assert(cache.Erase(key) == (model.erase(key) != 0));
+			}
+			assert(cache.GetSize() == model.size());
+			if (!model.empty())
+			{
+				std::map< int, std::pair<std::uint64_t, std::uint64_t> >::const_iterator victim = model.begin();
+				for (std::map< int, std::pair<std::uint64_t, std::uint64_t> >::const_iterator entry = model.begin(); entry != model.end(); ++entry)
+				{
+					victim = entry->second < victim->second ? entry : victim;
+				}
+				assert(*cache.PeekVictim() == victim->first);
+			}
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Check the WF2Q+ bound: while flows stay backlogged, the normalized
+	//!  service of any two differs by at most one largest cost per weight
+	//!************************************************************************
+	bool IsWithinFairnessBound(const std::vector<double>& servedCost, const std::vector<double>& weights, double maxCost)
+	{
+		for (std::size_t i = 0; i < servedCost.size(); ++i)
+		{
+			for (std::size_t j = 0; j < servedCost.size(); ++j)
+			{
+				if (servedCost[i] / weights[i] - servedCost[j] / weights[j] > maxCost / weights[i] + maxCost / weights[j] + 1e-9)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Test the weighted fair queueing scheduler: fairness bounds with
+	//!  weights and costs, order within a flow, no credit for idle flows,
+	//!  weight changes and a flooding tenant
+	//!************************************************************************
+	void TestWfqScheduler()
+	{
+		typedef CWfqScheduler<int> Scheduler_t;
+		CHeap<int>::ISortOrderPtr sortOrder(new CStdLessSortOrder<int>());
+
+		// weights 1, 2 and 4, all backlogged throughout
+		Scheduler_t weighted;
+		std::vector<double> weights;
+		weights.push_back(1.0);
+		weights.push_back(2.0);
+		weights.push_back(4.0);
+		for (std::size_t flow = 0; flow < weights.size(); ++flow)
+		{
+			assert(weighted.AddFlow(weights[flow], sortOrder) == flow);
+			for (int i = 0; i < 700; ++i)
+			{
+				weighted.Push(static_cast<Scheduler_t::FlowId_t>(flow), i);
+			}
+		}
+		std::vector<double> servedCost(weights.size(), 0.0);
+		std::vector<int> lastItem(weights.size(), 700);
+		for (int i = 0; i < 700; ++i)
+		{
+			int item = 0;
+			const Scheduler_t::FlowId_t flow = weighted.PopFront(item);
+			// largest first within a flow
+			assert(item < lastItem[flow]);
+			lastItem[flow] = item;
+			servedCost[flow] += 1.0;
+			assert(IsWithinFairnessBound(servedCost, weights, 1.0));
+		}
+		assert(servedCost[0] >= 99 && servedCost[0] <= 101 && servedCost[2] >= 399 && servedCost[2] <= 401);
+		assert(weighted.GetSize() == 1400 && weighted.GetFlowSize(2) == 300);
+
+		// equal weights, costs 4 and 1: fair in cost, not in items
+		Scheduler_t costed;
+		const Scheduler_t::FlowId_t heavy = costed.AddFlow(1.0, sortOrder);
+		const Scheduler_t::FlowId_t light = costed.AddFlow(1.0, sortOrder);
+		for (int i = 0; i < 1000; ++i)
+		{
+			costed.Push(heavy, i, 4.0);
+			costed.Push(light, i, 1.0);
+		}
+		std::vector<double> costedServed(2, 0.0);
+		const std::vector<double> equalWeights(2, 1.0);
+		for (int i = 0; i < 500; ++i)
+		{
+			int item = 0;
+			const Scheduler_t::FlowId_t flow = costed.PopFront(item);
+			costedServed[flow] += flow == heavy ? 4.0 : 1.0;
+			assert(IsWithinFairnessBound(costedServed, equalWeights, 4.0));
+		}
+		assert(costedServed[light] > 3 * costedServed[heavy] / 4.0);
+
+		// a flow idle while another is served gets no credit for it
+		Scheduler_t idle;
+		const Scheduler_t::FlowId_t busy = idle.AddFlow(1.0, sortOrder);
+		const Scheduler_t::FlowId_t late = idle.AddFlow(1.0, sortOrder);
+		for (int i = 0; i < 2000; ++i)
+		{
+			idle.Push(busy, i);
+		}
+		int item = 0;
+		for (int i = 0; i < 1000; ++i)
+		{
+			assert(idle.PopFront(item) == busy);
+		}
+		for (int i = 0; i < 1000; ++i)
+		{
+			idle.Push(late, i);
+		}
+		int numLate = 0;
+		for (int i = 0; i < 200; ++i)
+		{
+			numLate += idle.PopFront(item) == late ? 1 : 0;
+		}
+		assert(numLate >= 99 && numLate <= 101);
+
+		// weights change at runtime
+		idle.SetWeight(late, 3.0);
+		assert(idle.GetWeight(late) == 3.0);
+		numLate = 0;
+		for (int i = 0; i < 400; ++i)
+		{
+			numLate += idle.PopFront(item) == late ? 1 : 0;
+		}
+		assert(numLate >= 297 && numLate <= 303);
+
+		// one tenant floods, the other tenants' single items still go soon
+		Scheduler_t tenants;
+		const Scheduler_t::FlowId_t flooder = tenants.AddFlow(1.0, sortOrder);
+		for (int i = 0; i < 10000; ++i)
+		{
+			tenants.Push(flooder, i);
+		}
+		for (int tenant = 1; tenant < 100; ++tenant)
+		{
+			tenants.Push(tenants.AddFlow(1.0, sortOrder), tenant);
+		}
+		int numOthers = 0;
+		for (int i = 0; i < 100; ++i)
+		{
+			numOthers += tenants.PopFront(item) != flooder ? 1 : 0;
+		}
+		assert(numOthers == 99 && tenants.GetSize() == 9999);
+
+		// errors
+		int numThrown = 0;
+		Scheduler_t empty;
+		try
+		{
+			empty.PopFront(item);
+		}
+		catch (Scheduler_t::CCannotAccessEmptyScheduler&)
+		{
+			++numThrown;
+		}
+		try
+		{
+			empty.Push(0, 1);
+		}
+		catch (Scheduler_t::CUnknownFlow&)
+		{
+			++numThrown;
+		}
+		try
+		{
+			empty.AddFlow(0.0, sortOrder);
+		}
+		catch (Scheduler_t::CInvalidWeight&)
+		{
+			++numThrown;
+		}
+		assert(numThrown == 3 && empty.GetNumFlows() == 0);
+	}
 }
\ No newline at end of file
@@ -8,7 +8,9 @@
 #include "targetver.h"
 
 #include <stdio.h>
+#ifdef _WIN32
 #include <tchar.h>
+#endif
 
 
 
@@ -0,0 +1,186 @@
+//********************************************************************
+//  FILE NAME:      BenchUtils.h
+//
+//  DESCRIPTION:    Timing and reporting helpers shared by the
+//					pqueue benchmarks. Every reported result is also
+//					kept so the run can be saved as JSON.
+//*********************************************************************
+#ifndef BENCH_UTILS_20261018_H
+#define BENCH_UTILS_20261018_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace pqueue
+{
+	//! Wall clock stopwatch, starts running when constructed
+	class CBenchTimer
+	{
+	private:
+		typedef std::chrono::steady_clock Clock_t;
+		Clock_t::time_point m_start;	//!< when the timer was (re)started
+	public:
+		CBenchTimer() : m_start(Clock_t::now()) {}
+
+		//! Start timing again from now
+		void Restart()
+		{
+			m_start = Clock_t::now();
+		}
+
+		//! Seconds since construction or the last Restart
+		double GetElapsedSeconds() const
+		{
+			return std::chrono::duration<double>(Clock_t::now() - m_start).count();
+		}
+	};
+
+	//! One reported measurement
+	struct CBenchResult
+	{
+		std::string suite;		//!< suite running when it was reported
+		std::string name;		//!< what was measured
+		std::size_t numOps;		//!< operations timed
+		double nsPerOp;			//!< mean time per operation, 0 for latency results
+		double p50Ns;			//!< median latency, 0 for throughput results
+		double p99Ns;			//!< 99th percentile latency, 0 for throughput results
+	};
+
+	//! Every result reported so far in this run
+	inline std::vector<CBenchResult>& GetBenchResults()
+	{
+		static std::vector<CBenchResult> results;
+		return results;
+	}
+
+	//! Name of the suite results are being reported for
+	inline std::string& GetCurrentBenchSuite()
+	{
+		static std::string suite;
+		return suite;
+	}
+
+	//! Keep a result for WriteBenchResultsJson
+	inline void RecordBenchResult(const char* name, std::size_t numOps, double nsPerOp, double p50Ns, double p99Ns)
+	{
+		CBenchResult result;
+		result.suite = GetCurrentBenchSuite();
+		result.name = name;
+		result.numOps = numOps;
+		result.nsPerOp = nsPerOp;
+		result.p50Ns = p50Ns;
+		result.p99Ns = p99Ns;
+		GetBenchResults().push_back(result);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Print one benchmark result line
+	//!
+	//! @param[in] name
+	//!   what was measured
+	//! @param[in] numOps
+	//!   number of operations timed
+	//! @param[in] seconds
+	//!   total time taken by numOps operations
+	//!************************************************************************
+	inline void ReportBenchResult(const char* name, std::size_t numOps, double seconds)
+	{
+		const double nsPerOp = numOps > 0 ? (seconds * 1e9) / numOps : 0.0;
+		printf("%-48s %12lu ops %10.2f ns/op\n", name, static_cast<unsigned long>(numOps), nsPerOp);
+		RecordBenchResult(name, numOps, nsPerOp, 0.0, 0.0);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Print the median and 99th percentile of a set of latencies
+	//!
+	//! @param[in] name
+	//!   what was measured
+	//! @param[in,out] latenciesNs
+	//!   one latency per operation in nanoseconds, sorted by this function
+	//!************************************************************************
+	inline void ReportLatencyPercentiles(const char* name, std::vector<double>& latenciesNs)
+	{
+		if (latenciesNs.empty())
+		{
+			return;
+		}
+		std::sort(latenciesNs.begin(), latenciesNs.end());
+		const double p50 = latenciesNs[latenciesNs.size() / 2];
+		const double p99 = latenciesNs[latenciesNs.size() * 99 / 100];
+		printf("%-48s %12lu ops p50 %10.0f ns p99 %10.0f ns\n", name, static_cast<unsigned long>(latenciesNs.size()), p50, p99);
+		RecordBenchResult(name, latenciesNs.size(), 0.0, p50, p99);
+	}
+
+	//! Write text as a JSON string literal
+	inline void WriteJsonString(FILE* file, const std::string& text)
+	{
+		fputc('"', file);
+		for (std::string::const_iterator currChar = text.begin(); currChar != text.end(); ++currChar)
+		{
+			const unsigned char byte = static_cast<unsigned char>(*currChar);
+			if (byte == '"' || byte == '\\')
+			{
+				fprintf(file, "\\%c", byte);
+			}
+			else if (byte < 0x20)
+			{
+				fprintf(file, "\\u%04x", byte);
+			}
+			else
+			{
+				fputc(byte, file);
+			}
+		}
+		fputc('"', file);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Save every result reported so far as a JSON document for tracking
+	//!  regressions between runs
+	//!
+	//! @param[in] path
+	//!   file to write, replaced if it exists
+	//!
+	//! @return bool
+	//!   false if the file could not be written
+	//!************************************************************************
+	inline bool WriteBenchResultsJson(const char* path)
+	{
+		FILE* file = fopen(path, "w");
+		if (file == NULL)
+		{
+			return false;
+		}
+		const std::vector<CBenchResult>& results = GetBenchResults();
+		fprintf(file, "{\n  \"benchmarks\": [");
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			fprintf(file, i == 0 ? "\n    {\"suite\": " : ",\n    {\"suite\": ");
+			WriteJsonString(file, results[i].suite);
+			fprintf(file, ", \"name\": ");
+			WriteJsonString(file, results[i].name);
+			fprintf(file, ", \"ops\": %lu, \"ns_per_op\": %.3f, \"p50_ns\": %.0f, \"p99_ns\": %.0f}",
+				static_cast<unsigned long>(results[i].numOps), results[i].nsPerOp, results[i].p50Ns, results[i].p99Ns);
+		}
+		fprintf(file, "\n  ]\n}\n");
+		return fclose(file) == 0;
+	}
+
+	//! Keeps the optimizer from discarding a benchmarked (arithmetic) result
+	template <class T>
+	void DoNotOptimize(const T& value)
+	{
+		static volatile T sink;
+		sink = value;
+		(void)sink;
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,306 @@
+//********************************************************************
+//  FILE NAME:      HeapOpsBench.cpp
+//
+//  DESCRIPTION:    Benchmarks of the basic heap and priority queue
+//					operations across element types, sizes and input
+//					orders
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+#include "Heap.h"
+#include "HeapUtils.h"
+#include "Pqueue.h"
+#include "BasicHeapSortOrders.h"
+#include "PqueueTestStructs.h"
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace pqueue
+{
+	namespace
+	{
+		//! Order of the input fed to the heaps
+		enum EInputOrder
+		{
+			INPUT_RANDOM,			//!< uniformly random keys
+			INPUT_SORTED,			//!< increasing keys, each insert climbs to the top
+			INPUT_REVERSED,			//!< decreasing keys, each insert stays at the bottom
+			INPUT_DUPLICATES,		//!< random keys from only 8 distinct values
+			NUM_INPUT_ORDERS
+		};
+
+		const char* const INPUT_ORDER_NAMES[NUM_INPUT_ORDERS] = { "random", "sorted", "reversed", "duplicates" };
+
+		//! Each measurement is repeated this many times and the fastest is
+		//! reported, which keeps results comparable between runs
+		const std::size_t NUM_REPETITIONS = 3;
+
+		//! Keys in the requested order, the same every run
+		std::vector<std::uint32_t> MakeKeys(EInputOrder inputOrder, std::size_t count)
+		{
+			std::mt19937 rng(20261018);
+			std::vector<std::uint32_t> keys;
+			keys.reserve(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				switch (inputOrder)
+				{
+				case INPUT_SORTED:
+					keys.push_back(static_cast<std::uint32_t>(i));
+					break;
+				case INPUT_REVERSED:
+					keys.push_back(static_cast<std::uint32_t>(count - i));
+					break;
+				case INPUT_DUPLICATES:
+					keys.push_back(static_cast<std::uint32_t>(rng() % 8));
+					break;
+				default:
+					keys.push_back(static_cast<std::uint32_t>(rng()));
+					break;
+				}
+			}
+			return keys;
+		}
+
+		//! Describes how one element type is built, named and sorted
+		template <class T>
+		struct CElementTraits;
+
+		template <>
+		struct CElementTraits<int>
+		{
+			static const char* GetName() { return "int"; }
+			static int MakeElement(std::uint32_t key) { return static_cast<int>(key >> 1); }
+			static CHeap<int>::ISortOrderPtr MakeSortOrder() { return CHeap<int>::ISortOrderPtr(new CStdLessSortOrder<int>()); }
+			static CHeap<int>::ISortOrderPtr MakeReversedSortOrder() { return CHeap<int>::ISortOrderPtr(new CStdGreaterSortOrder<int>()); }
+		};
+
+		template <>
+		struct CElementTraits<double>
+		{
+			static const char* GetName() { return "double"; }
+			static double MakeElement(std::uint32_t key) { return key * 0.25; }
+			static CHeap<double>::ISortOrderPtr MakeSortOrder() { return CHeap<double>::ISortOrderPtr(new CStdLessSortOrder<double>()); }
+			static CHeap<double>::ISortOrderPtr MakeReversedSortOrder() { return CHeap<double>::ISortOrderPtr(new CStdGreaterSortOrder<double>()); }
+		};
+
+		//! Records sorted by a CCompositeSortOrder on criteria A, B then C.
+		//! The key is spread over all three so ties on A are common.
+		template <>
+		struct CElementTraits<CTestStruct>
+		{
+			static const char* GetName() { return "record"; }
+			static CTestStruct MakeElement(std::uint32_t key)
+			{
+				const char* names[] = {"Tom", "Dick", "Harry", "Sally", "Thomas", "Richard", "Harold", "Sarah"};
+				return CTestStruct(key % 16, (key / 16 % 1000) / 10.0, names[key / 16000 % 8]);
+			}
+			static ISortOrderTestStructPtr MakeSortOrder()
+			{
+				std::vector<ISortOrderTestStructPtr> criteria;
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaA()));
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaB()));
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaC()));
+				return ISortOrderTestStructPtr(new CCompositeSortOrder<CTestStruct>(criteria));
+			}
+			static ISortOrderTestStructPtr MakeReversedSortOrder()
+			{
+				std::vector<ISortOrderTestStructPtr> criteria;
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaC()));
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaB()));
+				criteria.push_back(ISortOrderTestStructPtr(new CSortOnCriteriaA()));
+				return ISortOrderTestStructPtr(new CCompositeSortOrder<CTestStruct>(criteria));
+			}
+		};
+
+		//! "<op> <type> <order> n=<size>", the name results are reported under
+		template <class T>
+		std::string MakeResultName(const char* op, EInputOrder inputOrder, std::size_t size)
+		{
+			char name[128];
+			sprintf(name, "%s %s %s n=%lu", op, CElementTraits<T>::GetName(), INPUT_ORDER_NAMES[inputOrder], static_cast<unsigned long>(size));
+			return name;
+		}
+
+		//! Fill heap with every element, untimed
+		template <class T>
+		void FillHeap(CHeap<T>& heap, const std::vector<T>& elements)
+		{
+			for (std::size_t i = 0; i < elements.size(); ++i)
+			{
+				heap.Insert(elements[i]);
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time Insert, PeekTop, PopTop, Reheapify and ChangeSortOrder on one
+		//!  element type, input order and size, plus sort order comparisons
+		//!************************************************************************
+		template <class T>
+		void BenchHeapOpsOn(EInputOrder inputOrder, std::size_t size)
+		{
+			typedef typename CHeap<T>::ISortOrderPtr ISortOrderPtr;
+			const ISortOrderPtr sortOrder = CElementTraits<T>::MakeSortOrder();
+			const ISortOrderPtr reversedSortOrder = CElementTraits<T>::MakeReversedSortOrder();
+			const std::vector<std::uint32_t> keys = MakeKeys(inputOrder, size);
+			std::vector<T> elements;
+			elements.reserve(size);
+			for (std::size_t i = 0; i < keys.size(); ++i)
+			{
+				elements.push_back(CElementTraits<T>::MakeElement(keys[i]));
+			}
+
+			double insertSeconds = 0.0;
+			double peekSeconds = 0.0;
+			double popSeconds = 0.0;
+			double reheapifySeconds = 0.0;
+			double changeSortOrderSeconds = 0.0;
+			double compareSeconds = 0.0;
+			std::size_t checksum = 0;
+			for (std::size_t rep = 0; rep < NUM_REPETITIONS; ++rep)
+			{
+				CHeap<T> heap(sortOrder);
+				CBenchTimer timer;
+				FillHeap(heap, elements);
+				double seconds = timer.GetElapsedSeconds();
+				insertSeconds = rep == 0 || seconds < insertSeconds ? seconds : insertSeconds;
+
+				timer.Restart();
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					checksum += &heap.PeekTop() != NULL ? 1 : 0;
+				}
+				seconds = timer.GetElapsedSeconds();
+				peekSeconds = rep == 0 || seconds < peekSeconds ? seconds : peekSeconds;
+
+				timer.Restart();
+				while (heap.GetSize() > 0)
+				{
+					heap.PopTop();
+				}
+				seconds = timer.GetElapsedSeconds();
+				popSeconds = rep == 0 || seconds < popSeconds ? seconds : popSeconds;
+
+				CHeap<T> source(sortOrder);
+				CHeap<T> reheaped(reversedSortOrder);
+				FillHeap(source, elements);
+				timer.Restart();
+				Reheapify(reheaped, source);
+				seconds = timer.GetElapsedSeconds();
+				reheapifySeconds = rep == 0 || seconds < reheapifySeconds ? seconds : reheapifySeconds;
+
+				CPqueue<T> queue(sortOrder);
+				for (std::size_t i = 0; i < elements.size(); ++i)
+				{
+					queue.Push(elements[i]);
+				}
+				timer.Restart();
+				queue.ChangeSortOrder(reversedSortOrder);
+				seconds = timer.GetElapsedSeconds();
+				changeSortOrderSeconds = rep == 0 || seconds < changeSortOrderSeconds ? seconds : changeSortOrderSeconds;
+
+				timer.Restart();
+				for (std::size_t i = 1; i < size; ++i)
+				{
+					checksum += sortOrder->LessThan(elements[i - 1], elements[i]) ? 1 : 0;
+				}
+				seconds = timer.GetElapsedSeconds();
+				compareSeconds = rep == 0 || seconds < compareSeconds ? seconds : compareSeconds;
+			}
+			DoNotOptimize(checksum);
+
+			ReportBenchResult(MakeResultName<T>("Insert", inputOrder, size).c_str(), size, insertSeconds);
+			ReportBenchResult(MakeResultName<T>("PeekTop", inputOrder, size).c_str(), size, peekSeconds);
+			ReportBenchResult(MakeResultName<T>("PopTop", inputOrder, size).c_str(), size, popSeconds);
+			ReportBenchResult(MakeResultName<T>("Reheapify", inputOrder, size).c_str(), size, reheapifySeconds);
+			ReportBenchResult(MakeResultName<T>("ChangeSortOrder", inputOrder, size).c_str(), size, changeSortOrderSeconds);
+			ReportBenchResult(MakeResultName<T>("LessThan", inputOrder, size).c_str(), size - 1, compareSeconds);
+		}
+
+		//! Run BenchHeapOpsOn for every input order and size
+		template <class T>
+		void BenchHeapOpsFor(const std::vector<std::size_t>& sizes)
+		{
+			for (std::size_t sizeIdx = 0; sizeIdx < sizes.size(); ++sizeIdx)
+			{
+				for (int inputOrder = 0; inputOrder < NUM_INPUT_ORDERS; ++inputOrder)
+				{
+					BenchHeapOpsOn<T>(static_cast<EInputOrder>(inputOrder), sizes[sizeIdx]);
+				}
+			}
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Time every basic heap operation on ints, doubles and records sorted
+	//!  by a CCompositeSortOrder, for each input order and a range of sizes
+	//!************************************************************************
+	void BenchHeapOperations()
+	{
+		std::vector<std::size_t> sizes;
+		sizes.push_back(100);
+		sizes.push_back(1000);
+		sizes.push_back(10000);
+		BenchHeapOpsFor<int>(sizes);
+		BenchHeapOpsFor<double>(sizes);
+		BenchHeapOpsFor<CTestStruct>(sizes);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Measure what a heap costs before any work is done: its size, and
+	//!  the time to create, use and destroy many small heaps and queues
+	//!************************************************************************
+	void BenchHeapFootprint()
+	{
+		printf("sizeof CHeap<int> %lu bytes, sizeof CPqueue<int> %lu bytes\n",
+			static_cast<unsigned long>(sizeof(CHeap<int>)), static_cast<unsigned long>(sizeof(CPqueue<int>)));
+
+		const std::size_t numHeaps = 100000;
+		const std::size_t itemsPerHeap = 4;
+		const CHeap<int>::ISortOrderPtr sortOrder = CElementTraits<int>::MakeSortOrder();
+		double heapSeconds = 0.0;
+		double queueSeconds = 0.0;
+		std::size_t checksum = 0;
+		for (std::size_t rep = 0; rep < NUM_REPETITIONS; ++rep)
+		{
+			CBenchTimer timer;
+			for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+			{
+				CHeap<int> heap(sortOrder);
+				for (std::size_t i = 0; i < itemsPerHeap; ++i)
+				{
+					heap.Insert(static_cast<int>(heapIdx + i));
+				}
+				checksum += heap.PeekTop();
+				heap.PopTop();
+			}
+			double seconds = timer.GetElapsedSeconds();
+			heapSeconds = rep == 0 || seconds < heapSeconds ? seconds : heapSeconds;
+
+			timer.Restart();
+			for (std::size_t queueIdx = 0; queueIdx < numHeaps; ++queueIdx)
+			{
+				CPqueue<int> queue(sortOrder);
+				for (std::size_t i = 0; i < itemsPerHeap; ++i)
+				{
+					queue.Push(static_cast<int>(queueIdx + i));
+				}
+				checksum += queue.PeekFront();
+				queue.PopFront();
+			}
+			seconds = timer.GetElapsedSeconds();
+			queueSeconds = rep == 0 || seconds < queueSeconds ? seconds : queueSeconds;
+		}
+		DoNotOptimize(checksum);
+		ReportBenchResult("Small CHeap lifetime (4 inserts, 1 pop)", numHeaps, heapSeconds);
+		ReportBenchResult("Small CPqueue lifetime (4 pushes, 1 pop)", numHeaps, queueSeconds);
+	}
+}
@@ -0,0 +1,83 @@
+//********************************************************************
+//  FILE NAME:      PqueueBench.h
+//
+//  DESCRIPTION:    Contains benchmarks for the major pqueue classes
+//
+//*********************************************************************
+#ifndef PQUEUE_BENCH_20261018_H
+#define PQUEUE_BENCH_20261018_H
+
+namespace pqueue
+{
+	//! Time the basic heap and priority queue operations across element
+	//! types, sizes and input orders
+	void BenchHeapOperations();
+
+	//! Measure the size of a heap and the cost of many short lived heaps
+	void BenchHeapFootprint();
+
+	//! Compare the cost of the runtime, flattened and compile-time
+	//! composite sort orders
+	void BenchCompositeSort();
+
+	//! Compare heaps sifting on normalized sort keys with plain heaps
+	void BenchNormalizedSortKey();
+
+	//! Compare the radix heap with CHeap on a shortest path workload
+	void BenchRadixHeap();
+
+	//! Compare the timer wheel with CHeap on a mostly cancelled timer workload
+	void BenchTimerWheel();
+
+	//! Compare the min-max heap with two mirrored heaps on a bounded queue
+	void BenchMinMaxHeap();
+
+	//! Compare CHeap::Merge with popping and re-inserting shard heaps
+	void BenchHeapMerge();
+
+	//! Compare draining many heaps serially and with several threads
+	void BenchParallelHeapDrain();
+
+	//! Measure producer/consumer latency through the blocking queue
+	void BenchBlockingPqueue();
+
+	//! Compare PeekTopK with rebuilding a heap and popping
+	void BenchTopK();
+
+	//! Compare first in, first out heaps with a composite sort order
+	void BenchStableHeap();
+
+	//! Compare aging by sort order change with CAgingPqueue
+	void BenchAgingPqueue();
+
+	//! Compare CSmallHeap with CHeap for tiny heaps, time and allocations
+	void BenchSmallHeap();
+
+	//! Compare CStaticHeap with CHeap, throughput and latency
+	void BenchStaticHeap();
+
+	//! Compare popping many heaps one at a time and interleaved
+	void BenchInterleavedPop();
+
+	//! Load CPqueueServer through its client, does nothing off Linux
+	void BenchPqueueServer();
+
+	//! Time CSharedPqueue within and across processes, does nothing off Linux
+	void BenchSharedPqueue();
+
+	//! Replay a Zipfian key trace against CEvictionCache policies
+	void BenchEvictionCache();
+
+	//! Schedule thousands of weighted flows with CWfqScheduler
+	void BenchWfqScheduler();
+
+	//! Replay a synthetic recorded workload against each queue
+	void BenchTraceReplay();
+
+	//! Replay a recorded trace file against each queue, false if it can't be read
+	bool BenchTraceFile(const char* path);
+
+}
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+//********************************************************************
+//  FILE NAME:      ServerBench.cpp
+//
+//  DESCRIPTION:    Load generator for CPqueueServer. Starts a server
+//					in this process and drives it through CPqueueClient
+//					over a unix socket and tcp loopback, one request at
+//					a time, pipelined, batched and from several clients
+//					at once. Linux only.
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+
+#ifdef __linux__
+#include "PqueueServer.h"
+#include "PqueueClient.h"
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pqueue
+{
+	namespace
+	{
+		//! Items pushed and popped by each measurement
+		const std::size_t NUM_SERVER_ITEMS = 100000;
+
+		//! Bytes of payload per item
+		const std::size_t SERVER_PAYLOAD_SIZE = 32;
+
+		//! Connections driving the server at once in the concurrent measurement
+		const std::size_t NUM_SERVER_CLIENTS = 4;
+
+		std::int64_t GetServerBenchNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		//! Random priorities, the same for every measurement
+		std::vector<CQueueItem> MakeServerItems()
+		{
+			std::mt19937_64 random(47);
+			std::vector<CQueueItem> items(NUM_SERVER_ITEMS);
+			for (std::size_t i = 0; i < items.size(); ++i)
+			{
+				items[i].priority = static_cast<std::int64_t>(random() % 1000000);
+				items[i].payload.assign(SERVER_PAYLOAD_SIZE, static_cast<char>('a' + i % 26));
+			}
+			return items;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Push then pop each item with a round trip per request. Reports
+		//!  the throughput and the latency of each push and pop pair.
+		//!************************************************************************
+		void BenchServerRoundTrips(const char* name, const std::string& address, const std::vector<CQueueItem>& items)
+		{
+			CPqueueClient client(address);
+			const std::uint32_t queueId = client.OpenQueue(name);
+			std::vector<CQueueItem> popped;
+			std::vector<double> latenciesNs;
+			latenciesNs.reserve(items.size());
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < items.size(); ++i)
+			{
+				const std::int64_t start = GetServerBenchNs();
+				client.Push(queueId, items[i].priority, items[i].payload);
+				client.PopBatch(queueId, 1, popped);
+				latenciesNs.push_back(static_cast<double>(GetServerBenchNs() - start));
+			}
+			ReportBenchResult(name, 2 * items.size(), timer.GetElapsedSeconds());
+			ReportLatencyPercentiles(name, latenciesNs);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Push every item, then pop them all, keeping depth requests in
+		//!  flight. Returns the time taken.
+		//!************************************************************************
+		double RunPipelined(CPqueueClient& client, std::uint32_t queueId, const std::vector<CQueueItem>& items, std::size_t depth)
+		{
+			std::vector<CQueueItem> popped;
+			CBenchTimer timer;
+			for (std::size_t start = 0; start < items.size(); start += depth)
+			{
+				const std::size_t end = start + depth < items.size() ? start + depth : items.size();
+				for (std::size_t i = start; i < end; ++i)
+				{
+					client.SendPush(queueId, &items[i], 1);
+				}
+				for (std::size_t i = start; i < end; ++i)
+				{
+					client.ReceivePush();
+				}
+			}
+			for (std::size_t start = 0; start < items.size(); start += depth)
+			{
+				const std::size_t end = start + depth < items.size() ? start + depth : items.size();
+				for (std::size_t i = start; i < end; ++i)
+				{
+					client.SendPop(queueId, 1);
+				}
+				for (std::size_t i = start; i < end; ++i)
+				{
+					client.ReceivePop(popped);
+				}
+			}
+			return timer.GetElapsedSeconds();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Push every item, then pop them all, batchSize items per request.
+		//!  Reports the throughput and the latency of each batch.
+		//!************************************************************************
+		void BenchServerBatches(const char* name, const std::string& address, const std::vector<CQueueItem>& items, std::size_t batchSize)
+		{
+			CPqueueClient client(address);
+			const std::uint32_t queueId = client.OpenQueue(name);
+			std::vector<CQueueItem> batch;
+			std::vector<CQueueItem> popped;
+			std::vector<double> latenciesNs;
+			CBenchTimer timer;
+			for (std::size_t start = 0; start < items.size(); start += batchSize)
+			{
+				const std::size_t end = start + batchSize < items.size() ? start + batchSize : items.size();
+				batch.assign(items.begin() + start, items.begin() + end);
+				const std::int64_t batchStart = GetServerBenchNs();
+				client.PushBatch(queueId, batch);
+				latenciesNs.push_back(static_cast<double>(GetServerBenchNs() - batchStart));
+			}
+			for (std::size_t start = 0; start < items.size(); start += batchSize)
+			{
+				const std::int64_t batchStart = GetServerBenchNs();
+				client.PopBatch(queueId, static_cast<std::uint32_t>(batchSize), popped);
+				latenciesNs.push_back(static_cast<double>(GetServerBenchNs() - batchStart));
+			}
+			ReportBenchResult(name, 2 * items.size(), timer.GetElapsedSeconds());
+			ReportLatencyPercentiles(name, latenciesNs);
+		}
+
+		//! Pipelined pushes and pops from NUM_SERVER_CLIENTS connections at
+		//! once, each on its own queue
+		void BenchServerConcurrentClients(const char* name, const std::string& address, const std::vector<CQueueItem>& items)
+		{
+			std::vector<std::thread> threads;
+			CBenchTimer timer;
+			for (std::size_t clientIdx = 0; clientIdx < NUM_SERVER_CLIENTS; ++clientIdx)
+			{
+				threads.push_back(std::thread([clientIdx, &address, &items]()
+				{
+					CPqueueClient client(address);
+					std::ostringstream queueName;
+					queueName << "concurrent" << clientIdx;
+					RunPipelined(client, client.OpenQueue(queueName.str()), items, 32);
+				}));
+			}
+			for (std::size_t i = 0; i < threads.size(); ++i)
+			{
+				threads[i].join();
+			}
+			ReportBenchResult(name, 2 * items.size() * NUM_SERVER_CLIENTS, timer.GetElapsedSeconds());
+		}
+	}
+
+	void BenchPqueueServer()
+	{
+		const std::vector<CQueueItem> items = MakeServerItems();
+		std::ostringstream unixAddress;
+		unixAddress << "unix:/tmp/pqueuebench_" << getpid() << ".sock";
+		CPqueueServer unixServer(unixAddress.str());
+		CPqueueServer tcpServer("tcp:127.0.0.1:0");
+		std::ostringstream tcpAddress;
+		tcpAddress << "tcp:127.0.0.1:" << tcpServer.GetTcpPort();
+		std::thread unixServerThread([&unixServer]() { unixServer.Run(); });
+		std::thread tcpServerThread([&tcpServer]() { tcpServer.Run(); });
+
+		BenchServerRoundTrips("server unix push+pop round trips", unixAddress.str(), items);
+		BenchServerRoundTrips("server tcp push+pop round trips", tcpAddress.str(), items);
+		{
+			CPqueueClient client(unixAddress.str());
+			const std::uint32_t queueId = client.OpenQueue("pipelined");
+			ReportBenchResult("server unix pipelined depth 1", 2 * items.size(), RunPipelined(client, queueId, items, 1));
+			ReportBenchResult("server unix pipelined depth 32", 2 * items.size(), RunPipelined(client, queueId, items, 32));
+		}
+		BenchServerBatches("server unix batches of 64", unixAddress.str(), items, 64);
+		BenchServerConcurrentClients("server unix 4 clients pipelined depth 32", unixAddress.str(), items);
+
+		unixServer.Stop();
+		tcpServer.Stop();
+		unixServerThread.join();
+		tcpServerThread.join();
+	}
+}
+
+#else
+
+namespace pqueue
+{
+	void BenchPqueueServer()
+	{
+	}
+}
+
+#endif
@@ -0,0 +1,148 @@
+//********************************************************************
+//  FILE NAME:      SmallHeapBench.cpp
+//
+//  DESCRIPTION:    Compares CSmallHeap with CHeap for heaps of 1 to 64
+//					items, timing whole heap lifetimes and counting the
+//					allocations each one makes
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+#include "Heap.h"
+#include "SmallHeap.h"
+#include "BasicHeapSortOrders.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+	//! Allocations made through the global operator new by any thread
+	std::atomic<std::size_t> g_numAllocations(0);
+}
+
+// Count every allocation in the benchmark program; the counting costs a
+// relaxed atomic increment, which the other suites can afford
+void* operator new(std::size_t size)
+{
+	g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t /*size*/) noexcept
+{
+	std::free(memory);
+}
+
+namespace pqueue
+{
+	namespace
+	{
+		//! Number of heaps created per measurement
+		const std::size_t NUM_HEAPS = 20000;
+
+		//! CHeap sharing one sort order, as the per-request lists do today
+		class CHeapLifetime
+		{
+		public:
+			static const char* GetName() { return "CHeap"; }
+			CHeapLifetime() : m_heap(GetSortOrder()) {}
+			void Insert(int value) { m_heap.Insert(value); }
+			int PeekTop() const { return m_heap.PeekTop(); }
+			void PopTop() { m_heap.PopTop(); }
+		private:
+			CHeap<int> m_heap;
+
+			static const CHeap<int>::ISortOrderPtr& GetSortOrder()
+			{
+				static const CHeap<int>::ISortOrderPtr sortOrder(new CStdLessSortOrder<int>());
+				return sortOrder;
+			}
+		};
+
+		template <std::size_t N, bool isLinearScan>
+		class CSmallHeapLifetime
+		{
+		public:
+			static const char* GetName() { return isLinearScan ? "CSmallHeap linear" : "CSmallHeap binary"; }
+			void Insert(int value) { m_heap.Insert(value); }
+			int PeekTop() const { return m_heap.PeekTop(); }
+			void PopTop() { m_heap.PopTop(); }
+		private:
+			CSmallHeap<int, N, CStdLessSortOrder<int>, isLinearScan> m_heap;
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Create NUM_HEAPS heaps, fill each with size values and pop them
+		//!  all, reporting the time per heap and the allocations per heap
+		//!************************************************************************
+		template <class Lifetime>
+		void BenchSmallHeapLifetime(const char* storage, std::size_t size, const std::vector<int>& values)
+		{
+			std::size_t checksum = 0;
+			const std::size_t allocationsBefore = g_numAllocations.load();
+			CBenchTimer timer;
+			for (std::size_t heapIdx = 0; heapIdx < NUM_HEAPS; ++heapIdx)
+			{
+				Lifetime heap;
+				const int* heapValues = &values[(heapIdx * size) % (values.size() - size)];
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					heap.Insert(heapValues[i]);
+				}
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					checksum += heap.PeekTop();
+					heap.PopTop();
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			const std::size_t numAllocations = g_numAllocations.load() - allocationsBefore;
+			DoNotOptimize(checksum);
+
+			char name[128];
+			sprintf(name, "Lifetime of %lu items, %s%s", static_cast<unsigned long>(size), Lifetime::GetName(), storage);
+			ReportBenchResult(name, NUM_HEAPS, seconds);
+			printf("%-48s %12.2f allocations/heap\n", name, static_cast<double>(numAllocations) / NUM_HEAPS);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Time heap lifetimes of 1 to 64 items with CHeap and with CSmallHeaps
+	//!  of 8 and 16 inline items in both modes
+	//!************************************************************************
+	void BenchSmallHeap()
+	{
+		std::vector<int> values(4096);
+		std::mt19937 rng(20261018);
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = static_cast<int>(rng() % 100000);
+		}
+		const std::size_t sizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+		for (std::size_t sizeIdx = 0; sizeIdx < sizeof(sizes) / sizeof(sizes[0]); ++sizeIdx)
+		{
+			const std::size_t size = sizes[sizeIdx];
+			BenchSmallHeapLifetime<CHeapLifetime>("", size, values);
+			BenchSmallHeapLifetime< CSmallHeapLifetime<8, true> >(" 8", size, values);
+			BenchSmallHeapLifetime< CSmallHeapLifetime<8, false> >(" 8", size, values);
+			BenchSmallHeapLifetime< CSmallHeapLifetime<16, true> >(" 16", size, values);
+			BenchSmallHeapLifetime< CSmallHeapLifetime<16, false> >(" 16", size, values);
+		}
+	}
+}
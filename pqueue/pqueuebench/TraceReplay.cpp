@@ -0,0 +1,274 @@
+//********************************************************************
+//  FILE NAME:      TraceReplay.cpp
+//
+//  DESCRIPTION:    Replays recorded CPqueue traces against each queue
+//					implementation and reports throughput and latency
+//					percentiles
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+#include "Heap.h"
+#include "HeapUtils.h"
+#include "Pqueue.h"
+#include "PqueueTrace.h"
+#include "DoubleEndedPqueue.h"
+#include "BasicHeapSortOrders.h"
+#include <cstdint>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace pqueue
+{
+	namespace
+	{
+		typedef std::uint64_t TraceKey_t;
+		typedef CHeap<TraceKey_t>::ISortOrderPtr ISortOrderPtr;
+
+		//! Trace keys are the items themselves
+		class CTraceKeyEncoder : public ITraceKeyEncoder<TraceKey_t>
+		{
+		public:
+			TraceKey_t GetTraceKey(const TraceKey_t& item) const
+			{
+				return item;
+			}
+		};
+
+		//! The sort order a sort order change switches to. Changes alternate
+		//! between largest first and smallest first, like the recorded queue
+		//! is assumed to.
+		ISortOrderPtr GetReplaySortOrder(TraceKey_t changeKey)
+		{
+			static const ISortOrderPtr largestFirst(new CStdLessSortOrder<TraceKey_t>());
+			static const ISortOrderPtr smallestFirst(new CStdGreaterSortOrder<TraceKey_t>());
+			return changeKey % 2 == 0 ? largestFirst : smallestFirst;
+		}
+
+		//! CPqueue, re-sorting eagerly or lazily on a sort order change
+		template <bool isLazy>
+		class CPqueueEngine
+		{
+		public:
+			static const char* GetName() { return isLazy ? "CPqueue lazy" : "CPqueue"; }
+			CPqueueEngine() : m_queue(GetReplaySortOrder(0)) {}
+			void Push(TraceKey_t key) { m_queue.Push(key); }
+			TraceKey_t PeekFront() const { return m_queue.PeekFront(); }
+			void PopFront() { m_queue.PopFront(); }
+			std::size_t GetSize() const { return m_queue.GetSize(); }
+			void ChangeSortOrder(TraceKey_t changeKey)
+			{
+				if (isLazy)
+				{
+					m_queue.ChangeSortOrderLazily(GetReplaySortOrder(changeKey), 4);
+				}
+				else
+				{
+					m_queue.ChangeSortOrder(GetReplaySortOrder(changeKey));
+				}
+			}
+		private:
+			CPqueue<TraceKey_t> m_queue;
+		};
+
+		//! CDoubleEndedPqueue, which serves the front from its max end
+		class CDoubleEndedEngine
+		{
+		public:
+			static const char* GetName() { return "CDoubleEndedPqueue"; }
+			CDoubleEndedEngine() : m_queue(GetReplaySortOrder(0)) {}
+			void Push(TraceKey_t key) { m_queue.Push(key); }
+			TraceKey_t PeekFront() const { return m_queue.PeekFront(); }
+			void PopFront() { m_queue.PopFront(); }
+			std::size_t GetSize() const { return m_queue.GetSize(); }
+			void ChangeSortOrder(TraceKey_t changeKey) { m_queue.ChangeSortOrder(GetReplaySortOrder(changeKey)); }
+		private:
+			CDoubleEndedPqueue<TraceKey_t> m_queue;
+		};
+
+		//! A bare CHeap, moved into a new heap by Reheapify on a sort order
+		//! change
+		class CHeapEngine
+		{
+		public:
+			static const char* GetName() { return "CHeap"; }
+			CHeapEngine() : m_heap(new CHeap<TraceKey_t>(GetReplaySortOrder(0))) {}
+			void Push(TraceKey_t key) { m_heap->Insert(key); }
+			TraceKey_t PeekFront() const { return m_heap->PeekTop(); }
+			void PopFront() { m_heap->PopTop(); }
+			std::size_t GetSize() const { return m_heap->GetSize(); }
+			void ChangeSortOrder(TraceKey_t changeKey)
+			{
+				std::shared_ptr< CHeap<TraceKey_t> > newHeap(new CHeap<TraceKey_t>(GetReplaySortOrder(changeKey)));
+				Reheapify(*newHeap, *m_heap);
+				m_heap = newHeap;
+			}
+		private:
+			std::shared_ptr< CHeap<TraceKey_t> > m_heap;
+		};
+
+		//! Apply one traced operation. Pops and peeks on an empty queue are
+		//! skipped, the trace may have started with items already queued.
+		template <class Engine>
+		inline void ApplyTraceOp(Engine& engine, const CTraceOp& op, TraceKey_t& checksum)
+		{
+			switch (op.op)
+			{
+			case TRACE_PUSH:
+				engine.Push(op.key);
+				break;
+			case TRACE_POP_FRONT:
+				if (engine.GetSize() > 0)
+				{
+					engine.PopFront();
+				}
+				break;
+			case TRACE_PEEK_FRONT:
+				if (engine.GetSize() > 0)
+				{
+					checksum += engine.PeekFront();
+				}
+				break;
+			default:
+				engine.ChangeSortOrder(op.key);
+				break;
+			}
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Replay ops against a fresh Engine twice, once timing the whole
+		//!  trace for throughput and once timing every operation for latency
+		//!  percentiles per operation type
+		//!************************************************************************
+		template <class Engine>
+		void ReplayTraceOn(const char* traceName, const std::vector<CTraceOp>& ops)
+		{
+			TraceKey_t checksum = 0;
+			{
+				Engine engine;
+				CBenchTimer timer;
+				for (std::size_t i = 0; i < ops.size(); ++i)
+				{
+					ApplyTraceOp(engine, ops[i], checksum);
+				}
+				const double seconds = timer.GetElapsedSeconds();
+				const std::string name = std::string("Replay ") + traceName + " " + Engine::GetName();
+				ReportBenchResult(name.c_str(), ops.size(), seconds);
+			}
+
+			std::vector<double> latenciesNs[NUM_TRACE_OPS];
+			Engine engine;
+			for (std::size_t i = 0; i < ops.size(); ++i)
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				ApplyTraceOp(engine, ops[i], checksum);
+				const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				latenciesNs[ops[i].op].push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+			}
+			DoNotOptimize(checksum);
+
+			const char* const opNames[NUM_TRACE_OPS] = { "Push", "PopFront", "PeekFront", "ChangeSortOrder" };
+			for (int op = 0; op < NUM_TRACE_OPS; ++op)
+			{
+				const std::string name = std::string("Replay ") + traceName + " " + Engine::GetName() + " " + opNames[op];
+				ReportLatencyPercentiles(name.c_str(), latenciesNs[op]);
+			}
+		}
+
+		void ReplayTraceOnAll(const char* traceName, const std::vector<CTraceOp>& ops)
+		{
+			ReplayTraceOn< CPqueueEngine<false> >(traceName, ops);
+			ReplayTraceOn< CPqueueEngine<true> >(traceName, ops);
+			ReplayTraceOn<CDoubleEndedEngine>(traceName, ops);
+			ReplayTraceOn<CHeapEngine>(traceName, ops);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Record a synthetic workload from a CPqueue: bursts of pushes, each
+		//!  popped back down to a steady backlog with a peek before every pop,
+		//!  and an occasional sort order change
+		//!************************************************************************
+		void RecordSyntheticTrace(std::vector<CTraceOp>& ops)
+		{
+			std::stringstream trace(std::ios::in | std::ios::out | std::ios::binary);
+			std::shared_ptr< CPqueueTraceRecorder<TraceKey_t> > recorder(new CPqueueTraceRecorder<TraceKey_t>(trace,
+				CPqueueTraceRecorder<TraceKey_t>::ITraceKeyEncoderPtr(new CTraceKeyEncoder())));
+			CPqueue<TraceKey_t> queue(GetReplaySortOrder(0));
+			queue.SetTraceRecorder(recorder);
+
+			const std::size_t numBursts = 200;
+			const std::size_t backlog = 2000;
+			std::mt19937 rng(20261018);
+			TraceKey_t numChanges = 0;
+			for (std::size_t burst = 0; burst < numBursts; ++burst)
+			{
+				const std::size_t burstSize = 100 + rng() % 400;
+				for (std::size_t i = 0; i < burstSize; ++i)
+				{
+					queue.Push(rng() % 1000000);
+				}
+				while (queue.GetSize() > backlog)
+				{
+					queue.PeekFront();
+					queue.PopFront();
+				}
+				if (burst % 50 == 49)
+				{
+					queue.ChangeSortOrder(GetReplaySortOrder(++numChanges));
+				}
+			}
+			recorder->Flush();
+			CTraceWriter::ReadTrace(trace, ops);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Record a synthetic workload and replay it against every queue
+	//!************************************************************************
+	void BenchTraceReplay()
+	{
+		std::vector<CTraceOp> ops;
+		RecordSyntheticTrace(ops);
+		ReplayTraceOnAll("synthetic", ops);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Replay a recorded trace file against every queue. Sort order
+	//!  changes alternate between largest first and smallest first.
+	//!
+	//! @param[in] path
+	//!   trace written by a CPqueueTraceRecorder
+	//!
+	//! @return bool
+	//!   false if the file can't be opened or isn't a valid trace
+	//!************************************************************************
+	bool BenchTraceFile(const char* path)
+	{
+		std::ifstream traceFile(path, std::ios::in | std::ios::binary);
+		if (!traceFile)
+		{
+			return false;
+		}
+		std::vector<CTraceOp> ops;
+		try
+		{
+			CTraceWriter::ReadTrace(traceFile, ops);
+		}
+		catch (CTraceFormatError&)
+		{
+			return false;
+		}
+		ReplayTraceOnAll(path, ops);
+		return true;
+	}
+}
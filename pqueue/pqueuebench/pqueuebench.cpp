@@ -0,0 +1,1449 @@
+//********************************************************************
+//  FILE NAME:      pqueuebench.cpp
+//
+//  DESCRIPTION:    Contains benchmarks for the major pqueue classes
+//
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+#include "Heap.h"
+#include "BasicHeapSortOrders.h"
+#include "Pqueue.h"
+#include "StaticCompositeSortOrder.h"
+#include "PqueueTestStructs.h"
+#include "NormalizedSortKey.h"
+#include "RadixHeap.h"
+#include "TimerWheel.h"
+#include "DoubleEndedPqueue.h"
+#include "ParallelHeapDrain.h"
+#include "BlockingPqueue.h"
+#include "StableHeap.h"
+#include "AgingPqueue.h"
+#include "StaticHeap.h"
+#include "InterleavedHeapOps.h"
+#include "EvictionCache.h"
+#include "WfqScheduler.h"
+#ifdef __linux__
+#include "SharedPqueue.h"
+#include <sstream>
+#include <sched.h>
+#include <sys/wait.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace pqueue
+{
+	namespace
+	{
+		//! Composite sort the way CCompositeSortOrder used to work, asking
+		//! each criterion lhs < rhs and then rhs < lhs. Kept as the baseline.
+		class CTwoPassCompositeSortOrder : public ISortOrder<CTestStruct>
+		{
+		private:
+			std::vector< ISortOrderTestStructPtr > m_sortCriteria;
+		public:
+			CTwoPassCompositeSortOrder(const std::vector< ISortOrderTestStructPtr >& sorts) :
+			  m_sortCriteria(sorts)
+			{
+			}
+
+			bool LessThan(const CTestStruct& lhs, const CTestStruct& rhs) const
+			{
+				std::vector< ISortOrderTestStructPtr >::const_iterator currSort = m_sortCriteria.begin();
+				for (; currSort != m_sortCriteria.end(); ++currSort)
+				{
+					if ((*currSort)->LessThan(lhs, rhs))
+					{
+						return true;
+					}
+					else if ((*currSort)->LessThan(rhs, lhs))
+					{
+						return false;
+					}
+				}
+				return false;
+			}
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Build records with lots of ties on the leading criteria so the
+		//!  composite sorts have to look past the first criterion
+		//!
+		//! @param[in] count
+		//!   number of records to make
+		//!
+		//! @return std::vector<CTestStruct>
+		//!   the records, same every run
+		//!************************************************************************
+		std::vector<CTestStruct> MakeTestStructs(std::size_t count)
+		{
+			const char* names[] = {"Tom", "Dick", "Harry", "Sally", "Thomas", "Richard", "Harold", "Sarah"};
+			std::mt19937 rng(20261018);
+			std::vector<CTestStruct> testStructs;
+			testStructs.reserve(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				testStructs.push_back(CTestStruct(rng() % 16, (rng() % 1000) / 10.0, names[rng() % 8]));
+			}
+			return testStructs;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time LessThan on every neighboring pair of records
+		//!************************************************************************
+		template <class T>
+		void BenchComparisons(const char* name, const ISortOrder<T>& sortOrder,
+			const std::vector<T>& testStructs, std::size_t numPasses)
+		{
+			std::size_t numLess = 0;
+			CBenchTimer timer;
+			for (std::size_t pass = 0; pass < numPasses; ++pass)
+			{
+				for (std::size_t i = 1; i < testStructs.size(); ++i)
+				{
+					numLess += sortOrder.LessThan(testStructs[i - 1], testStructs[i]) ? 1 : 0;
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(numLess);
+			ReportBenchResult(name, numPasses * (testStructs.size() - 1), seconds);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time inserting every record into an empty heap and popping them
+		//!  all off
+		//!************************************************************************
+		template <class HeapT>
+		void TimeHeapSort(const char* name, HeapT& heap, const std::vector<CTestStruct>& testStructs)
+		{
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < testStructs.size(); ++i)
+			{
+				heap.Insert(testStructs[i]);
+			}
+			unsigned int checksum = 0;
+			while (heap.GetSize() > 0)
+			{
+				checksum += heap.PeekTop().criteriaA;
+				heap.PopTop();
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(checksum);
+			ReportBenchResult(name, testStructs.size(), seconds);
+		}
+
+		//! Heap sort the records into a CHeap with the given sort order
+		void BenchHeapSort(const char* name, const ISortOrderTestStructPtr& sortOrder,
+			const std::vector<CTestStruct>& testStructs)
+		{
+			CHeap<CTestStruct> heap(sortOrder);
+			TimeHeapSort(name, heap, testStructs);
+		}
+
+		//! Weighted directed graph as adjacency lists
+		struct CBenchGraph
+		{
+			std::vector< std::vector< std::pair<std::uint32_t, std::uint32_t> > > edges;	//!< (target, weight) per node
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Build a random graph where every node has edgesPerNode outgoing
+		//!  edges, one of them to the next node so everything is reachable
+		//!  from node 0
+		//!************************************************************************
+		CBenchGraph MakeBenchGraph(std::uint32_t numNodes, std::uint32_t edgesPerNode)
+		{
+			std::mt19937 rng(20261018);
+			CBenchGraph graph;
+			graph.edges.resize(numNodes);
+			for (std::uint32_t node = 0; node < numNodes; ++node)
+			{
+				graph.edges[node].push_back(std::make_pair((node + 1) % numNodes, static_cast<std::uint32_t>(rng() % 100000)));
+				for (std::uint32_t i = 1; i < edgesPerNode; ++i)
+				{
+					graph.edges[node].push_back(std::make_pair(static_cast<std::uint32_t>(rng() % numNodes), static_cast<std::uint32_t>(rng() % 100000)));
+				}
+			}
+			return graph;
+		}
+
+		//! Adapts a CHeap with the smallest pairs on top to the Push/PeekFront/
+		//! PopFront surface of CRadixHeap
+		class CPairHeapQueue
+		{
+		private:
+			typedef std::pair<std::uint64_t, std::uint32_t> Item_t;
+			CHeap<Item_t> m_heap;
+		public:
+			CPairHeapQueue() : m_heap(CHeap<Item_t>::ISortOrderPtr(new CStdGreaterSortOrder<Item_t>())) {}
+			void Push(std::uint64_t key, std::uint32_t value) { m_heap.Insert(Item_t(key, value)); }
+			const Item_t& PeekFront() const { return m_heap.PeekTop(); }
+			void PopFront() { m_heap.PopTop(); }
+			std::size_t GetSize() const { return m_heap.GetSize(); }
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Time Dijkstra's shortest paths from node 0 using QueueT as the
+		//!  frontier. Stale queue entries are skipped when popped.
+		//!************************************************************************
+		template <class QueueT>
+		void BenchDijkstra(const char* name, const CBenchGraph& graph)
+		{
+			const std::uint64_t unreached = ~static_cast<std::uint64_t>(0);
+			std::vector<std::uint64_t> distances(graph.edges.size(), unreached);
+			std::size_t numOps = 0;
+
+			CBenchTimer timer;
+			QueueT frontier;
+			distances[0] = 0;
+			frontier.Push(0, 0);
+			while (frontier.GetSize() > 0)
+			{
+				const std::uint64_t distance = frontier.PeekFront().first;
+				const std::uint32_t node = frontier.PeekFront().second;
+				frontier.PopFront();
+				++numOps;
+				if (distance > distances[node])
+				{
+					continue;
+				}
+				for (std::size_t i = 0; i < graph.edges[node].size(); ++i)
+				{
+					const std::uint32_t target = graph.edges[node][i].first;
+					const std::uint64_t targetDistance = distance + graph.edges[node][i].second;
+					if (targetDistance < distances[target])
+					{
+						distances[target] = targetDistance;
+						frontier.Push(targetDistance, target);
+						++numOps;
+					}
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+
+			std::uint64_t checksum = 0;
+			for (std::size_t i = 0; i < distances.size(); ++i)
+			{
+				checksum += distances[i];
+			}
+			DoNotOptimize(checksum);
+			ReportBenchResult(name, numOps, seconds);
+		}
+
+		//! Timers kept in a CHeap with the soonest deadline on top. Cancelled
+		//! timers are flagged and dropped when they reach the top.
+		class CHeapTimerQueue
+		{
+		private:
+			typedef std::pair<std::uint64_t, std::uint32_t> Item_t;
+			CHeap<Item_t> m_heap;
+			std::vector<bool> m_cancelled;
+		public:
+			CHeapTimerQueue() : m_heap(CHeap<Item_t>::ISortOrderPtr(new CStdGreaterSortOrder<Item_t>())) {}
+
+			std::uint64_t Schedule(std::uint64_t deadline, std::uint32_t value)
+			{
+				m_heap.Insert(Item_t(deadline, static_cast<std::uint32_t>(m_cancelled.size())));
+				m_cancelled.push_back(false);
+				return m_cancelled.size() - 1;
+			}
+
+			bool Cancel(std::uint64_t timerId)
+			{
+				m_cancelled[timerId] = true;
+				return true;
+			}
+
+			void PopExpired(std::uint64_t now, std::vector<std::uint32_t>& expired)
+			{
+				while (m_heap.GetSize() > 0 && m_heap.PeekTop().first <= now)
+				{
+					if (!m_cancelled[m_heap.PeekTop().second])
+					{
+						expired.push_back(m_heap.PeekTop().second);
+					}
+					m_heap.PopTop();
+				}
+			}
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Time a timeout workload: every tick schedules a few timers a
+		//!  random distance out and cancels most of the pending ones before
+		//!  they fire, then expires whatever is due
+		//!************************************************************************
+		template <class TimerQueueT>
+		void BenchTimers(const char* name, std::uint64_t numTicks, unsigned int timersPerTick, unsigned int cancelPercent)
+		{
+			std::mt19937 rng(20261018);
+			TimerQueueT timers;
+			std::vector<std::uint64_t> pending;
+			std::vector<std::uint32_t> expired;
+			std::size_t numOps = 0;
+			std::size_t numExpired = 0;
+
+			CBenchTimer timer;
+			for (std::uint64_t now = 0; now < numTicks; ++now)
+			{
+				for (unsigned int i = 0; i < timersPerTick; ++i)
+				{
+					const std::uint64_t timerId = timers.Schedule(now + 1 + rng() % 100000, i);
+					if (rng() % 100 < cancelPercent)
+					{
+						pending.push_back(timerId);
+					}
+					++numOps;
+				}
+				// cancel the timers picked for cancelling a little later
+				while (pending.size() > timersPerTick * 4)
+				{
+					timers.Cancel(pending.front());
+					pending.erase(pending.begin(), pending.begin() + 1);
+					++numOps;
+				}
+				timers.PopExpired(now, expired);
+				numExpired += expired.size();
+				expired.clear();
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(numExpired);
+			ReportBenchResult(name, numOps, seconds);
+		}
+
+		//! Double-ended queue kept as two mirrored CHeaps, one with the largest
+		//! item on top and one with the smallest. Items removed from one heap
+		//! are flagged and dropped from the other when they reach its top.
+		class CMirroredHeapsDeque
+		{
+		private:
+			typedef std::pair<std::uint32_t, std::uint32_t> Item_t;	//!< (value, serial number)
+			CHeap<Item_t> m_maxHeap;
+			CHeap<Item_t> m_minHeap;
+			std::vector<bool> m_removed;
+			std::size_t m_size;
+
+			void DropRemoved(CHeap<Item_t>& heap)
+			{
+				while (m_removed[heap.PeekTop().second])
+				{
+					heap.PopTop();
+				}
+			}
+
+			void Pop(CHeap<Item_t>& heap)
+			{
+				DropRemoved(heap);
+				m_removed[heap.PeekTop().second] = true;
+				heap.PopTop();
+				--m_size;
+			}
+		public:
+			CMirroredHeapsDeque() :
+			  m_maxHeap(CHeap<Item_t>::ISortOrderPtr(new CStdLessSortOrder<Item_t>())),
+			  m_minHeap(CHeap<Item_t>::ISortOrderPtr(new CStdGreaterSortOrder<Item_t>())),
+			  m_size(0)
+			{
+			}
+
+			void Push(std::uint32_t value)
+			{
+				const Item_t item(value, static_cast<std::uint32_t>(m_removed.size()));
+				m_removed.push_back(false);
+				m_maxHeap.Insert(item);
+				m_minHeap.Insert(item);
+				++m_size;
+			}
+
+			void PopFront() { Pop(m_maxHeap); }
+			void PopBack() { Pop(m_minHeap); }
+			std::size_t GetSize() const { return m_size; }
+		};
+
+		//! Adapts CDoubleEndedPqueue to the surface of CMirroredHeapsDeque
+		class CMinMaxHeapDeque
+		{
+		private:
+			CDoubleEndedPqueue<std::uint32_t> m_queue;
+		public:
+			CMinMaxHeapDeque() : m_queue(CDoubleEndedPqueue<std::uint32_t>::ISortOrderPtr(new CStdLessSortOrder<std::uint32_t>())) {}
+			void Push(std::uint32_t value) { m_queue.Push(value); }
+			void PopFront() { m_queue.PopFront(); }
+			void PopBack() { m_queue.PopBack(); }
+			std::size_t GetSize() const { return m_queue.GetSize(); }
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Time a bounded job queue: random jobs are pushed, the lowest
+		//!  priority job is evicted whenever the queue is over capacity, and
+		//!  every few pushes the highest priority job is served
+		//!************************************************************************
+		template <class DequeT>
+		void BenchBoundedQueue(const char* name, std::size_t numPushes, std::size_t capacity)
+		{
+			std::mt19937 rng(20261018);
+			DequeT jobs;
+			std::size_t numOps = 0;
+
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < numPushes; ++i)
+			{
+				jobs.Push(static_cast<std::uint32_t>(rng()));
+				++numOps;
+				if (jobs.GetSize() > capacity)
+				{
+					jobs.PopBack();
+					++numOps;
+				}
+				if (i % 4 == 0)
+				{
+					jobs.PopFront();
+					++numOps;
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(jobs.GetSize());
+			ReportBenchResult(name, numOps, seconds);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time consolidating numShards shard heaps of shardSize random items
+		//!  into one, either popping and re-inserting every item or with
+		//!  CHeap::Merge
+		//!************************************************************************
+		void BenchShardConsolidation(const char* name, std::size_t numShards, std::size_t shardSize, bool useMerge)
+		{
+			std::mt19937 rng(20261018);
+			const CHeap<std::uint32_t>::ISortOrderPtr sortOrder(new CStdLessSortOrder<std::uint32_t>());
+			std::vector< std::shared_ptr< CHeap<std::uint32_t> > > shards;
+			for (std::size_t i = 0; i < numShards; ++i)
+			{
+				shards.push_back(std::shared_ptr< CHeap<std::uint32_t> >(new CHeap<std::uint32_t>(sortOrder)));
+				for (std::size_t j = 0; j < shardSize; ++j)
+				{
+					shards.back()->Insert(static_cast<std::uint32_t>(rng()));
+				}
+			}
+
+			CBenchTimer timer;
+			CHeap<std::uint32_t> consolidated(sortOrder);
+			for (std::size_t i = 0; i < numShards; ++i)
+			{
+				if (useMerge)
+				{
+					consolidated.Merge(std::move(*shards[i]));
+				}
+				else
+				{
+					while (shards[i]->GetSize() > 0)
+					{
+						consolidated.Insert(shards[i]->PeekTop());
+						shards[i]->PopTop();
+					}
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(consolidated.PeekTop());
+			ReportBenchResult(name, numShards * shardSize, seconds);
+		}
+
+		//! Adds up drained items so the drain can't be optimized away
+		struct CChecksumConsumer
+		{
+			std::uint64_t checksum;
+			CChecksumConsumer() : checksum(0) {}
+			void operator()(const std::uint32_t& item) { checksum = checksum * 31 + item; }
+		};
+
+		//! numHeaps heaps of heapSize random items each
+		std::vector< std::shared_ptr< CHeap<std::uint32_t> > > MakeShardHeaps(const CHeap<std::uint32_t>::ISortOrderPtr& sortOrder, std::size_t numHeaps, std::size_t heapSize)
+		{
+			std::mt19937 rng(20261018);
+			std::vector< std::shared_ptr< CHeap<std::uint32_t> > > heaps;
+			for (std::size_t i = 0; i < numHeaps; ++i)
+			{
+				heaps.push_back(std::shared_ptr< CHeap<std::uint32_t> >(new CHeap<std::uint32_t>(sortOrder)));
+				for (std::size_t j = 0; j < heapSize; ++j)
+				{
+					heaps.back()->Insert(static_cast<std::uint32_t>(rng()));
+				}
+			}
+			return heaps;
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time draining the heaps into one ordered stream on one thread:
+		//!  a CHeap of (top item, heap) pairs picks the heap to PopTop next
+		//!************************************************************************
+		void BenchSerialDrain(const char* name, std::size_t numHeaps, std::size_t heapSize)
+		{
+			typedef std::pair<std::uint32_t, std::uint32_t> Top_t;
+			const CHeap<std::uint32_t>::ISortOrderPtr sortOrder(new CStdLessSortOrder<std::uint32_t>());
+			std::vector< std::shared_ptr< CHeap<std::uint32_t> > > heaps = MakeShardHeaps(sortOrder, numHeaps, heapSize);
+
+			CBenchTimer timer;
+			CChecksumConsumer consumer;
+			CHeap<Top_t> tops(CHeap<Top_t>::ISortOrderPtr(new CStdLessSortOrder<Top_t>()));
+			for (std::size_t i = 0; i < heaps.size(); ++i)
+			{
+				tops.Insert(Top_t(heaps[i]->PeekTop(), static_cast<std::uint32_t>(i)));
+			}
+			while (tops.GetSize() > 0)
+			{
+				const Top_t top = tops.PeekTop();
+				tops.PopTop();
+				consumer(top.first);
+				CHeap<std::uint32_t>& heap = *heaps[top.second];
+				heap.PopTop();
+				if (heap.GetSize() > 0)
+				{
+					tops.Insert(Top_t(heap.PeekTop(), top.second));
+				}
+			}
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(consumer.checksum);
+			ReportBenchResult(name, numHeaps * heapSize, seconds);
+		}
+
+		//! Time draining the heaps into one ordered stream with CParallelHeapDrainer,
+		//! and the merging time of its busiest thread, which the threads share
+		void BenchParallelDrain(const char* name, const char* mergeName, std::size_t numHeaps, std::size_t heapSize, std::size_t numThreads)
+		{
+			const CHeap<std::uint32_t>::ISortOrderPtr sortOrder(new CStdLessSortOrder<std::uint32_t>());
+			std::vector< std::shared_ptr< CHeap<std::uint32_t> > > heaps = MakeShardHeaps(sortOrder, numHeaps, heapSize);
+			std::vector< CHeap<std::uint32_t>* > heapPtrs;
+			for (std::size_t i = 0; i < heaps.size(); ++i)
+			{
+				heapPtrs.push_back(heaps[i].get());
+			}
+
+			CBenchTimer timer;
+			CChecksumConsumer consumer;
+			CParallelHeapDrainer<std::uint32_t> drainer(sortOrder, numThreads);
+			drainer.Drain(heapPtrs, consumer);
+			const double seconds = timer.GetElapsedSeconds();
+			DoNotOptimize(consumer.checksum);
+			ReportBenchResult(name, numHeaps * heapSize, seconds);
+			ReportBenchResult(mergeName, numHeaps * heapSize, drainer.GetLastMergeSeconds());
+		}
+
+		typedef std::pair<std::uint32_t, std::int64_t> TimedJob_t;	//!< (priority, nanoseconds when queued)
+
+		//! Nanoseconds on the steady clock, for stamping queued jobs
+		std::int64_t GetSteadyNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Report the throughput and the latency percentiles of replacing the
+		//!  top of a full heap, one insert then one pop per value
+		//!
+		//! @param[in] insertPop
+		//!   called as insertPop(value), inserts value and pops the top
+		//!************************************************************************
+		template <class InsertPop>
+		void BenchSteadyStateLatency(const char* name, InsertPop insertPop, const std::vector<std::uint32_t>& values)
+		{
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				insertPop(values[i]);
+			}
+			ReportBenchResult(name, values.size(), timer.GetElapsedSeconds());
+
+			std::vector<double> latenciesNs;
+			latenciesNs.reserve(values.size());
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				const std::int64_t start = GetSteadyNs();
+				insertPop(values[i]);
+				latenciesNs.push_back(static_cast<double>(GetSteadyNs() - start));
+			}
+			ReportLatencyPercentiles(name, latenciesNs);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Pop numRounds tops from each of numHeaps heaps of heapSize random
+		//!  keys, one heap after another with PopTop and all together with
+		//!  PopTopInterleaved
+		//!************************************************************************
+		void BenchInterleavedPopOn(std::size_t numHeaps, std::size_t heapSize, std::size_t numRounds)
+		{
+			const CHeap<std::uint64_t>::ISortOrderPtr sortOrder(new CStdLessSortOrder<std::uint64_t>());
+			std::vector< std::shared_ptr< CHeap<std::uint64_t> > > heaps;
+			std::vector< CHeap<std::uint64_t>* > heapPtrs;
+			std::mt19937_64 rng(20261018);
+			for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+			{
+				std::vector<std::uint64_t> keys(heapSize);
+				for (std::size_t i = 0; i < heapSize; ++i)
+				{
+					keys[i] = rng();
+				}
+				heaps.push_back(std::shared_ptr< CHeap<std::uint64_t> >(new CHeap<std::uint64_t>(sortOrder)));
+				heaps.back()->Merge(std::move(keys));
+				heapPtrs.push_back(heaps.back().get());
+			}
+
+			std::uint64_t checksum = 0;
+			CBenchTimer timer;
+			for (std::size_t round = 0; round < numRounds; ++round)
+			{
+				for (std::size_t heapIdx = 0; heapIdx < numHeaps; ++heapIdx)
+				{
+					checksum += heapPtrs[heapIdx]->PeekTop();
+					heapPtrs[heapIdx]->PopTop();
+				}
+			}
+			const double sequentialSeconds = timer.GetElapsedSeconds();
+
+			std::vector<std::uint64_t> tops;
+			timer.Restart();
+			for (std::size_t round = 0; round < numRounds; ++round)
+			{
+				PopTopInterleaved(&heapPtrs[0], numHeaps, tops);
+				checksum += tops[0];
+			}
+			const double interleavedSeconds = timer.GetElapsedSeconds();
+			DoNotOptimize(checksum);
+
+			const unsigned long megabytes = static_cast<unsigned long>(numHeaps * heapSize * sizeof(std::uint64_t) >> 20);
+			char name[128];
+			sprintf(name, "Pop %lu heaps of %lu (%lu MB), sequential", static_cast<unsigned long>(numHeaps), static_cast<unsigned long>(heapSize), megabytes);
+			ReportBenchResult(name, numHeaps * numRounds, sequentialSeconds);
+			sprintf(name, "Pop %lu heaps of %lu (%lu MB), interleaved", static_cast<unsigned long>(numHeaps), static_cast<unsigned long>(heapSize), megabytes);
+			ReportBenchResult(name, numHeaps * numRounds, interleavedSeconds);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Measure how long jobs wait between Push and being popped with
+		//!  producers and a consumer on separate threads. The consumer pops
+		//!  one job at a time, or up to batchSize under one lock.
+		//!************************************************************************
+		void BenchBlockingLatency(const char* name, std::size_t numProducers, std::size_t jobsPerProducer, std::size_t capacity, std::size_t batchSize)
+		{
+			CBlockingPqueue<TimedJob_t> queue(CBlockingPqueue<TimedJob_t>::ISortOrderPtr(new CStdLessSortOrder<TimedJob_t>()), capacity);
+			std::vector<double> latenciesNs;
+			latenciesNs.reserve(numProducers * jobsPerProducer);
+
+			std::thread consumer([&queue, &latenciesNs, batchSize]() {
+				std::vector<TimedJob_t> jobs;
+				while (queue.PopBatch(jobs, batchSize) > 0)
+				{
+					const std::int64_t now = GetSteadyNs();
+					for (std::size_t i = 0; i < jobs.size(); ++i)
+					{
+						latenciesNs.push_back(static_cast<double>(now - jobs[i].second));
+					}
+				}
+			});
+			std::vector<std::thread> producers;
+			for (std::size_t producer = 0; producer < numProducers; ++producer)
+			{
+				producers.push_back(std::thread([&queue, producer, jobsPerProducer]() {
+					std::mt19937 rng(static_cast<std::uint32_t>(20261018 + producer));
+					for (std::size_t i = 0; i < jobsPerProducer; ++i)
+					{
+						queue.Push(TimedJob_t(static_cast<std::uint32_t>(rng() % 1000), GetSteadyNs()));
+					}
+				}));
+			}
+			for (std::size_t i = 0; i < producers.size(); ++i)
+			{
+				producers[i].join();
+			}
+			queue.Close();
+			consumer.join();
+			ReportLatencyPercentiles(name, latenciesNs);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Read the k best of a heap of random keys repeatedly, by rebuilding
+		//!  a scratch heap from its items and popping k of them (the only way
+		//!  before PeekTopK) and with PeekTopK
+		//!************************************************************************
+		void BenchTopKOn(std::size_t heapSize, std::size_t k, std::size_t numReads)
+		{
+			const CHeap<std::uint32_t>::ISortOrderPtr sortOrder(new CStdLessSortOrder<std::uint32_t>());
+			CHeap<std::uint32_t> heap(sortOrder);
+			std::mt19937 rng(20261018);
+			for (std::size_t i = 0; i < heapSize; ++i)
+			{
+				heap.Insert(static_cast<std::uint32_t>(rng()));
+			}
+
+			std::uint64_t checksum = 0;
+			std::vector<std::uint32_t> topK;
+			CBenchTimer timer;
+			for (std::size_t read = 0; read < numReads; ++read)
+			{
+				std::vector<std::uint32_t> items;
+				items.reserve(heap.GetSize());
+				heap.ForEach([&items](const std::uint32_t& item) { items.push_back(item); });
+				CHeap<std::uint32_t> scratch(sortOrder);
+				scratch.Merge(std::move(items));
+				topK.clear();
+				while (topK.size() < k && scratch.GetSize() > 0)
+				{
+					topK.push_back(scratch.PeekTop());
+					scratch.PopTop();
+				}
+				checksum += topK.back();
+			}
+			const double copySeconds = timer.GetElapsedSeconds();
+
+			timer.Restart();
+			for (std::size_t read = 0; read < numReads; ++read)
+			{
+				heap.PeekTopK(k, topK);
+				checksum += topK.back();
+			}
+			const double peekSeconds = timer.GetElapsedSeconds();
+			DoNotOptimize(checksum);
+
+			char name[128];
+			sprintf(name, "Top %lu of %lu, rebuild and pop", static_cast<unsigned long>(k), static_cast<unsigned long>(heapSize));
+			ReportBenchResult(name, numReads, copySeconds);
+			sprintf(name, "Top %lu of %lu, PeekTopK", static_cast<unsigned long>(k), static_cast<unsigned long>(heapSize));
+			ReportBenchResult(name, numReads, peekSeconds);
+		}
+
+		//! A job stamped with a sequence number by hand, the way FIFO ties were
+		//! broken before CStableHeap
+		struct CStampedJob
+		{
+			int priority;
+			std::uint64_t sequence;
+			int id;
+		};
+
+		class CStampedJobPrioritySortOrder : public ISortOrder<CStampedJob>
+		{
+		public:
+			bool LessThan(const CStampedJob& lhs, const CStampedJob& rhs) const
+			{
+				return lhs.priority < rhs.priority;
+			}
+		};
+
+		//! Earlier stamps are "larger"
+		class CStampedJobSequenceSortOrder : public ISortOrder<CStampedJob>
+		{
+		public:
+			bool LessThan(const CStampedJob& lhs, const CStampedJob& rhs) const
+			{
+				return rhs.sequence < lhs.sequence;
+			}
+		};
+
+		class CJobPrioritySortOrder : public ISortOrder< std::pair<int, int> >
+		{
+		public:
+			bool LessThan(const std::pair<int, int>& lhs, const std::pair<int, int>& rhs) const
+			{
+				return lhs.first < rhs.first;
+			}
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Push jobs with few distinct priorities then pop them all, first in,
+		//!  first out within a priority, with a composite sort order over a
+		//!  hand made stamp, with CStableHeap and with CPackedStableHeap
+		//!************************************************************************
+		void BenchStableHeapOn(std::size_t numJobs, int numPriorities)
+		{
+			std::vector<int> priorities(numJobs);
+			std::mt19937 rng(20261018);
+			for (std::size_t i = 0; i < numJobs; ++i)
+			{
+				priorities[i] = static_cast<int>(rng() % numPriorities);
+			}
+			std::uint64_t checksum = 0;
+			char name[128];
+
+			std::vector< CHeap<CStampedJob>::ISortOrderPtr > criteria;
+			criteria.push_back(CHeap<CStampedJob>::ISortOrderPtr(new CStampedJobPrioritySortOrder()));
+			criteria.push_back(CHeap<CStampedJob>::ISortOrderPtr(new CStampedJobSequenceSortOrder()));
+			CHeap<CStampedJob> compositeHeap(CHeap<CStampedJob>::ISortOrderPtr(new CCompositeSortOrder<CStampedJob>(criteria)));
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < numJobs; ++i)
+			{
+				const CStampedJob job = { priorities[i], i, static_cast<int>(i) };
+				compositeHeap.Insert(job);
+			}
+			while (compositeHeap.GetSize() > 0)
+			{
+				checksum += compositeHeap.PeekTop().id;
+				compositeHeap.PopTop();
+			}
+			sprintf(name, "Stable push and pop %lu, %d priorities, composite sort", static_cast<unsigned long>(numJobs), numPriorities);
+			ReportBenchResult(name, numJobs, timer.GetElapsedSeconds());
+
+			CStableHeap< std::pair<int, int> > stableHeap(CStableHeap< std::pair<int, int> >::ISortOrderPtr(new CJobPrioritySortOrder()));
+			timer.Restart();
+			for (std::size_t i = 0; i < numJobs; ++i)
+			{
+				stableHeap.Insert(std::pair<int, int>(priorities[i], static_cast<int>(i)));
+			}
+			while (stableHeap.GetSize() > 0)
+			{
+				checksum += stableHeap.PeekTop().second;
+				stableHeap.PopTop();
+			}
+			sprintf(name, "Stable push and pop %lu, %d priorities, CStableHeap", static_cast<unsigned long>(numJobs), numPriorities);
+			ReportBenchResult(name, numJobs, timer.GetElapsedSeconds());
+
+			CPackedStableHeap<int, int> packedHeap;
+			timer.Restart();
+			for (std::size_t i = 0; i < numJobs; ++i)
+			{
+				packedHeap.Push(priorities[i], static_cast<int>(i));
+			}
+			while (packedHeap.GetSize() > 0)
+			{
+				checksum += packedHeap.PeekTop();
+				packedHeap.PopTop();
+			}
+			sprintf(name, "Stable push and pop %lu, %d priorities, CPackedStableHeap", static_cast<unsigned long>(numJobs), numPriorities);
+			ReportBenchResult(name, numJobs, timer.GetElapsedSeconds());
+			DoNotOptimize(checksum);
+		}
+
+		//! A waiting job as a scheduler that ages by sort order change keeps it
+		struct CWaitingJob
+		{
+			double priority;
+			std::uint64_t pushTime;
+			std::uint64_t id;
+		};
+
+		//! Ranks jobs by priority plus aging up to a fixed time, replaced with
+		//! a new one each time the scheduler ages its queue
+		class CWaitingJobSortOrder : public ISortOrder<CWaitingJob>
+		{
+		private:
+			double m_agingRate;
+			std::uint64_t m_now;
+		public:
+			CWaitingJobSortOrder(double agingRate, std::uint64_t now) : m_agingRate(agingRate), m_now(now) {}
+
+			bool LessThan(const CWaitingJob& lhs, const CWaitingJob& rhs) const
+			{
+				return lhs.priority + m_agingRate * static_cast<double>(m_now - lhs.pushTime) <
+					rhs.priority + m_agingRate * static_cast<double>(m_now - rhs.pushTime);
+			}
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Run a scheduler with backlog waiting jobs for numTicks ticks, each
+		//!  tick aging the queue then pushing and popping jobsPerTick jobs:
+		//!  with CPqueue::ChangeSortOrder and with CAgingPqueue
+		//!************************************************************************
+		void BenchAgingOn(std::size_t backlog, std::size_t jobsPerTick, std::uint64_t numTicks)
+		{
+			const double agingRate = 0.25;
+			std::mt19937 rng(20261018);
+			std::vector<double> priorities(backlog + jobsPerTick * numTicks);
+			for (std::size_t i = 0; i < priorities.size(); ++i)
+			{
+				priorities[i] = static_cast<double>(rng() % 1000);
+			}
+			std::uint64_t checksum = 0;
+			const std::size_t numOps = jobsPerTick * numTicks;
+			char name[128];
+
+			CPqueue<CWaitingJob> sortOrderQueue(CHeap<CWaitingJob>::ISortOrderPtr(new CWaitingJobSortOrder(agingRate, 0)));
+			std::size_t nextJob = 0;
+			for (; nextJob < backlog; ++nextJob)
+			{
+				const CWaitingJob job = { priorities[nextJob], 0, nextJob };
+				sortOrderQueue.Push(job);
+			}
+			CBenchTimer timer;
+			for (std::uint64_t now = 1; now <= numTicks; ++now)
+			{
+				sortOrderQueue.ChangeSortOrder(CHeap<CWaitingJob>::ISortOrderPtr(new CWaitingJobSortOrder(agingRate, now)));
+				for (std::size_t i = 0; i < jobsPerTick; ++i, ++nextJob)
+				{
+					const CWaitingJob job = { priorities[nextJob], now, nextJob };
+					sortOrderQueue.Push(job);
+					checksum += sortOrderQueue.PeekFront().id;
+					sortOrderQueue.PopFront();
+				}
+			}
+			sprintf(name, "Aging %lu jobs, ChangeSortOrder per tick", static_cast<unsigned long>(backlog));
+			ReportBenchResult(name, numOps, timer.GetElapsedSeconds());
+
+			CAgingPqueue<int> agingQueue(agingRate);
+			for (nextJob = 0; nextJob < backlog; ++nextJob)
+			{
+				agingQueue.Push(priorities[nextJob], static_cast<int>(nextJob));
+			}
+			timer.Restart();
+			for (std::uint64_t now = 1; now <= numTicks; ++now)
+			{
+				agingQueue.AdvanceTime(now);
+				for (std::size_t i = 0; i < jobsPerTick; ++i, ++nextJob)
+				{
+					agingQueue.Push(priorities[nextJob], static_cast<int>(nextJob));
+					checksum += agingQueue.PeekFront();
+					agingQueue.PopFront();
+				}
+			}
+			sprintf(name, "Aging %lu jobs, CAgingPqueue", static_cast<unsigned long>(backlog));
+			ReportBenchResult(name, numOps, timer.GetElapsedSeconds());
+			DoNotOptimize(checksum);
+		}
+
+		//! Cache the Zipfian trace replays run against
+		typedef CEvictionCache<std::uint32_t, std::uint32_t> BenchCache_t;
+
+		//! Zipf distributed keys, key k requested in proportion to 1 / (k + 1)^skew
+		std::vector<std::uint32_t> MakeZipfTrace(std::size_t numKeys, std::size_t numRequests, double skew)
+		{
+			std::vector<double> cumulative(numKeys);
+			double total = 0.0;
+			for (std::size_t key = 0; key < numKeys; ++key)
+			{
+				total += 1.0 / std::pow(static_cast<double>(key + 1), skew);
+				cumulative[key] = total;
+			}
+			std::mt19937_64 rng(49);
+			std::uniform_real_distribution<double> uniform(0.0, total);
+			std::vector<std::uint32_t> trace(numRequests);
+			for (std::size_t i = 0; i < numRequests; ++i)
+			{
+				const std::size_t key = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng)) - cumulative.begin();
+				trace[i] = static_cast<std::uint32_t>(key < numKeys ? key : numKeys - 1);
+			}
+			return trace;
+		}
+
+		//! Heap node of the stale entry cache, current while its version
+		//! matches the entry's
+		struct CStaleCacheNode
+		{
+			std::uint64_t numHits;
+			std::uint64_t sequence;
+			std::uint32_t key;
+			std::uint64_t version;
+		};
+
+		//! Fewest hits, then least recently used, on top
+		class CStaleCacheNodeSortOrder : public ISortOrder<CStaleCacheNode>
+		{
+		public:
+			bool LessThan(const CStaleCacheNode& lhs, const CStaleCacheNode& rhs) const
+			{
+				return rhs.numHits < lhs.numHits || (rhs.numHits == lhs.numHits && rhs.sequence < lhs.sequence);
+			}
+		};
+
+		//************************************************************************
+		//! @details
+		//!   Replay trace against an LFU cache the way it was built before
+		//!  CEvictionCache: every hit pushes a new heap node, and nodes whose
+		//!  version is out of date are discarded when they reach the top
+		//!************************************************************************
+		void BenchStaleHeapCache(const std::vector<std::uint32_t>& trace, std::size_t capacity)
+		{
+			struct CStaleEntry
+			{
+				std::uint64_t numHits;
+				std::uint64_t version;
+			};
+			std::unordered_map<std::uint32_t, CStaleEntry> entries;
+			CHeap<CStaleCacheNode> heap(CHeap<CStaleCacheNode>::ISortOrderPtr(new CStaleCacheNodeSortOrder()));
+			std::uint64_t sequence = 0;
+			std::size_t numHits = 0;
+			std::size_t peakHeapSize = 0;
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < trace.size(); ++i)
+			{
+				const std::uint32_t key = trace[i];
+				std::unordered_map<std::uint32_t, CStaleEntry>::iterator found = entries.find(key);
+				if (found != entries.end())
+				{
+					++numHits;
+					CStaleEntry& entry = found->second;
+					const CStaleCacheNode node = { ++entry.numHits, sequence++, key, ++entry.version };
+					heap.Insert(node);
+				}
+				else
+				{
+					while (entries.size() == capacity)
+					{
+						const CStaleCacheNode top = heap.PeekTop();
+						heap.PopTop();
+						std::unordered_map<std::uint32_t, CStaleEntry>::iterator victim = entries.find(top.key);
+						if (victim != entries.end() && victim->second.version == top.version)
+						{
+							entries.erase(victim);
+						}
+					}
+					const CStaleEntry entry = { 0, 0 };
+					entries[key] = entry;
+					const CStaleCacheNode node = { 0, sequence++, key, 0 };
+					heap.Insert(node);
+				}
+				peakHeapSize = heap.GetSize() > peakHeapSize ? heap.GetSize() : peakHeapSize;
+			}
+			char name[128];
+			sprintf(name, "Zipf cache LFU, stale CHeap entries, %.1f%% hits, peak heap %lu",
+				100.0 * static_cast<double>(numHits) / static_cast<double>(trace.size()), static_cast<unsigned long>(peakHeapSize));
+			ReportBenchResult(name, trace.size(), timer.GetElapsedSeconds());
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Replay trace against CEvictionCache, one tick per request,
+		//!  putting each missed key with a cost of 1 to 8 that varies by key
+		//!
+		//! @param[in] timeToLive
+		//!   ticks a put key lives, multiplied by the same 1 to 8
+		//!************************************************************************
+		void BenchEvictionCacheOn(const char* policyName, const BenchCache_t::IEvictionPolicyPtr& policy, std::uint64_t timeToLive,
+			const std::vector<std::uint32_t>& trace, std::size_t capacity)
+		{
+			BenchCache_t cache(capacity, policy);
+			std::size_t numHits = 0;
+			std::uint64_t checksum = 0;
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < trace.size(); ++i)
+			{
+				const std::uint32_t key = trace[i];
+				cache.AdvanceTime(i);
+				const std::uint32_t* value = cache.Get(key);
+				if (value != NULL)
+				{
+					++numHits;
+					checksum += *value;
+				}
+				else
+				{
+					const std::uint32_t weight = 1 + key % 8;
+					cache.Put(key, key, static_cast<double>(weight), timeToLive == CACHE_NEVER_EXPIRES ? timeToLive : weight * timeToLive);
+				}
+			}
+			char name[128];
+			sprintf(name, "Zipf cache %s, CEvictionCache, %.1f%% hits", policyName,
+				100.0 * static_cast<double>(numHits) / static_cast<double>(trace.size()));
+			ReportBenchResult(name, trace.size(), timer.GetElapsedSeconds());
+			DoNotOptimize(checksum);
+		}
+
+		//************************************************************************
+		//! @details
+		//!   Time CWfqScheduler with numFlows flows of weights 1 to 4, kept
+		//!  backlogged with itemsPerFlow items each by pushing one item to a
+		//!  random flow per pop, against one CHeap holding every item
+		//!************************************************************************
+		void BenchWfqOn(std::size_t numFlows, std::size_t itemsPerFlow, std::size_t numOps)
+		{
+			std::mt19937 rng(50);
+			std::vector<std::uint32_t> flows(numOps);
+			std::vector<int> priorities(numFlows * itemsPerFlow + numOps);
+			for (std::size_t i = 0; i < flows.size(); ++i)
+			{
+				flows[i] = static_cast<std::uint32_t>(rng() % numFlows);
+			}
+			for (std::size_t i = 0; i < priorities.size(); ++i)
+			{
+				priorities[i] = static_cast<int>(rng() % 1000);
+			}
+			CHeap<int>::ISortOrderPtr sortOrder(new CStdLessSortOrder<int>());
+			std::uint64_t checksum = 0;
+			char name[128];
+
+			CHeap<int> heap(sortOrder);
+			for (std::size_t i = 0; i < numFlows * itemsPerFlow; ++i)
+			{
+				heap.Insert(priorities[i]);
+			}
+			CBenchTimer timer;
+			for (std::size_t i = 0; i < numOps; ++i)
+			{
+				checksum += heap.PeekTop();
+				heap.PopTop();
+				heap.Insert(priorities[numFlows * itemsPerFlow + i]);
+			}
+			sprintf(name, "WFQ %lu flows, one CHeap, no fairness", static_cast<unsigned long>(numFlows));
+			ReportBenchResult(name, numOps, timer.GetElapsedSeconds());
+
+			CWfqScheduler<int> scheduler;
+			for (std::size_t flow = 0; flow < numFlows; ++flow)
+			{
+				scheduler.AddFlow(static_cast<double>(1 + flow % 4), sortOrder);
+				for (std::size_t i = 0; i < itemsPerFlow; ++i)
+				{
+					scheduler.Push(static_cast<CWfqScheduler<int>::FlowId_t>(flow), priorities[flow * itemsPerFlow + i]);
+				}
+			}
+			timer.Restart();
+			for (std::size_t i = 0; i < numOps; ++i)
+			{
+				int item = 0;
+				checksum += scheduler.PopFront(item);
+				scheduler.Push(flows[i], priorities[numFlows * itemsPerFlow + i]);
+			}
+			sprintf(name, "WFQ %lu flows, CWfqScheduler", static_cast<unsigned long>(numFlows));
+			ReportBenchResult(name, numOps, timer.GetElapsedSeconds());
+			DoNotOptimize(checksum);
+		}
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Sort CTestStructs on A then B then C with each flavor of composite
+	//!  sort order
+	//!************************************************************************
+	void BenchCompositeSort()
+	{
+		ISortOrderTestStructPtr  criteriaASort(new CSortOnCriteriaA());
+		ISortOrderTestStructPtr  criteriaBSort(new CSortOnCriteriaB());
+		ISortOrderTestStructPtr  criteriaCSort(new CSortOnCriteriaC());
+
+		std::vector< ISortOrderTestStructPtr > sortCriteria;
+		sortCriteria.push_back(criteriaASort);
+		sortCriteria.push_back(criteriaBSort);
+		sortCriteria.push_back(criteriaCSort);
+		ISortOrderTestStructPtr twoPassSort(new CTwoPassCompositeSortOrder(sortCriteria));
+		ISortOrderTestStructPtr compositeSort(new CCompositeSortOrder<CTestStruct>(sortCriteria));
+
+		// same criteria, but A then (B then C) nested, flattened on construction
+		std::vector< ISortOrderTestStructPtr > sortCriteriaBC;
+		sortCriteriaBC.push_back(criteriaBSort);
+		sortCriteriaBC.push_back(criteriaCSort);
+		std::vector< ISortOrderTestStructPtr > sortCriteriaNested;
+		sortCriteriaNested.push_back(criteriaASort);
+		sortCriteriaNested.push_back(ISortOrderTestStructPtr(new CCompositeSortOrder<CTestStruct>(sortCriteriaBC)));
+		ISortOrderTestStructPtr nestedSort(new CCompositeSortOrder<CTestStruct>(sortCriteriaNested));
+
+		ISortOrderTestStructPtr staticSort(new CStaticCompositeSortOrder<CTestStruct,
+			CSortOnCriteriaA, CSortOnCriteriaB, CSortOnCriteriaC>());
+
+		const std::vector<CTestStruct> testStructs = MakeTestStructs(100000);
+		BenchComparisons("LessThan two pass composite", *twoPassSort, testStructs, 20);
+		BenchComparisons("LessThan three-way composite", *compositeSort, testStructs, 20);
+		BenchComparisons("LessThan flattened nested composite", *nestedSort, testStructs, 20);
+		BenchComparisons("LessThan static composite", *staticSort, testStructs, 20);
+
+		BenchHeapSort("Heap sort two pass composite", twoPassSort, testStructs);
+		BenchHeapSort("Heap sort three-way composite", compositeSort, testStructs);
+		BenchHeapSort("Heap sort flattened nested composite", nestedSort, testStructs);
+		BenchHeapSort("Heap sort static composite", staticSort, testStructs);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Sort CTestStructs on A then B then C comparing precomputed keys
+	//!  against calling the criteria
+	//!************************************************************************
+	void BenchNormalizedSortKey()
+	{
+		ISortOrderTestStructPtr staticSort(new CStaticCompositeSortOrder<CTestStruct,
+			CSortOnCriteriaA, CSortOnCriteriaB, CSortOnCriteriaC>());
+		std::shared_ptr< ISortKeyEncoder<CTestStruct> > encoder(new CTestStructSortKeyEncoder());
+
+		const std::vector<CTestStruct> testStructs = MakeTestStructs(100000);
+		std::vector< CNormalizedKeyItem<CTestStruct, 24> > keyedTestStructs;
+		for (std::size_t i = 0; i < testStructs.size(); ++i)
+		{
+			keyedTestStructs.push_back(CNormalizedKeyItem<CTestStruct, 24>(testStructs[i], *encoder));
+		}
+		CNormalizedKeySortOrder<CTestStruct, 24> keySort(staticSort);
+		BenchComparisons("LessThan static composite", *staticSort, testStructs, 20);
+		BenchComparisons("LessThan 24 byte normalized keys", keySort, keyedTestStructs, 20);
+
+		BenchHeapSort("Heap sort static composite", staticSort, testStructs);
+
+		CNormalizedKeyHeap<CTestStruct, 24> keyedHeap(staticSort, encoder);
+		TimeHeapSort("Heap sort 24 byte normalized keys", keyedHeap, testStructs);
+
+		// only room for 3 bytes of criteria C, most comparisons that get that
+		// far need the full sort order
+		CNormalizedKeyHeap<CTestStruct, 15> shortKeyedHeap(staticSort, encoder);
+		TimeHeapSort("Heap sort 15 byte normalized keys", shortKeyedHeap, testStructs);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run shortest paths on a random graph with a radix heap and with a
+	//!  CHeap of (distance, node) pairs
+	//!************************************************************************
+	void BenchRadixHeap()
+	{
+		const CBenchGraph graph = MakeBenchGraph(20000, 4);
+		BenchDijkstra<CPairHeapQueue>("Dijkstra CHeap of pairs push/pop", graph);
+		BenchDijkstra< CRadixHeap<std::uint64_t, std::uint32_t> >("Dijkstra CRadixHeap push/pop", graph);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Schedule timers a random distance out and cancel 99% of them,
+	//!  with the timer wheel and with a CHeap of deadlines
+	//!************************************************************************
+	void BenchTimerWheel()
+	{
+		BenchTimers<CHeapTimerQueue>("Timers CHeap schedule/cancel", 20000, 4, 99);
+		BenchTimers< CTimerWheel<std::uint32_t> >("Timers CTimerWheel schedule/cancel", 20000, 4, 99);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Run a bounded queue evicting its lowest priority job with the
+	//!  min-max heap and with two mirrored CHeaps
+	//!************************************************************************
+	void BenchMinMaxHeap()
+	{
+		BenchBoundedQueue<CMirroredHeapsDeque>("Bounded queue two mirrored CHeaps", 100000, 1000);
+		BenchBoundedQueue<CMinMaxHeapDeque>("Bounded queue CDoubleEndedPqueue", 100000, 1000);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Consolidate shard heaps by popping and re-inserting and by merging
+	//!************************************************************************
+	void BenchHeapMerge()
+	{
+		BenchShardConsolidation("Consolidate 8 shards pop/insert", 8, 10000, false);
+		BenchShardConsolidation("Consolidate 8 shards CHeap::Merge", 8, 10000, true);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Consolidate 64 heaps into one ordered stream serially and with the
+	//!  parallel drainer, whose merge phase should shrink with more threads
+	//!************************************************************************
+	void BenchParallelHeapDrain()
+	{
+		BenchSerialDrain("Drain 64 heaps serial PeekTop/PopTop", 64, 2000);
+		BenchParallelDrain("Drain 64 heaps parallel, 1 thread", "Drain 64 heaps merge phase, 1 thread", 64, 2000, 1);
+		BenchParallelDrain("Drain 64 heaps parallel, 4 threads", "Drain 64 heaps merge phase, 4 threads", 64, 2000, 4);
+		BenchParallelDrain("Drain 64 heaps parallel, 8 threads", "Drain 64 heaps merge phase, 8 threads", 64, 2000, 8);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Producer/consumer latency through the blocking queue, popping one
+	//!  job at a time and in batches
+	//!************************************************************************
+	void BenchBlockingPqueue()
+	{
+		BenchBlockingLatency("Blocking queue latency, PopFront", 2, 20000, 256, 1);
+		BenchBlockingLatency("Blocking queue latency, PopBatch of 32", 2, 20000, 256, 32);
+	}
+
+	//************************************************************************
+	//! @details
+	//!   Read the next 50 items of large heaps with and without PeekTopK
+	//!************************************************************************
+	void BenchTopK()
+	{
+		BenchTopKOn(10000, 50, 200);
+		BenchTopKOn(100000, 50, 50);
+		BenchTopKOn(100000, 1000, 50);
+	}
+	//************************************************************************
+	//! @details
+	//!   First in, first out tie breaking with many ties and with few
+	//!************************************************************************
+	void BenchStableHeap()
+	{
+		BenchStableHeapOn(100000, 16);
+		BenchStableHeapOn(100000, 100000);
+	}
+	//************************************************************************
+	//! @details
+	//!   Age a scheduler's backlog every tick, by re-sorting and by epoch
+	//!************************************************************************
+	void BenchAgingPqueue()
+	{
+		BenchAgingOn(1000, 16, 2000);
+		BenchAgingOn(100000, 16, 200);
+	}
+	//************************************************************************
+	//! @details
+	//!   Keep 1000 items queued, inserting and popping one at a time, in a
+	//!  CHeap and in a CStaticHeap
+	//!************************************************************************
+	void BenchStaticHeap()
+	{
+		const std::size_t numQueued = 1000;
+		std::vector<std::uint32_t> values(200000);
+		std::mt19937 rng(20261018);
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = static_cast<std::uint32_t>(rng());
+		}
+		std::uint64_t checksum = 0;
+
+		CHeap<std::uint32_t> heap(CHeap<std::uint32_t>::ISortOrderPtr(new CStdLessSortOrder<std::uint32_t>()));
+		for (std::size_t i = 0; i < numQueued; ++i)
+		{
+			heap.Insert(values[i]);
+		}
+		BenchSteadyStateLatency("Steady 1000 items, CHeap", [&heap, &checksum](std::uint32_t value)
+		{
+			heap.Insert(value);
+			checksum += heap.PeekTop();
+			heap.PopTop();
+		}, values);
+
+		CStaticHeap<std::uint32_t, 1024> staticHeap;
+		for (std::size_t i = 0; i < numQueued; ++i)
+		{
+			staticHeap.Insert(values[i]);
+		}
+		BenchSteadyStateLatency("Steady 1000 items, CStaticHeap", [&staticHeap, &checksum](std::uint32_t value)
+		{
+			std::uint32_t top = 0;
+			staticHeap.Insert(value);
+			staticHeap.PopTop(top);
+			checksum += top;
+		}, values);
+		DoNotOptimize(checksum);
+	}
+	//************************************************************************
+	//! @details
+	//!   Pop many tenants' heaps one at a time and interleaved, in cache and
+	//!  far larger than the last level cache
+	//!************************************************************************
+	void BenchInterleavedPop()
+	{
+		BenchInterleavedPopOn(16, 1 << 12, 2000);
+		BenchInterleavedPopOn(16, 1 << 21, 20000);
+		BenchInterleavedPopOn(64, 1 << 19, 5000);
+	}
+	//************************************************************************
+	//! @details
+	//!   Time the queue shared between processes: uncontended in one
+	//!  process, then with a producer process feeding this one. Does
+	//!  nothing off Linux.
+	//!************************************************************************
+	void BenchSharedPqueue()
+	{
+#ifdef __linux__
+		typedef CSharedPqueue<std::uint64_t, 4096> Shared_t;
+		const std::size_t numItems = 1000000;
+		std::ostringstream name;
+		name << "/pqueuebench_" << getpid();
+		Shared_t queue(name.str(), SHARED_CREATE);
+		std::mt19937_64 random(48);
+		std::vector<std::uint64_t> values(numItems);
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = random();
+		}
+		for (std::size_t i = 0; i < 1000; ++i)
+		{
+			queue.TryPush(values[i]);
+		}
+
+		std::uint64_t checksum = 0;
+		BenchSteadyStateLatency("Shared, one process, push+pop", [&queue, &checksum](std::uint32_t value)
+		{
+			std::uint64_t top = 0;
+			queue.TryPush(value);
+			queue.TryPop(top);
+			checksum += top;
+		}, std::vector<std::uint32_t>(values.begin(), values.begin() + numItems / 4));
+
+		// a producer process pushes every value while this one pops them
+		const std::size_t batchSizes[] = { 1, 64 };
+		for (std::size_t batchSize : batchSizes)
+		{
+			while (queue.PopBatch(&values[0], 1) > 0)
+			{
+			}
+			CBenchTimer timer;
+			const pid_t producer = fork();
+			if (producer == 0)
+			{
+				Shared_t producerQueue(name.str(), SHARED_OPEN);
+				for (std::size_t pushed = 0; pushed < numItems; )
+				{
+					const std::size_t count = batchSize < numItems - pushed ? batchSize : numItems - pushed;
+					const std::size_t numPushed = producerQueue.PushBatch(&values[pushed], count);
+					if (numPushed == 0)
+					{
+						// full, let the consumer run rather than spin
+						sched_yield();
+					}
+					pushed += numPushed;
+				}
+				_exit(0);
+			}
+			std::vector<std::uint64_t> popped(batchSize);
+			for (std::size_t numPopped = 0; numPopped < numItems; )
+			{
+				const std::size_t count = queue.PopBatch(&popped[0], batchSize);
+				if (count == 0)
+				{
+					sched_yield();
+				}
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					checksum += popped[i];
+				}
+				numPopped += count;
+			}
+			int status = 0;
+			waitpid(producer, &status, 0);
+			ReportBenchResult(batchSize == 1 ? "Shared, producer process, batches of 1" : "Shared, producer process, batches of 64",
+				numItems, timer.GetElapsedSeconds());
+		}
+		DoNotOptimize(checksum);
+#endif
+	}
+	//************************************************************************
+	//! @details
+	//!   Replay a Zipfian key trace against each eviction policy and the
+	//!  stale entry heap CEvictionCache replaces
+	//!************************************************************************
+	void BenchEvictionCache()
+	{
+		const std::size_t capacity = 10000;
+		const std::vector<std::uint32_t> trace = MakeZipfTrace(1000000, 2000000, 0.99);
+		BenchStaleHeapCache(trace, capacity);
+		BenchEvictionCacheOn("LFU", BenchCache_t::IEvictionPolicyPtr(new CLfuEvictionPolicy()), CACHE_NEVER_EXPIRES, trace, capacity);
+		BenchEvictionCacheOn("GreedyDual", BenchCache_t::IEvictionPolicyPtr(new CGreedyDualEvictionPolicy()), CACHE_NEVER_EXPIRES, trace, capacity);
+		BenchEvictionCacheOn("TTL weighted", BenchCache_t::IEvictionPolicyPtr(new CTtlWeightedEvictionPolicy(capacity)), capacity, trace, capacity);
+	}
+	//************************************************************************
+	//! @details
+	//!   Schedule thousands of weighted flows with CWfqScheduler
+	//!************************************************************************
+	void BenchWfqScheduler()
+	{
+		BenchWfqOn(1024, 16, 1000000);
+		BenchWfqOn(8192, 16, 1000000);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+//********************************************************************
+//  FILE NAME:      pqueuebench_main.cpp
+//
+//  DESCRIPTION:    Main routine for the pqueue benchmarks... times
+//					library functions by invoking PqueueBench functions
+//*********************************************************************
+
+#include "PqueueBench.h"
+#include "BenchUtils.h"
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	//! A group of benchmarks that can be run by name
+	struct CBenchSuite
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	const CBenchSuite BENCH_SUITES[] =
+	{
+		{ "heapops", pqueue::BenchHeapOperations },
+		{ "footprint", pqueue::BenchHeapFootprint },
+		{ "composite", pqueue::BenchCompositeSort },
+		{ "normalizedkey", pqueue::BenchNormalizedSortKey },
+		{ "radix", pqueue::BenchRadixHeap },
+		{ "timerwheel", pqueue::BenchTimerWheel },
+		{ "minmax", pqueue::BenchMinMaxHeap },
+		{ "merge", pqueue::BenchHeapMerge },
+		{ "paralleldrain", pqueue::BenchParallelHeapDrain },
+		{ "blocking", pqueue::BenchBlockingPqueue },
+		{ "topk", pqueue::BenchTopK },
+		{ "stable", pqueue::BenchStableHeap },
+		{ "aging", pqueue::BenchAgingPqueue },
+		{ "smallheap", pqueue::BenchSmallHeap },
+		{ "staticheap", pqueue::BenchStaticHeap },
+		{ "interleaved", pqueue::BenchInterleavedPop },
+		{ "server", pqueue::BenchPqueueServer },
+		{ "shared", pqueue::BenchSharedPqueue },
+		{ "cache", pqueue::BenchEvictionCache },
+		{ "wfq", pqueue::BenchWfqScheduler },
+		{ "trace", pqueue::BenchTraceReplay },
+	};
+	const std::size_t NUM_BENCH_SUITES = sizeof(BENCH_SUITES) / sizeof(BENCH_SUITES[0]);
+
+	void PrintUsage()
+	{
+		printf("usage: pqueuebench [--json FILE] [--list] [--replay TRACE] [SUITE...]\n");
+		printf("  runs every suite when none are named and no trace is replayed\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace pqueue;
+	const char* jsonPath = NULL;
+	const char* replayPath = NULL;
+	std::vector<std::string> selectedSuites;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--list") == 0)
+		{
+			for (std::size_t suite = 0; suite < NUM_BENCH_SUITES; ++suite)
+			{
+				printf("%s\n", BENCH_SUITES[suite].name);
+			}
+			return 0;
+		}
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			selectedSuites.push_back(argv[i]);
+		}
+	}
+
+	std::size_t numSuitesRun = 0;
+	if (replayPath != NULL)
+	{
+		GetCurrentBenchSuite() = "replay";
+		if (!BenchTraceFile(replayPath))
+		{
+			fprintf(stderr, "could not replay %s\n", replayPath);
+			return 1;
+		}
+		++numSuitesRun;
+	}
+	for (std::size_t suite = 0; suite < NUM_BENCH_SUITES; ++suite)
+	{
+		bool isSelected = selectedSuites.empty() && replayPath == NULL;
+		for (std::size_t i = 0; i < selectedSuites.size(); ++i)
+		{
+			isSelected = isSelected || selectedSuites[i] == BENCH_SUITES[suite].name;
+		}
+		if (isSelected)
+		{
+			GetCurrentBenchSuite() = BENCH_SUITES[suite].name;
+			BENCH_SUITES[suite].run();
+			++numSuitesRun;
+		}
+	}
+	if (numSuitesRun == 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (jsonPath != NULL && !WriteBenchResultsJson(jsonPath))
+	{
+		fprintf(stderr, "could not write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+//********************************************************************
+//  FILE NAME:      pqueueserver_main.cpp
+//
+//  DESCRIPTION:    Main routine for the queue server... serves named
+//					priority queues on one address until interrupted.
+//					Linux only.
+//*********************************************************************
+
+#include "PqueueServer.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+	//! Server stopped by SIGINT and SIGTERM
+	pqueue::CPqueueServer* g_server = NULL;
+
+	//! Stop only writes to an eventfd, which is safe in a signal handler
+	void StopServer(int /*signal*/)
+	{
+		if (g_server != NULL)
+		{
+			g_server->Stop();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* address = "unix:/tmp/pqueue.sock";
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+	{
+		printf("usage: pqueueserver [ADDRESS]\n");
+		printf("  ADDRESS is unix:PATH or tcp:A.B.C.D:PORT, default %s\n", address);
+		return 1;
+	}
+	if (argc == 2)
+	{
+		address = argv[1];
+	}
+
+	try
+	{
+		pqueue::CPqueueServer server(address);
+		g_server = &server;
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = StopServer;
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
+		printf("serving on %s\n", address);
+		fflush(stdout);
+		server.Run();
+		g_server = NULL;
+	}
+	catch (pqueue::CSocketError&)
+	{
+		fprintf(stderr, "could not serve on %s\n", address);
+		return 1;
+	}
+	return 0;
+}